@@ -1,16 +1,33 @@
 #include "ex6.h"
+#include "pkreplica.h"
 #include <ctype.h>
+#include <errno.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
 
 # define INT_BUFFER 128
 
 # define FIRST_STARTER 1 
 # define LAST_STARTER 3
 
-# define LOWEST_ID 1
-# define HIGHEST_ID 151
+# define SUGGEST_LIMIT 10
+
+# define CHECKPOINT_SECONDS 60
+# define CHECKPOINT_CHANGES 100
+# define PRINT_BUFFER (1 << 16)
+
+# define PIPE_QUEUE (1 << 20)   // bytes in each pipelined replay queue
+# define PIPE_SPINS 64          // empty/full polls before yielding the CPU
+
+# define DUMP_CHUNK 256       // owners per work item in dumpAllOwners
+# define DUMP_MAX_THREADS 16
+# define DUMP_WINDOW 4        // rendered-but-unwritten chunks allowed per worker
 
 # define  CHOOSE_POKEDEX 0
 # define  DELETE_POKEDEX 1
@@ -18,13 +35,20 @@
 # define MERGE_DESTINATION 1
 # define MERGE_SOURCE 2
 
+// Set by -q: menus and prompts are not printed, only results and errors
+static int quietMode = 0;
+
+// Pipelined replay state, idle unless -p was given
+static Pipeline pipeline = {0};
+
 // ================================================
-// Basic struct definitions from ex6.h assumed:
+// Basic struct definitions from pokedex.h assumed:
 //   PokemonData { int id; char *name; PokemonType TYPE; int hp; int attack; EvolutionStatus CAN_EVOLVE; }
 //   PokemonNode { PokemonData* data; PokemonNode* left, *right; }
-//   OwnerNode   { char* ownerName; PokemonNode* pokedexRoot; OwnerNode *next, *prev; }
-//   OwnerNode* ownerHead;
-//   const PokemonData pokedex[];
+//   Pokedex     { uint16_t *slots; int length, capacity, live; }  (catalog indices)
+//   OwnerNode   { name hash/length/key, char* ownerName; Pokedex pokedex; uint32_t next, prev; }
+//   PokedexContext { OwnerNode* ownerHead; registry, undo history, ... }  (passed to every call)
+//   Catalog catalog;  (species loaded at startup, see loadCatalog)
 // ================================================
 
 // --------------------------------------------------------------
@@ -48,17 +72,12 @@ void trimWhitespace(char *str) {
 }
 
 
-char *myStrdup(const char *src) {
-	if (!src)
-		return NULL;
-	size_t len = strlen(src);
-	char *dest = (char *)malloc(len + 1);
-	if (!dest) {
-		printf("Memory allocation failed in myStrdup.\n");
-		return NULL;
-	}
-	strcpy(dest, src);
-	return dest;
+void menuText(const char *format, ...) {
+	if (quietMode) return;
+	va_list args;
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
 }
 
 
@@ -68,7 +87,7 @@ int readIntSafe(const char *prompt)
 	int value;
 	int success = 0;
 	while (!success) {
-		printf("%s", prompt);
+		menuText("%s", prompt);
 		// If we fail to read, treat it as invalid
 		if (!fgets(buffer, sizeof(buffer), stdin)) {
 			printf("Invalid input.\n");
@@ -98,27 +117,33 @@ int readIntSafe(const char *prompt)
 	return value;
 }
 
-// --------------------------------------------------------------
-// 2) Utility: Get type name from enum
-// --------------------------------------------------------------
-const char *getTypeName(PokemonType type) {
-	switch (type) {
-		case GRASS: return "GRASS";
-		case FIRE: return "FIRE";
-		case WATER: return "WATER";
-		case BUG: return "BUG";
-		case NORMAL: return "NORMAL";
-		case POISON: return "POISON";
-		case ELECTRIC: return "ELECTRIC";
-		case GROUND: return "GROUND";
-		case FAIRY: return "FAIRY";
-		case FIGHTING: return "FIGHTING";
-		case PSYCHIC: return "PSYCHIC";
-		case ROCK: return "ROCK";
-		case GHOST: return "GHOST";
-		case DRAGON: return "DRAGON";
-		case ICE: return "ICE";
-	default: return "UNKNOWN";
+int readSpeciesSafe(const char *prompt)
+{
+	char buffer[INT_BUFFER];
+	while (1) {
+		menuText("%s", prompt);
+		if (!fgets(buffer, sizeof(buffer), stdin)) {
+			printf("Invalid input.\n");
+			clearerr(stdin);
+			continue;
+		}
+		size_t len = strlen(buffer);
+		if (len > 0 && (buffer[len - 1] == '\n' || buffer[len - 1] == '\r'))
+			buffer[--len] = '\0';
+		if (len > 0 && (buffer[len - 1] == '\r' || buffer[len - 1] == '\n'))
+			buffer[--len] = '\0';
+		if (len == 0) {
+			printf("Invalid input.\n");
+			continue;
+		}
+		char *endptr;
+		int value = (int)strtol(buffer, &endptr, 10);
+		if (*endptr == '\0') return value;
+		// not a number => maybe a species name
+		trimWhitespace(buffer);
+		const PokemonData *data = speciesByName(buffer, strlen(buffer));
+		if (data) return data->id;
+		printf("Invalid input.\n");
 	}
 }
 
@@ -158,7 +183,7 @@ char *getDynamicInput() {
 char readDirection(const char *prompt) {
 	char *input = NULL;
 	char temp = '\0';
-	printf("%s", prompt);
+	menuText("%s", prompt);
 	do {
 		input = getDynamicInput();
 		if (input) {
@@ -172,94 +197,29 @@ char readDirection(const char *prompt) {
 		input = NULL;
 		temp = '\0';
 		// official linux executable prints "L or R"
-		printf("Invalid direction, must be F or B.\n%s", prompt); 
+		printf("Invalid direction, must be F or B.\n");
+		menuText("%s", prompt);
 	} while (1);
 }
 
 
-void swapOwnerData(OwnerNode *a, OwnerNode *b) {
-	char *tmpName = a->ownerName;
-	PokemonNode *tmpRoot = a->pokedexRoot;
-	a->ownerName = b->ownerName;
-	a->pokedexRoot = b->pokedexRoot;
-	b->ownerName = tmpName;
-	b->pokedexRoot = tmpRoot;
+// Raw bytes for stdout, after whatever printf has buffered. In a -p run
+// they go through stdio too, so they stay in order on the writer's queue.
+static int writeOutput(const void *data, size_t len) {
+	if (pipeline.running) return fwrite(data, 1, len, stdout) == len;
+	return writeAll(STDOUT_FILENO, data, len);
 }
 
 
-void sortOwners(void) {
-	if (!ownerHead) {
+void sortOwners(PokedexContext *ctx) {
+	if (!ctx->ownerHead) {
 		// official linux executable prints iff 0 owners
 		printf("0 or 1 owners only => no need to sort.\n");
 		return;
 	}
-	if (ownerHead->next == ownerHead) {
-		// official linux executable prints iff owners >=1
-		printf("Owners sorted by name.\n");
-		return;
-	}
-	int swapped;
-	do {
-		swapped = 0;
-		OwnerNode *cur = ownerHead;
-		do {
-			OwnerNode *n = cur->next;
-			if (strcmp(cur->ownerName, n->ownerName) > 0) {
-				swapOwnerData(cur, n);
-				swapped = 1;
-			}
-			cur = n;
-		} while (cur->next != ownerHead);
-	} while (swapped);
-
-	OwnerNode *min = ownerHead;
-	OwnerNode *iter = ownerHead->next;
-	while (iter != ownerHead) {
-		if (strcmp(iter->ownerName, min->ownerName) < 0)
-			min = iter;
-		iter = iter->next;
-	}
-	ownerHead = min;
-	printf("Owners sorted by name.\n");
-}
-
-void insertPokemonNode(PokemonNode **root, PokemonNode *newNode) {
-	if (!(*root)) {
-		*root = newNode;
-		newNode->left = newNode->right = NULL;
-		return;
-	}
-	if (newNode->data->id < (*root)->data->id)
-		insertPokemonNode(&(*root)->left, newNode);
-	else if (newNode->data->id > (*root)->data->id)
-		insertPokemonNode(&(*root)->right, newNode);
-	else freePokemonNode(newNode);
-}
-
-PokemonNode* pokemonCircleToTree(PokemonNode *root) {
-	if (!root) return NULL;
-	PokemonNode *t = root;
-	PokemonNode *treeRoot = NULL;
-	PokemonNode *next = NULL;
-	do {
-		next = t->right;
-		PokemonNode *node = (PokemonNode *)malloc(sizeof(PokemonNode));
-		if (!node) return treeRoot;
-		*node = *t;
-		node->left = node->right = NULL;
-		insertPokemonNode(&treeRoot, node);
-		t = next;
-	} while (t != root);
-	return treeRoot;
-}
-
-
-void freePokemonTree(PokemonNode **root) {
-	if (!*root) return;
-	freePokemonTree(&(*root)->left);
-	freePokemonTree(&(*root)->right);
-	free(*root);
-	*root = NULL;
+	// official linux executable prints iff owners >=1
+	if (pkSortOwners(ctx) == PK_NO_MEMORY) printf("Memory allocation failed.\n");
+	else printf("Owners sorted by name.\n");
 }
 
 
@@ -275,53 +235,12 @@ void printPokemonNode(PokemonNode *node) {
 }
 
 
-void BFSGeneric(PokemonNode *root, VisitNodeFunc visit) {
-	if (!root || !visit) return;
-	Queue q;
-	initQueue(&q);
-	enqueue(&q, root);
-	while (q.front) {
-		PokemonNode *node = dequeue(&q);
-		visit(node);
-		if (node->left)
-			enqueue(&q, node->left);
-		if (node->right)
-			enqueue(&q, node->right);
-	}
-	freeQueue(&q);
-}
-
-
-void preOrderGeneric(PokemonNode *root, VisitNodeFunc visit) {
-	if (!root) return;
-	visit(root);
-	preOrderGeneric(root->left, visit);
-	preOrderGeneric(root->right, visit);
-}
-
-
-void inOrderGeneric(PokemonNode *root, VisitNodeFunc visit) {
-	if (!root) return;
-	inOrderGeneric(root->left, visit);
-	visit(root);
-	inOrderGeneric(root->right, visit);
-}
-
-
-void postOrderGeneric(PokemonNode *root, VisitNodeFunc visit) {
-	if (!root) return;
-	postOrderGeneric(root->left, visit);
-	postOrderGeneric(root->right, visit);
-	visit(root);
-}
-
-
 void preOrderTraversal(PokemonNode *root) {
 	if (!root){
 		printf("Pokedex is empty.\n");
 		return;
 	}
-	preOrderGeneric(root, printPokemonNode);
+	if (!preOrderGeneric(root, printPokemonNode)) printf("Memory allocation failed.\n");
 }
 
 
@@ -330,7 +249,7 @@ void inOrderTraversal(PokemonNode *root) {
 		printf("Pokedex is empty.\n");
 		return;
 	}
-	inOrderGeneric(root, printPokemonNode);
+	if (!inOrderGeneric(root, printPokemonNode)) printf("Memory allocation failed.\n");
 }
 
 
@@ -339,7 +258,7 @@ void postOrderTraversal(PokemonNode *root) {
 		printf("Pokedex is empty.\n");
 		return;
 	}
-	postOrderGeneric(root, printPokemonNode);
+	if (!postOrderGeneric(root, printPokemonNode)) printf("Memory allocation failed.\n");
 }
 
 
@@ -347,19 +266,23 @@ void postOrderTraversal(PokemonNode *root) {
 // Display Menu
 // --------------------------------------------------------------
 void displayMenu(OwnerNode *owner) {
-	if (!owner->pokedexRoot) {
+	if (!owner->pokedex.live) {
 		printf("Pokedex is empty.\n");
 		return; 
 	}
 	int choice = 0;
-	printf("Display:\n"
+	menuText("Display:\n"
 	"1. BFS (Level-Order)\n"
 	"2. Pre-Order\n"
 	"3. In-Order\n"
 	"4. Post-Order\n"
 	"5. Alphabetical (by name)\n");
 	choice = readIntSafe("Your choice: ");
-	PokemonNode *treeRoot = pokemonCircleToTree(owner->pokedexRoot);
+	PokemonNode *treeRoot = pokedexToTree(&owner->pokedex);
+	if (!treeRoot) {
+		printf("Memory allocation failed.\n");
+		return;
+	}
 	switch (choice) {
 		case 1: displayBFS(treeRoot); break;
 		case 2: preOrderTraversal(treeRoot); break;
@@ -368,7 +291,7 @@ void displayMenu(OwnerNode *owner) {
 		case 5: displayAlphabetical(treeRoot); break;
 	default: printf("Invalid choice.\n");
 	}
-	freePokemonTree(&treeRoot);
+	freePokedexTree(&treeRoot);
 }
 
 
@@ -379,7 +302,11 @@ void displayAlphabetical(PokemonNode *root) {
 	}
 	NodeArray na;
 	initNodeArray(&na, 16);
-	collectAll(root, &na);
+	if (!collectAll(root, &na)) {
+		printf("Memory allocation failed.\n");
+		free(na.nodes);
+		return;
+	}
 	qsort(na.nodes, na.size, sizeof(PokemonNode *), compareByNameNode);
 	for (int i = 0; i < na.size; i++) printPokemonNode(na.nodes[i]);
 	free(na.nodes);
@@ -403,11 +330,14 @@ void addNode(NodeArray *na, PokemonNode *node) {
 }
 
 
-void collectAll(PokemonNode *root, NodeArray *na) {
-	if (!root) return;
-	collectAll(root->left, na);
-	addNode(na, root);
-	collectAll(root->right, na);
+static int collectNode(PokemonNode *node, void *ctx) {
+	addNode((NodeArray *)ctx, node);
+	return 1;
+}
+
+
+int collectAll(PokemonNode *root, NodeArray *na) {
+	return traverseTree(root, ORDER_IN, collectNode, na) >= 0;
 }
 
 
@@ -421,243 +351,216 @@ int compareByNameNode(const void *a, const void *b) {
 // --------------------------------------------------------------
 // Sub-menu for existing Pokedex
 // --------------------------------------------------------------
-void enterExistingPokedexMenu(void) {
-	if (!ownerHead) {
+void enterExistingPokedexMenu(PokedexContext *ctx) {
+	if (!ctx->ownerHead) {
 		printf("No existing Pokedexes.\n");
 		return;
 	}
 	OwnerNode* owner = NULL;
 	do {
 		owner = NULL;
-		printf("\nExisting Pokedexes:\n");
-		ownerByNumber(&owner, CHOOSE_POKEDEX);
+		menuText("\nExisting Pokedexes:\n");
+		ownerByNumber(ctx, &owner, CHOOSE_POKEDEX);
 	} while (!owner);
-	printf("\nEntering %s's Pokedex...\n", owner->ownerName);
+	menuText("\nEntering %s's Pokedex...\n", owner->ownerName);
 	int subChoice;
 	do {
+		checkpointPoll(ctx);
 		subChoice = 0;
-		printf("\n-- %s's Pokedex Menu --\n"
+		menuText("\n-- %s's Pokedex Menu --\n"
 			"1. Add Pokemon\n"
 			"2. Display Pokedex\n"
 			"3. Release Pokemon (by ID)\n"
 			"4. Pokemon Fight!\n"
 			"5. Evolve Pokemon\n"
-			"6. Back to Main\n",
+			"6. Back to Main\n"
+			"7. Evolve All Eligible\n"
+			"8. Evolve All to Final Form\n"
+			"9. Bulk Release\n",
 			owner->ownerName);
 		subChoice = readIntSafe("Your choice: ");
 		switch (subChoice) {
-			case 1: addPokemon(owner); break;
+			case 1: undoBegin(ctx, "Add Pokemon"); addPokemon(ctx, owner); undoEnd(ctx); break;
 			case 2: displayMenu(owner); break;
-			case 3: freePokemon(owner); break;
+			case 3: undoBegin(ctx, "Release Pokemon"); freePokemon(ctx, owner); undoEnd(ctx); break;
 			case 4: pokemonFight(owner); break;
-			case 5: evolvePokemon(owner); break;
-			case 6: printf("Back to Main Menu.\n"); break;
+			case 5: undoBegin(ctx, "Evolve Pokemon"); evolvePokemon(ctx, owner); undoEnd(ctx); break;
+			case 6: menuText("Back to Main Menu.\n"); break;
+			case 7: undoBegin(ctx, "Evolve All Eligible"); evolveAllMenu(ctx, owner, 0); undoEnd(ctx); break;
+			case 8: undoBegin(ctx, "Evolve All to Final Form"); evolveAllMenu(ctx, owner, 1); undoEnd(ctx); break;
+			case 9: undoBegin(ctx, "Bulk Release"); bulkReleaseMenu(ctx, owner); undoEnd(ctx); break;
 		default: printf("Invalid choice.\n");
 		}
 	} while (subChoice != 6);
 }
 
 
-void initQueue(Queue *q) {
-	q->front = q->rear = NULL;
-}
-
-
-void enqueue(Queue *q, PokemonNode *p) {
-	QueueNode *n = (QueueNode *)malloc(sizeof(QueueNode));
-	if (!n) return;
-	n->pokemon = p;
-	n->next = NULL;
-	if (!q->rear) q->front = q->rear = n;
-	else q->rear = q->rear->next = n;
-}
-
-
-PokemonNode *dequeue(Queue *q) {
-	if (!q->front) return NULL;
-	QueueNode *n = q->front;
-	PokemonNode *p = n->pokemon;
-	if (!(q->front = n->next)) q->rear = NULL;
-	free(n);
-	return p;
-}
-
-
-void freeQueue(Queue *q) {
-	while (q->front) dequeue(q);
-	q->rear = NULL;
-}
-
-
-PokemonNode *searchPokemonBFS(PokemonNode *root, int id) {
-	if (!root) return NULL;
-	Queue q;
-	initQueue(&q);
-	enqueue(&q, root);
-	while (q.front) {
-		PokemonNode *node = dequeue(&q);
-		if (node->data->id == id) {
-			freeQueue(&q);
-			q.front = q.rear = NULL;
-			return node;
-		}
-		if (node->left) enqueue(&q, node->left);
-		if (node->right) enqueue(&q, node->right);
-	}
-	freeQueue(&q);
-	q.front = q.rear = NULL;
-	return NULL;
-}
-
-
-PokemonNode *removeNodeBST(PokemonNode *root, int id) {
-	if (!root || id < LOWEST_ID || id > HIGHEST_ID) return NULL;
-	if (id < root->data->id) root->left = removeNodeBST(root->left, id);
-	else if (id > root->data->id) root->right = removeNodeBST(root->right, id);
-	else {
-		if (!root->left && !root->right) {
-			freePokemonNode(root);
-			return NULL;
-		} else if (!root->left) {
-			PokemonNode *temp = root->right;
-			freePokemonNode(root);
-			return temp;
-		} else if (!root->right) {
-			PokemonNode *temp = root->left;
-			freePokemonNode(root);
-			return temp;
-		} else {
-			PokemonNode *temp = root->right;
-			while (temp->left) temp = temp->left;
-			root->data = temp->data;
-			root->right = removeNodeBST(root->right, temp->data->id);
-		}
-	}
-	return root;
-}
-
-
-PokemonNode *removePokemonByID(PokemonNode *root, int id) {
-	if (!searchPokemonBFS(root, id)) return root;
-	return removeNodeBST(root, id);
-}
-
-
-void freePokemon(OwnerNode *owner) {
-	if (!owner->pokedexRoot) {
+void freePokemon(PokedexContext *ctx, OwnerNode *owner) {
+	if (!owner->pokedex.live) {
 		printf("No Pokemon to release.\n");
 		return;
 	}
-	int id = readIntSafe("Enter Pokemon ID to release: ");
-	if (id < LOWEST_ID || id > HIGHEST_ID) {
+	int id = readSpeciesSafe("Enter Pokemon ID to release: ");
+	if (pkReleasePokemon(ctx, owner->handle, id) != PK_OK) {
 		printf("No Pokemon with ID %d found.\n", id);
 		return;
 	}
-	PokemonNode *temp = owner->pokedexRoot;
-	PokemonNode *pokemon = NULL;
-	do {
-		if (temp->data->id == id) {
-			pokemon = temp;
-			break;
-		}
-		temp = temp->right;
-	} while (temp != owner->pokedexRoot);
-	if (!pokemon) {
-		printf("No Pokemon with ID %d found.\n", id);
+	printf("Removing Pokemon %s (ID %d).\n", speciesById(id)->name, id);
+}
+
+
+void bulkReleaseMenu(PokedexContext *ctx, OwnerNode *owner) {
+	if (!owner->pokedex.live) {
+		printf("No Pokemon to release.\n");
 		return;
 	}
-	printf("Removing Pokemon %s (ID %d).\n", pokemon->data->name, id);
-	if (pokemon->left == pokemon && pokemon->right == pokemon) {
-		owner->pokedexRoot = NULL;
-		freePokemonNode(pokemon);
+	menuText("Release which Pokemon (e.g. 100-151, 1,4,7, BUG, hp<50): ");
+	char *text = getDynamicInput();
+	if (!text) return;
+	SpeciesFilter filter;
+	const char *bad = NULL;
+	int ok = parseSpeciesFilter(text, &filter, &bad);
+	if (!ok) printf("Invalid filter term '%.*s'.\n", (int)strcspn(bad, " \t"), bad);
+	free(text);
+	if (!ok) return;
+	uint64_t *mask = (uint64_t *)malloc(catalog.wordCount * sizeof(uint64_t));
+	uint16_t *gone = (uint16_t *)malloc(owner->pokedex.live * sizeof(uint16_t));
+	if (!mask || !gone) {
+		printf("Memory allocation failed.\n");
+		freeSpeciesFilter(&filter);
+		free(mask);
+		free(gone);
 		return;
 	}
-	pokemon->left->right = pokemon->right;
-	pokemon->right->left = pokemon->left;
-	if (pokemon == owner->pokedexRoot)
-		owner->pokedexRoot = pokemon->right;
-	freePokemonNode(pokemon);
-}
-
-void freePokemonNode(PokemonNode *node) {
-	if (!node) return;
-	node->data = NULL;
-	node->left = node->right = NULL;
-	free(node);
+	evaluateSpeciesFilter(&filter, mask);
+	freeSpeciesFilter(&filter);
+	int released = releaseMatching(ctx, owner, mask, gone);
+	for (int i = 0; i < released; i++)
+		printf("Removing Pokemon %s (ID %d).\n", catalog.species[gone[i]].name, catalog.species[gone[i]].id);
+	free(mask);
+	free(gone);
+	if (!released) printf("No matching Pokemon found.\n");
+	else printf("Released %d Pokemon.\n", released);
 }
 
 
 void displayBFS(PokemonNode *root) {
-	if (!root) return;
-	Queue q;
-	initQueue(&q);
-	enqueue(&q, root);
-	while (q.front) {
-		PokemonNode *node = dequeue(&q);
-		printPokemonNode(node);
-		if (node->left) enqueue(&q, node->left);
-		if (node->right) enqueue(&q, node->right);
-	}
-	freeQueue(&q);
+	if (!BFSGeneric(root, printPokemonNode)) printf("Memory allocation failed.\n");
 }
 
 
 void pokemonFight(OwnerNode *owner) {
-	if (!owner->pokedexRoot) {
+	if (!owner->pokedex.live) {
 		printf("Pokedex is empty.\n");
 		return;
 	}
-	PokemonNode *tree = pokemonCircleToTree(owner->pokedexRoot);
-	int id1 = readIntSafe("Enter ID of the first Pokemon: ");
-	int id2 = readIntSafe("Enter ID of the second Pokemon: ");
-	PokemonNode *p1 = searchPokemonBFS(tree, id1);
-	PokemonNode *p2 = searchPokemonBFS(tree, id2);
-	if (!p1 || !p2) {
+	int id1 = readSpeciesSafe("Enter ID of the first Pokemon: ");
+	int id2 = readSpeciesSafe("Enter ID of the second Pokemon: ");
+	const PokemonData *p1 = speciesById(id1);
+	const PokemonData *p2 = speciesById(id2);
+	if (!p1 || !p2 || !ownerHasSpecies(owner, p1) || !ownerHasSpecies(owner, p2)) {
 		printf("One or both Pokemon IDs not found.\n");
-		freePokemonTree(&tree);
 		return;
 	}
-	double score1 = p1->data->attack * 1.5 + p1->data->hp * 1.2;
-	double score2 = p2->data->attack * 1.5 + p2->data->hp * 1.2;
-	printf("Pokemon 1: %s (Score = %.2f)\n", p1->data->name, score1);
-	printf("Pokemon 2: %s (Score = %.2f)\n", p2->data->name, score2);
-	if (score1 > score2) printf("%s wins!\n", p1->data->name);
-	else if (score2 > score1) printf("%s wins!\n", p2->data->name);
+	double score1 = p1->attack * 1.5 + p1->hp * 1.2;
+	double score2 = p2->attack * 1.5 + p2->hp * 1.2;
+	printf("Pokemon 1: %s (Score = %.2f)\n", p1->name, score1);
+	printf("Pokemon 2: %s (Score = %.2f)\n", p2->name, score2);
+	if (score1 > score2) printf("%s wins!\n", p1->name);
+	else if (score2 > score1) printf("%s wins!\n", p2->name);
 	else printf("It's a tie!\n");
-	freePokemonTree(&tree);
 }
 
 
-void evolvePokemon(OwnerNode *owner) {
-	if (!owner->pokedexRoot) {
+void evolvePokemon(PokedexContext *ctx, OwnerNode *owner) {
+	if (!owner->pokedex.live) {
 		printf("Cannot evolve. Pokedex empty.\n");
 		return;
 	}
-	int idToEvolve = readIntSafe("Enter ID of Pokemon to evolve: ");
-	PokemonNode *pokemon = owner->pokedexRoot;
-	PokemonNode *tree = pokemonCircleToTree(pokemon);
-	if (idToEvolve < 1 || idToEvolve > 151 || !searchPokemonBFS(tree, idToEvolve)) {
-		printf("No Pokemon with ID %d found.\n", idToEvolve);
-		freePokemonTree(&tree);
+	int idToEvolve = readSpeciesSafe("Enter ID of Pokemon to evolve: ");
+	int evolvedId = 0;
+	switch (pkEvolvePokemon(ctx, owner->handle, idToEvolve, &evolvedId)) {
+		case PK_OK:
+			printf("Pokemon evolved from %s (ID %d) to %s (ID %d).\n",
+				speciesById(idToEvolve)->name,
+				idToEvolve,
+				speciesById(evolvedId)->name,
+				evolvedId);
+			break;
+		case PK_EXISTS:
+			printf("Pokemon evolved from %s (ID %d) to %s (ID %d), which is already in the Pokedex; released.\n",
+				speciesById(idToEvolve)->name,
+				idToEvolve,
+				speciesById(evolvedId)->name,
+				evolvedId);
+			break;
+		case PK_CANNOT_EVOLVE: printf("Cannot evolve.\n"); break;
+		case PK_NO_MEMORY: printf("Memory allocation failed.\n"); break;
+		default: printf("No Pokemon with ID %d found.\n", idToEvolve);
+	}
+}
+
+
+void evolveAllMenu(PokedexContext *ctx, OwnerNode *owner, int toFinal) {
+	if (!owner->pokedex.live) {
+		printf("Cannot evolve. Pokedex empty.\n");
 		return;
 	}
-	freePokemonTree(&tree);
-	if (!pokedex[idToEvolve].CAN_EVOLVE) {
-		printf("Cannot evolve.\n");
+	EvolveChange *changes = (EvolveChange *)malloc((owner->pokedex.live + 1) * sizeof(EvolveChange));
+	int evolved = changes ? evolveAllInPokedex(ctx, owner, toFinal, changes, NULL) : -1;
+	if (evolved < 0) {
+		printf("Memory allocation failed.\n");
+		free(changes);
 		return;
 	}
+	for (const EvolveChange *c = changes; c->from; c++) {
+		const PokemonData *from = c->from;
+		if (c->to) {
+			printf("Pokemon evolved from %s (ID %d) to %s (ID %d).\n", from->name, from->id, c->to->name, c->to->id);
+			continue;
+		}
+		int index = (int)(from - catalog.species);
+		int target = toFinal ? catalog.finalStage[index] : catalog.nextStage[index];
+		if (target >= 0 && target != index)
+			printf("Pokemon evolved from %s (ID %d) to %s (ID %d), which is already in the Pokedex; released.\n",
+				from->name, from->id, catalog.species[target].name, catalog.species[target].id);
+		else printf("Removing duplicate Pokemon %s (ID %d).\n", from->name, from->id);
+	}
+	free(changes);
+	if (!evolved) printf("Nothing to evolve.\n");
+}
+
+
+void evolveAllOwners(PokedexContext *ctx) {
+	if (!ctx->ownerHead) {
+		printf("No existing Pokedexes.\n");
+		return;
+	}
+	menuText("Evolve:\n"
+	"1. One stage\n"
+	"2. To final form\n");
+	int choice = readIntSafe("Your choice: ");
+	if (choice != 1 && choice != 2) {
+		printf("Invalid choice.\n");
+		return;
+	}
+	long long evolvedTotal = 0;
+	long long releasedTotal = 0;
+	OwnerNode *owner = ctx->ownerHead;
 	do {
-		if (pokemon->data->id == idToEvolve) {
-			printf("Pokemon evolved from %s (ID %d) to %s (ID %d).\n",
-				pokemon->data->name,
-				idToEvolve,
-				pokedex[idToEvolve].name,
-				pokedex[idToEvolve].id);
-			pokemon->data = &pokedex[idToEvolve];
-			return;
+		int released = 0;
+		int evolved = evolveAllInPokedex(ctx, owner, choice == 2, NULL, &released);
+		if (evolved < 0) {
+			printf("Memory allocation failed.\n");
+			evolved = 0;
 		}
-		pokemon = pokemon->right;
-	} while (pokemon != owner->pokedexRoot);
+		if (evolved || released)
+			printf("%s: %d evolved, %d duplicate%s released.\n", owner->ownerName, evolved, released, released == 1 ? "" : "s");
+		evolvedTotal += evolved;
+		releasedTotal += released;
+		owner = nextOwner(ctx, owner);
+	} while (owner != ctx->ownerHead);
+	printf("%lld Pokemon evolved, %lld duplicates released.\n", evolvedTotal, releasedTotal);
 }
 
 
@@ -665,20 +568,20 @@ void evolvePokemon(OwnerNode *owner) {
 // New Pokedex
 // --------------------------------------------------------------
 int computeStarterID(int menuChoice) {
-	return (menuChoice * 3) - 3;
+	return (menuChoice * 3) - 2;
 }
 
 
-void openPokedexMenu(void) {
-	printf("Your name: ");
+void openPokedexMenu(PokedexContext *ctx) {
+	menuText("Your name: ");
 	char *ownerName = getDynamicInput();
 	if (!ownerName) return;
-	if (findOwnerByName(ownerName)) {
+	if (pkFindOwner(ctx, ownerName, NULL) == PK_OK) {
 		printf("Owner '%s' already exists. Not creating a new Pokedex.\n", ownerName);
 		free(ownerName);
 		return;
 	}
-	printf("Choose Starter:\n"
+	menuText("Choose Starter:\n"
 				"1. Bulbasaur\n"
 				"2. Charmander\n"
 				"3. Squirtle\n");
@@ -688,48 +591,36 @@ void openPokedexMenu(void) {
 		printf("Invalid choice.\n");
 		return;
 	}
-	PokemonNode *starter = createPokemonNode(&pokedex[computeStarterID(menuChoice)]);
-	if (!starter) {
-		free(ownerName);
-		return;
-	}
-	starter->left = starter->right = starter;
-	OwnerNode *ownerNode = createOwner(ownerName, starter);
-	if (!ownerNode) {
-		freePokemonNode(starter);
-		free(ownerName);
-		return;
-	}
-	if (!ownerHead) ownerHead = ownerNode->prev = ownerNode->next = ownerNode;
-	else linkOwnerInCircularList(ownerNode);
-	printf("New Pokedex created for %s with starter %s.\n", ownerName, starter->data->name);
-}
-
-
-void linkOwnerInCircularList(OwnerNode *newOwner) {
-	newOwner->prev = ownerHead->prev;
-	newOwner->next = ownerHead;
-	ownerHead->prev->next = newOwner;
-	ownerHead->prev = newOwner;
+	int starterId = computeStarterID(menuChoice);
+	uint32_t handle;
+	PokedexStatus status = pkNewOwner(ctx, ownerName, starterId, &handle);
+	free(ownerName);
+	if (status == PK_INVALID) printf("Invalid choice.\n");
+	else if (status == PK_NO_MEMORY) printf("Memory allocation failed.\n");
+	if (status != PK_OK) return;
+	printf("New Pokedex created for %s with starter %s.\n", ownerByHandle(ctx, handle)->ownerName, speciesById(starterId)->name);
 }
 
 
-void removeOwnerFromCircularList(OwnerNode *owner) {
-	if (!owner || !ownerHead) return;
-	if (owner->next == owner && owner->prev == owner) {
-		ownerHead = NULL;
-		return;
-	}
-	if (owner->prev && owner->next) {
-		owner->prev->next = owner->next;
-		owner->next->prev = owner->prev;
+// Add one to the decimal number in [first, end); returns the new first digit.
+// The caller leaves room before first for the number to grow.
+static char *incrementDecimal(char *first, char *end) {
+	char *p = end;
+	while (p > first) {
+		--p;
+		if (*p != '9') {
+			(*p)++;
+			return first;
+		}
+		*p = '0';
 	}
-	if (ownerHead == owner) ownerHead = owner->next;
+	*--first = '1';
+	return first;
 }
 
 
-void printOwnersCircular(OwnerNode *owner) {
-	if (!(ownerHead && owner)) {
+void printOwnersCircular(PokedexContext *ctx, OwnerNode *owner) {
+	if (!(ctx->ownerHead && owner)) {
 		printf("No owners.\n");
 		return;
 	}
@@ -738,273 +629,1251 @@ void printOwnersCircular(OwnerNode *owner) {
 	int repeatCount = 0;
 	repeatCount = readIntSafe("How many prints? ");
 	if (repeatCount <= 0) return;
-	OwnerNode *temp = ownerHead;
-	for (int i = 0; i < repeatCount; i++) {
-		printf("[%d] %s\n", i + 1, temp->ownerName);
-		if (direction == 'f') temp = temp->next;
-		else temp = temp->prev;
-	}
-}
-
 
-OwnerNode *findOwnerByName(const char *name) {
-	if (!ownerHead) return NULL;
-	OwnerNode *node = ownerHead;
-	while(strcmp(node->ownerName, name) != 0) {
-		if (node->next == ownerHead) return NULL;
-		node = node->next;
+	// Render "] name\n" for each owner once, in walk order; every print after
+	// that is a counter plus a copy of the next line of the cycle.
+	int count = ringLength(ctx);
+	size_t *start = (size_t *)malloc(((size_t)count + 1) * sizeof(size_t));
+	char *out = (char *)malloc(PRINT_BUFFER);
+	size_t total = 0;
+	OwnerNode *temp = ctx->ownerHead;
+	for (int i = 0; i < count; i++) {
+		total += temp->nameLength + 3;
+		temp = direction == 'f' ? nextOwner(ctx, temp) : prevOwner(ctx, temp);
+	}
+	char *cycle = (char *)malloc(total);
+	if (!(start && out && cycle)) {
+		printf("Memory allocation failed.\n");
+		free(start);
+		free(out);
+		free(cycle);
+		return;
 	}
-	return node;
+	size_t at = 0;
+	temp = ctx->ownerHead;
+	for (int i = 0; i < count; i++) {
+		size_t len = temp->nameLength;
+		start[i] = at;
+		cycle[at++] = ']';
+		cycle[at++] = ' ';
+		memcpy(cycle + at, temp->ownerName, len);
+		at += len;
+		cycle[at++] = '\n';
+		temp = direction == 'f' ? nextOwner(ctx, temp) : prevOwner(ctx, temp);
+	}
+	start[count] = at;
+
+	// The counter is kept as text and bumped in place instead of reformatted.
+	char counter[INT_BUFFER];
+	char *end = counter + sizeof(counter);
+	char *first = end - 1;
+	*first = '1';
+	size_t used = 0;
+	int ok = 1;
+	fflush(stdout);
+	for (int i = 0, k = 0; ok && i < repeatCount; i++) {
+		size_t digits = (size_t)(end - first);
+		size_t len = start[k + 1] - start[k];
+		if (used + 1 + digits + len > PRINT_BUFFER) {
+			ok = writeOutput(out, used);
+			used = 0;
+		}
+		out[used++] = '[';
+		memcpy(out + used, first, digits);
+		used += digits;
+		if (len > PRINT_BUFFER - used) {
+			// a name longer than the buffer goes out on its own
+			ok = ok && writeOutput(out, used) && writeOutput(cycle + start[k], len);
+			used = 0;
+		} else {
+			memcpy(out + used, cycle + start[k], len);
+			used += len;
+		}
+		first = incrementDecimal(first, end);
+		if (++k == count) k = 0;
+	}
+	if (ok && used) writeOutput(out, used);
+	free(start);
+	free(out);
+	free(cycle);
 }
 
 
-void ownerByNumber(OwnerNode **owner, int ifDelete) {
-	if (!ownerHead) return;
-	*owner = ownerHead;
+void ownerByNumber(PokedexContext *ctx, OwnerNode **owner, int ifDelete) {
+	if (!ctx->ownerHead) return;
+	*owner = ctx->ownerHead;
 	int ind = 0;
 	int select = 0;
 	do {
-		printf("%d. %s\n", ++ind, (*owner)->ownerName);
-		*owner = (*owner)->next;
-	} while (*owner != ownerHead);
+		menuText("%d. %s\n", ++ind, (*owner)->ownerName);
+		*owner = nextOwner(ctx, *owner);
+	} while (*owner != ctx->ownerHead);
 	if (ifDelete) select = readIntSafe("Choose a Pokedex to delete by number: ");
 	else select = readIntSafe("Choose a Pokedex by number: ");
 	if (select >= 1 && select <= ind) {
 		ind = 0;
-		while (++ind != select) *owner = (*owner)->next;
+		while (++ind != select) *owner = nextOwner(ctx, *owner);
 	}
 }
 
 
-void deletePokedex(void) {
-	if (!ownerHead) {
+void deletePokedex(PokedexContext *ctx) {
+	if (!ctx->ownerHead) {
 		printf("No existing Pokedexes to delete.\n");
 		return;
 	}
 	OwnerNode *owner = NULL;
-	printf("\n=== Delete a Pokedex ===\n");
-	ownerByNumber(&owner, DELETE_POKEDEX);
+	menuText("\n=== Delete a Pokedex ===\n");
+	ownerByNumber(ctx, &owner, DELETE_POKEDEX);
 	if (!owner) return;
-	if (owner == ownerHead) {
-		if (ownerHead->next != ownerHead) ownerHead = ownerHead->next;
-		else ownerHead = NULL;
-	}
 	printf("Deleting %s's entire Pokedex...\n", owner->ownerName);
-	freeOwnerNode(owner);
-	free(owner);
+	pkDeleteOwner(ctx, owner->handle);
 	printf("Pokedex deleted.\n");
 }
 
 
-void ownerByName(OwnerNode **owner, int whichOwner) {
-	if (!ownerHead) {
+void ownerByName(PokedexContext *ctx, OwnerNode **owner, int whichOwner) {
+	if (!ctx->ownerHead) {
 		*owner = NULL;
 		return; 
 	}
-	if (whichOwner == MERGE_DESTINATION) printf("Enter name of first owner: ");
-	else if (whichOwner == MERGE_SOURCE) printf("Enter name of second owner: ");
+	if (whichOwner == MERGE_DESTINATION) menuText("Enter name of first owner: ");
+	else if (whichOwner == MERGE_SOURCE) menuText("Enter name of second owner: ");
 	else return;  // should never be reached / defensive
 	char *name = getDynamicInput();
 	if (!name) {
 		*owner = NULL;
 		return;
 	}
-	OwnerNode *cur = ownerHead;
-	do {
-		if (strcmp(cur->ownerName, name) == 0) {
-			*owner = cur;
-			free(name);
-			return;
-		}
-		cur = cur->next;
-	} while (cur != ownerHead);
+	*owner = findOwnerByName(ctx, name);
 	free(name);
-	*owner = NULL;
 }
 
 
-void mergePokedexMenu(void) {
-	if (!ownerHead || ownerHead->next == ownerHead) {
+void mergePokedexMenu(PokedexContext *ctx) {
+	if (!ctx->ownerHead || ctx->ownerHead->next == ctx->ownerHead->handle) {
 		printf("Not enough owners to merge.\n");
 		return;
 	}
 	OwnerNode *dst = NULL;
 	OwnerNode *src = NULL;
-	printf("\n=== Merge Pokedexes ===\n");
-	ownerByName(&dst, MERGE_DESTINATION);
-	ownerByName(&src, MERGE_SOURCE);
+	menuText("\n=== Merge Pokedexes ===\n");
+	ownerByName(ctx, &dst, MERGE_DESTINATION);
+	ownerByName(ctx, &src, MERGE_SOURCE);
 	if (!dst || !src) {
 		printf("One or both owners not found.\n");
 		return;
 	}
-	printf("Merging %s and %s...\n"
-				"Merge completed.\n"
-				"Owner '%s' has been removed after merging.\n",
-		dst->ownerName,
-		src->ownerName, src->ownerName
-	);
-	if (dst == src || !src->pokedexRoot) {
-		freeOwnerNode(src);
-		free(src);
-		src = NULL;
+	// src may be freed by the merge, so its name is copied first
+	char *srcName = myStrdup(src->ownerName);
+	if (!srcName) {
+		printf("Memory allocation failed.\n");
+		return;
+	}
+	printf("Merging %s and %s...\n", dst->ownerName, srcName);
+	// naming the same owner twice deletes it, as it always has
+	PokedexStatus status = dst == src ? pkDeleteOwner(ctx, src->handle)
+		: pkMergeOwners(ctx, dst->handle, src->handle);
+	if (status == PK_OK) printf("Merge completed.\nOwner '%s' has been removed after merging.\n", srcName);
+	else printf("Merge failed: not enough memory. No changes made.\n");
+	free(srcName);
+}
+
+
+void addPokemon(PokedexContext *ctx, OwnerNode *owner) {
+	int id = readSpeciesSafe("Enter ID to add: ");
+	switch (pkAddPokemon(ctx, owner->handle, id)) {
+		case PK_OK: printf("Pokemon %s (ID %d) added.\n", speciesById(id)->name, id); break;
+		case PK_INVALID: printf("Invalid ID.\n"); break;
+		case PK_EXISTS: printf("Pokemon with ID %d is already in the Pokedex. No changes made.\n", id); break;
+		case PK_NO_MEMORY: printf("Memory allocation failed.\n"); break;
+		default: break;
+	}
+}
+
+
+// --------------------------------------------------------------
+// Species Catalog
+// --------------------------------------------------------------
+
+
+void suggestSpecies(const char *prefix) {
+	int first = 0;
+	int total = speciesByPrefix(prefix, &first);
+	int shown = total < SUGGEST_LIMIT ? total : SUGGEST_LIMIT;
+	for (int k = first; k < first + shown; k++) {
+		const PokemonData *data = &catalog.species[catalog.byName[k]];
+		printf("%s (ID %d)\n", data->name, data->id);
+	}
+	if (!total) printf("No species match '%s'.\n", prefix);
+	else if (total > shown) printf("... and %d more.\n", total - shown);
+}
+
+
+// --------------------------------------------------------------
+// Materialized Statistics
+// --------------------------------------------------------------
+
+
+static void printTypeCounts(const long long *counts) {
+	printf("By type:");
+	int any = 0;
+	for (int t = 0; t < TYPE_COUNT; t++) {
+		if (!counts[t]) continue;
+		printf("%s%s %lld", any ? ", " : " ", getTypeName((PokemonType)t), counts[t]);
+		any = 1;
+	}
+	printf("%s\n", any ? "" : " none");
+}
+
+
+void printGlobalStats(PokedexContext *ctx) {
+	printf("Owners: %d\n", ctx->summary.ownerCount);
+	printf("Pokemon: %lld\n", ctx->summary.pokemonCount);
+	printf("Total fight score: %.2f\n", ctx->summary.totalScore10 / 10.0);
+	if (ctx->summary.bestSpecies >= 0) {
+		const PokemonData *best = &catalog.species[ctx->summary.bestSpecies];
+		printf("Best fight score: %.2f (%s)\n", fightScore10(best) / 10.0, best->name);
+	} else printf("Best fight score: none\n");
+	printf("Catalog coverage: %d/%d species (%.2f%%)\n",
+		ctx->summary.speciesCovered, catalog.count, 100.0 * ctx->summary.speciesCovered / catalog.count);
+	printTypeCounts(ctx->summary.typeCount);
+}
+
+
+void printOwnerStats(PokedexContext *ctx) {
+	if (!ctx->ownerHead) {
+		printf("No existing Pokedexes.\n");
+		return;
+	}
+	OwnerNode *owner = NULL;
+	ownerByNumber(ctx, &owner, CHOOSE_POKEDEX);
+	if (!owner) return;
+	const OwnerStats *s = &owner->stats;
+	printf("%s: %d Pokemon\n", owner->ownerName, s->pokemonCount);
+	printf("Total fight score: %.2f\n", s->totalScore10 / 10.0);
+	if (s->bestScore10 >= 0) printf("Best fight score: %.2f\n", s->bestScore10 / 10.0);
+	else printf("Best fight score: none\n");
+	printf("Catalog coverage: %d/%d species (%.2f%%)\n",
+		s->pokemonCount, catalog.count, 100.0 * s->pokemonCount / catalog.count);
+	long long counts[TYPE_COUNT];
+	for (int t = 0; t < TYPE_COUNT; t++) counts[t] = s->typeCount[t];
+	printTypeCounts(counts);
+}
+
+
+// --------------------------------------------------------------
+// Leaderboards
+// --------------------------------------------------------------
+
+
+void printLeaderboard(PokedexContext *ctx) {
+	int k = readIntSafe("How many? ");
+	if (k <= 0) return;
+	int most = catalog.count > ctx->summary.ownerCount ? catalog.count : ctx->summary.ownerCount;
+	if (k > most) k = most;
+	int *species = (int *)malloc(k * sizeof(int));
+	OwnerNode **trainers = (OwnerNode **)malloc(k * sizeof(OwnerNode *));
+	if (!species || !trainers) {
+		printf("Memory allocation failed.\n");
+		free(species);
+		free(trainers);
 		return;
 	}
-	PokemonNode *dstTree = pokemonCircleToTree(dst->pokedexRoot);
-	PokemonNode *srcTree = pokemonCircleToTree(src->pokedexRoot);
-	if (!srcTree) {
-		freePokemonTree(&dstTree);
-		freeOwnerNode(src);
-		free(src);
+	int n = topSpecies(ctx, species, k);
+	printf("Strongest Pokemon:\n");
+	if (!n) printf("none\n");
+	for (int i = 0; i < n; i++) {
+		const PokemonData *data = &catalog.species[species[i]];
+		uint32_t owners = ctx->registry.speciesOwners[species[i]].count;
+		printf("%d. %s %.2f (%u owner%s)\n", i + 1, data->name, fightScore10(data) / 10.0, owners, owners == 1 ? "" : "s");
+	}
+	n = topTrainers(ctx, trainers, k);
+	printf("Strongest trainers (total fight score):\n");
+	if (!n) printf("none\n");
+	for (int i = 0; i < n; i++)
+		printf("%d. %s %.2f (%d Pokemon)\n", i + 1, trainers[i]->ownerName,
+			trainers[i]->stats.totalScore10 / 10.0, trainers[i]->stats.pokemonCount);
+	free(species);
+	free(trainers);
+}
+
+
+void printTrainerRank(PokedexContext *ctx) {
+	if (!ctx->ownerHead) {
+		printf("No existing Pokedexes.\n");
 		return;
 	}
-	Queue q;
-	initQueue(&q);
-	enqueue(&q, srcTree);
-	while (q.front) {
-		PokemonNode *n = dequeue(&q);
-		if (!searchPokemonBFS(dstTree, n->data->id)) {
-			PokemonNode *c = createPokemonNode(n->data);
-			if (!c) break;
-			c->left = c->right = c;
-			linkToPokedex(&(dst->pokedexRoot), c);
+	OwnerNode *owner = NULL;
+	ownerByNumber(ctx, &owner, CHOOSE_POKEDEX);
+	if (!owner) return;
+	int rank = trainerRank(ctx, owner);
+	if (!rank) printf("%s has no Pokemon and is not ranked.\n", owner->ownerName);
+	else printf("%s is #%d of %u trainers (total fight score %.2f).\n", owner->ownerName, rank,
+		leaderboardSize(ctx), owner->stats.totalScore10 / 10.0);
+}
+
+
+// --------------------------------------------------------------
+// Dump All Owners
+// --------------------------------------------------------------
+typedef struct
+{
+	char *data;
+	size_t length;
+	size_t capacity;
+	int ok;
+} DumpBuffer;
+
+// Shared by the writer (the calling thread) and the render workers.
+// Chunk c covers order[c * DUMP_CHUNK ..] and renders into buffers[c].
+typedef struct
+{
+	const uint32_t *order;
+	int count;
+	int chunks;
+	int mode;                 // displayMenu choice: 1 BFS .. 5 alphabetical
+	const char *lines;        // every species' display line, pre-rendered
+	const size_t *lineStart;  // species index -> offset in lines; [catalog.count] is the end
+	const uint16_t *alphaRank;   // species index -> position by name
+	const uint16_t *byAlpha;     // position by name -> species index
+	DumpBuffer *buffers;
+	char *ready;              // chunk c is rendered
+	int next;                 // next chunk to claim
+	int written;              // chunks already written out
+	int window;               // workers stay at most this far ahead of the writer
+	PokedexContext *context;  // the caller's Pokedex, adopted by the workers
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+} DumpJob;
+
+
+static int dumpAppend(DumpBuffer *out, const char *text, size_t len) {
+	if (!out->ok) return 0;
+	if (out->length + len > out->capacity) {
+		size_t capacity = out->capacity ? out->capacity : PRINT_BUFFER;
+		while (capacity < out->length + len) capacity *= 2;
+		char *data = (char *)realloc(out->data, capacity);
+		if (!data) {
+			out->ok = 0;
+			return 0;
 		}
-		if (n->left) enqueue(&q, n->left);
-		if (n->right) enqueue(&q, n->right);
+		out->data = data;
+		out->capacity = capacity;
 	}
-	freeQueue(&q);
-	freePokemonTree(&srcTree);
-	freePokemonTree(&dstTree);
-	freeOwnerNode(src);
-	free(src);
+	memcpy(out->data + out->length, text, len);
+	out->length += len;
+	return 1;
 }
 
 
-OwnerNode *createOwner(char *ownerName, PokemonNode *starter) {
-	if (!(ownerName || starter)) return NULL; 
-	OwnerNode *owner = (OwnerNode *)malloc(sizeof(OwnerNode));
-	if (!owner) return NULL;
-	owner->ownerName = ownerName;
-	owner->pokedexRoot = starter;
-	owner->prev = ownerHead ? ownerHead->prev : owner;
-	owner->next = ownerHead ? ownerHead : owner;
-	return owner;
+static void dumpSpecies(const DumpJob *job, DumpBuffer *out, int index) {
+	dumpAppend(out, job->lines + job->lineStart[index], job->lineStart[index + 1] - job->lineStart[index]);
 }
 
 
-void freeAllOwners(void) {
-	if (!ownerHead) return;
-	OwnerNode *head = ownerHead;
-	OwnerNode *curr = head->next;
-	OwnerNode *next;
-	while (curr != head) {
-		next = curr->next;
-		freeOwnerNode(curr);
-		free(curr);
-		curr = next;
+static int compareUint16(const void *a, const void *b) {
+	return (int)*(const uint16_t *)a - (int)*(const uint16_t *)b;
+}
+
+
+// One owner, as displayMenu would print it, plus a heading line.
+// scratch holds at least pokedex.live entries.
+static void dumpOwner(const DumpJob *job, DumpBuffer *out, const OwnerNode *owner, uint16_t *scratch) {
+	dumpAppend(out, "=== ", 4);
+	dumpAppend(out, owner->ownerName, owner->nameLength);
+	dumpAppend(out, " ===\n", 5);
+	const Pokedex *dex = &owner->pokedex;
+	if (!dex->live) {
+		dumpAppend(out, "Pokedex is empty.\n", 18);
+		return;
+	}
+	if (job->mode == 3 || job->mode == 5) {
+		// in-order is ID order and alphabetical is name order: a sort, no tree
+		int n = 0;
+		for (int i = 0; i < dex->length; i++) {
+			if (dex->slots[i] == SPECIES_TOMBSTONE) continue;
+			scratch[n++] = job->mode == 3 ? dex->slots[i] : job->alphaRank[dex->slots[i]];
+		}
+		qsort(scratch, n, sizeof(uint16_t), compareUint16);
+		for (int i = 0; i < n; i++) dumpSpecies(job, out, job->mode == 3 ? scratch[i] : job->byAlpha[scratch[i]]);
+		return;
+	}
+	static const TraversalOrder orders[] = { ORDER_BFS, ORDER_PRE, ORDER_IN, ORDER_POST };
+	PokemonNode *root = pokedexToTree(dex);
+	if (!root) {
+		out->ok = 0;
+		return;
 	}
-	freeOwnerNode(head);
-	free(head);
-	ownerHead = NULL;
+	TreeIter it;
+	treeIterInit(&it, root, orders[job->mode - 1]);
+	PokemonNode *batch[TREE_ITER_INLINE];
+	int n;
+	while ((n = treeIterNextBatch(&it, batch, TREE_ITER_INLINE)) > 0)
+		for (int i = 0; i < n; i++) dumpSpecies(job, out, (int)(batch[i]->data - catalog.species));
+	if (n < 0) out->ok = 0;  // part of this owner is missing; the dump reports it
+	treeIterFree(&it);
+	freePokedexTree(&root);
 }
 
 
-void freeOwnerNode(OwnerNode *owner) {
-	if (!owner) return;
-	free(owner->ownerName);
-	owner->ownerName = NULL;
-	removeOwnerFromCircularList(owner);
-	if (!owner->pokedexRoot) return;
-	PokemonNode *root = owner->pokedexRoot;
-	PokemonNode *pokemon = root->right;
-	PokemonNode *next;
-	while (pokemon != root) {
-		pokemon->left->right = pokemon->right;
-		pokemon->right->left = pokemon->left;
-		next = pokemon->right;
-		freePokemonNode(pokemon);
-		pokemon = next;
-	}
-	freePokemonNode(root);
-	owner->pokedexRoot = NULL;  // free owner in caller
-}
-
-
-void addPokemon(OwnerNode *owner) {
-	int id = readIntSafe("Enter ID to add: ");
-	if (id < LOWEST_ID || id > HIGHEST_ID) {
+static void dumpChunk(DumpJob *job, int chunk) {
+	PokedexContext *ctx = job->context;
+	DumpBuffer *out = &job->buffers[chunk];
+	out->ok = 1;
+	int first = chunk * DUMP_CHUNK;
+	int last = first + DUMP_CHUNK < job->count ? first + DUMP_CHUNK : job->count;
+	int longest = 0;
+	for (int i = first; i < last; i++) {
+		int live = ownerByHandle(ctx, job->order[i])->pokedex.live;
+		if (live > longest) longest = live;
+	}
+	uint16_t *scratch = (uint16_t *)malloc((longest + 1) * sizeof(uint16_t));
+	if (!scratch) {
+		out->ok = 0;
+		return;
+	}
+	for (int i = first; i < last && out->ok; i++) dumpOwner(job, out, ownerByHandle(ctx, job->order[i]), scratch);
+	free(scratch);
+}
+
+
+static void *dumpWorker(void *arg) {
+	DumpJob *job = (DumpJob *)arg;
+	pthread_mutex_lock(&job->lock);
+	while (job->next < job->chunks) {
+		int chunk = job->next;
+		if (chunk >= job->written + job->window) {
+			pthread_cond_wait(&job->changed, &job->lock);
+			continue;
+		}
+		job->next++;
+		pthread_mutex_unlock(&job->lock);
+		dumpChunk(job, chunk);
+		pthread_mutex_lock(&job->lock);
+		job->ready[chunk] = 1;
+		pthread_cond_broadcast(&job->changed);
+	}
+	pthread_mutex_unlock(&job->lock);
+	return NULL;
+}
+
+
+// Pre-render every species line and the name order once, so workers only copy.
+static int dumpPrepare(DumpJob *job, char **lines, size_t **lineStart, uint16_t **alpha) {
+	*lineStart = (size_t *)malloc((catalog.count + 1) * sizeof(size_t));
+	*alpha = (uint16_t *)malloc(2 * catalog.count * sizeof(uint16_t));
+	size_t total = 0;
+	for (int i = 0; i < catalog.count; i++) total += strlen(catalog.species[i].name) + 96;
+	*lines = (char *)malloc(total);
+	if (!*lineStart || !*alpha || !*lines) return 0;
+	size_t at = 0;
+	for (int i = 0; i < catalog.count; i++) {
+		const PokemonData *data = &catalog.species[i];
+		(*lineStart)[i] = at;
+		at += (size_t)snprintf(*lines + at, total - at, "ID: %d, Name: %s, Type: %s, HP: %d, Attack: %d, Can Evolve: %s\n",
+			data->id, data->name, getTypeName(data->TYPE), data->hp, data->attack,
+			(data->CAN_EVOLVE == CAN_EVOLVE) ? "Yes" : "No");
+	}
+	(*lineStart)[catalog.count] = at;
+	// the same comparison displayAlphabetical sorts with
+	NodeArray na;
+	PokemonNode *nodes = (PokemonNode *)malloc(catalog.count * sizeof(PokemonNode));
+	initNodeArray(&na, catalog.count);
+	if (!nodes || !na.nodes) {
+		free(nodes);
+		free(na.nodes);
+		return 0;
+	}
+	for (int i = 0; i < catalog.count; i++) {
+		nodes[i].data = &catalog.species[i];
+		na.nodes[i] = &nodes[i];
+	}
+	qsort(na.nodes, catalog.count, sizeof(PokemonNode *), compareByNameNode);
+	uint16_t *byAlpha = *alpha + catalog.count;
+	for (int r = 0; r < catalog.count; r++) {
+		int index = (int)(na.nodes[r] - nodes);
+		byAlpha[r] = (uint16_t)index;
+		(*alpha)[index] = (uint16_t)r;
+	}
+	free(nodes);
+	free(na.nodes);
+	job->lines = *lines;
+	job->lineStart = *lineStart;
+	job->alphaRank = *alpha;
+	job->byAlpha = byAlpha;
+	return 1;
+}
+
+
+void dumpAllOwners(PokedexContext *ctx) {
+	if (!ctx->ownerHead) {
+		printf("No existing Pokedexes.\n");
+		return;
+	}
+	menuText("Display:\n"
+	"1. BFS (Level-Order)\n"
+	"2. Pre-Order\n"
+	"3. In-Order\n"
+	"4. Post-Order\n"
+	"5. Alphabetical (by name)\n");
+	int mode = readIntSafe("Your choice: ");
+	if (mode < 1 || mode > 5) {
+		printf("Invalid choice.\n");
+		return;
+	}
+	DumpJob job;
+	memset(&job, 0, sizeof(job));
+	job.mode = mode;
+	job.context = ctx;
+	job.count = ringLength(ctx);
+	job.chunks = (job.count + DUMP_CHUNK - 1) / DUMP_CHUNK;
+	uint32_t *order = (uint32_t *)malloc(job.count * sizeof(uint32_t));
+	job.buffers = (DumpBuffer *)calloc(job.chunks, sizeof(DumpBuffer));
+	job.ready = (char *)calloc(job.chunks, 1);
+	char *lines = NULL;
+	size_t *lineStart = NULL;
+	uint16_t *alpha = NULL;
+	if (!order || !job.buffers || !job.ready || !dumpPrepare(&job, &lines, &lineStart, &alpha)) {
+		printf("Memory allocation failed.\n");
+		free(order);
+		free(job.buffers);
+		free(job.ready);
+		free(lines);
+		free(lineStart);
+		free(alpha);
+		return;
+	}
+	readRingOrder(ctx, order, job.count);
+	job.order = order;
+
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int wanted = cpus < 1 ? 1 : cpus > DUMP_MAX_THREADS ? DUMP_MAX_THREADS : (int)cpus;
+	if (wanted > job.chunks) wanted = job.chunks;
+	pthread_t workers[DUMP_MAX_THREADS];
+	int started = 0;
+	job.window = DUMP_WINDOW * wanted;
+	pthread_mutex_init(&job.lock, NULL);
+	pthread_cond_init(&job.changed, NULL);
+	// one chunk or one core: render on this thread, no workers
+	if (wanted > 1)
+		while (started < wanted && pthread_create(&workers[started], NULL, dumpWorker, &job) == 0) started++;
+
+	// write chunks in ring order as they become ready
+	fflush(stdout);
+	int ok = 1;
+	for (int c = 0; c < job.chunks; c++) {
+		if (!started) dumpChunk(&job, c);
+		else {
+			pthread_mutex_lock(&job.lock);
+			while (!job.ready[c]) pthread_cond_wait(&job.changed, &job.lock);
+			pthread_mutex_unlock(&job.lock);
+		}
+		DumpBuffer *out = &job.buffers[c];
+		if (ok && !out->ok) {
+			printf("Memory allocation failed.\n");
+			ok = 0;
+		}
+		if (ok) ok = writeOutput(out->data, out->length);
+		free(out->data);
+		out->data = NULL;
+		pthread_mutex_lock(&job.lock);
+		job.written = c + 1;
+		if (!ok) job.next = job.chunks;  // stop handing out work
+		pthread_cond_broadcast(&job.changed);
+		pthread_mutex_unlock(&job.lock);
+		if (!ok) break;
+	}
+	for (int i = 0; i < started; i++) pthread_join(workers[i], NULL);
+	// chunks a failed write left behind
+	for (int c = 0; c < job.chunks; c++) free(job.buffers[c].data);
+	pthread_cond_destroy(&job.changed);
+	pthread_mutex_destroy(&job.lock);
+	free(order);
+	free(job.buffers);
+	free(job.ready);
+	free(lines);
+	free(lineStart);
+	free(alpha);
+}
+
+
+// --------------------------------------------------------------
+// Owner Handles & Species -> Owners Index
+// --------------------------------------------------------------
+
+
+void printOwnersOfSpecies(PokedexContext *ctx) {
+	int id = readSpeciesSafe("Enter species ID or name: ");
+	const PokemonData *data = speciesById(id);
+	if (!data) {
+		printf("Invalid ID.\n");
+		return;
+	}
+	const OwnerSet *set = ownersOfSpecies(ctx, data);
+	if (!set->count) {
+		printf("Nobody owns %s.\n", data->name);
+		return;
+	}
+	printf("Owners of %s (%u):", data->name, set->count);
+	for (uint32_t i = 0; i < set->count; i++)
+		printf("%s%s", i ? ", " : " ", ownerByHandle(ctx, set->owners[i])->ownerName);
+	printf("\n");
+}
+
+
+void printOwnersOfBoth(PokedexContext *ctx) {
+	const PokemonData *first = speciesById(readSpeciesSafe("Enter first species ID or name: "));
+	const PokemonData *second = speciesById(readSpeciesSafe("Enter second species ID or name: "));
+	if (!first || !second) {
+		printf("Invalid ID.\n");
+		return;
+	}
+	const OwnerSet *a = ownersOfSpecies(ctx, first);
+	const OwnerSet *b = ownersOfSpecies(ctx, second);
+	uint32_t i = 0, j = 0, found = 0;
+	while (i < a->count && j < b->count) {
+		if (a->owners[i] < b->owners[j]) i++;
+		else if (a->owners[i] > b->owners[j]) j++;
+		else {
+			if (!found) printf("Owners of both %s and %s:", first->name, second->name);
+			printf("%s%s", found ? ", " : " ", ownerByHandle(ctx, a->owners[i])->ownerName);
+			found++;
+			i++;
+			j++;
+		}
+	}
+	if (found) printf("\n");
+	else printf("Nobody owns both %s and %s.\n", first->name, second->name);
+}
+
+
+void printRarestSpecies(PokedexContext *ctx) {
+	uint32_t fewest = 0;
+	for (int i = 0; i < catalog.count; i++) {
+		uint32_t count = ctx->registry.speciesOwners[i].count;
+		if (count && (!fewest || count < fewest)) fewest = count;
+	}
+	if (!fewest) {
+		printf("Nobody owns any Pokemon.\n");
+		return;
+	}
+	printf("Rarest species (owned by %u owner%s):\n", fewest, fewest == 1 ? "" : "s");
+	int shown = 0;
+	int total = 0;
+	for (int i = 0; i < catalog.count; i++) {
+		if (ctx->registry.speciesOwners[i].count != fewest) continue;
+		if (shown < SUGGEST_LIMIT) {
+			printf("%s (ID %d)\n", catalog.species[i].name, catalog.species[i].id);
+			shown++;
+		}
+		total++;
+	}
+	if (total > shown) printf("... and %d more.\n", total - shown);
+}
+
+
+// --------------------------------------------------------------
+// Species Membership & Filter Queries
+// --------------------------------------------------------------
+
+
+static int compareIndices(const void *a, const void *b) {
+	int x = *(const int *)a;
+	int y = *(const int *)b;
+	return (x > y) - (x < y);
+}
+
+
+void queryAllOwners(PokedexContext *ctx) {
+	menuText("Enter filter (e.g. FIRE attack>90 hp<=100 evolve=no 1-151): ");
+	char *text = getDynamicInput();
+	if (!text) return;
+	SpeciesFilter filter;
+	const char *bad = NULL;
+	int ok = parseSpeciesFilter(text, &filter, &bad);
+	if (!ok) printf("Invalid filter term '%.*s'.\n", (int)strcspn(bad, " \t"), bad);
+	free(text);
+	if (!ok) return;
+	uint64_t *mask = (uint64_t *)malloc(catalog.wordCount * sizeof(uint64_t));
+	if (!mask) {
+		freeSpeciesFilter(&filter);
+		return;
+	}
+	int matches = evaluateSpeciesFilter(&filter, mask);
+	freeSpeciesFilter(&filter);
+	if (!matches || !ctx->ownerHead) {
+		printf("No matching Pokemon.\n");
+		free(mask);
+		return;
+	}
+	// owner species sets are in score order: match against the mask in that order,
+	// then sort an owner's hits back into catalog order to print them
+	uint64_t *rankMask = (uint64_t *)calloc(catalog.wordCount, sizeof(uint64_t));
+	int *found = (int *)malloc(matches * sizeof(int));
+	if (!rankMask || !found) {
+		printf("Memory allocation failed.\n");
+		free(rankMask);
+		free(found);
+		free(mask);
+		return;
+	}
+	for (int w = 0; w < catalog.wordCount; w++) {
+		for (uint64_t bits = mask[w]; bits; bits &= bits - 1) {
+			int rank = catalog.scoreRank[w * 64 + __builtin_ctzll(bits)];
+			rankMask[rank / 64] |= 1ULL << (rank % 64);
+		}
+	}
+	int totalPokemon = 0;
+	int totalOwners = 0;
+	OwnerNode *owner = ctx->ownerHead;
+	do {
+		int count = 0;
+		for (uint32_t i = 0; i < owner->speciesCount; i++) {
+			uint32_t w = owner->species[i].word;
+			for (uint64_t bits = owner->species[i].bits & rankMask[w]; bits; bits &= bits - 1)
+				found[count++] = catalog.byScore[w * 64 + __builtin_ctzll(bits)];
+		}
+		if (count) {
+			qsort(found, count, sizeof(int), compareIndices);
+			printf("%s (%d):", owner->ownerName, count);
+			for (int i = 0; i < count; i++) printf("%s%s", i ? ", " : " ", catalog.species[found[i]].name);
+			printf("\n");
+			totalPokemon += count;
+			totalOwners++;
+		}
+		owner = nextOwner(ctx, owner);
+	} while (owner != ctx->ownerHead);
+	if (!totalOwners) printf("No matching Pokemon.\n");
+	else printf("%d Pokemon matched across %d owner(s).\n", totalPokemon, totalOwners);
+	free(rankMask);
+	free(found);
+	free(mask);
+}
+
+
+// --------------------------------------------------------------
+// Battle Simulator
+// --------------------------------------------------------------
+
+
+# define BATTLE_BATCH 4096
+
+// Results of one species against one opponent.
+typedef struct
+{
+	const PokemonData *opponent;
+	long wins;
+	long losses;
+	long draws;
+	long turns;
+} MatchupTally;
+
+
+static int compareMatchupsByWinRate(const void *a, const void *b) {
+	const MatchupTally *m1 = a;
+	const MatchupTally *m2 = b;
+	long total1 = m1->wins + m1->losses + m1->draws;
+	long total2 = m2->wins + m2->losses + m2->draws;
+	// m1->wins / total1 vs m2->wins / total2, without division
+	long long lhs = (long long)m1->wins * total2;
+	long long rhs = (long long)m2->wins * total1;
+	if (lhs != rhs) return lhs < rhs ? -1 : 1;
+	return m1->opponent->id - m2->opponent->id;
+}
+
+
+void battleSimulator(void) {
+	const PokemonData *first = speciesById(readSpeciesSafe("Enter first species ID or name: "));
+	if (!first) {
+		printf("Invalid ID.\n");
+		return;
+	}
+	int secondId = readSpeciesSafe("Enter second species ID or name (0 = whole catalog): ");
+	const PokemonData *second = secondId ? speciesById(secondId) : NULL;
+	if (secondId && !second) {
 		printf("Invalid ID.\n");
 		return;
 	}
-	PokemonNode *treeRoot = pokemonCircleToTree(owner->pokedexRoot);
-	if (searchPokemonBFS(treeRoot, id)) {
-		freePokemonTree(&treeRoot);
-		printf("Pokemon with ID %d is already in the Pokedex. No changes made.\n", id);
+	int battles = readIntSafe("How many battles per matchup? ");
+	if (battles <= 0) return;
+	int seed = readIntSafe("Enter seed: ");
+	int matchups = second ? 1 : catalog.count;
+	MatchupTally *tally = (MatchupTally *)calloc(matchups, sizeof(MatchupTally));
+	BattleBatch batch;
+	if (!tally || !battleBatchInit(&batch, BATTLE_BATCH)) {
+		printf("Memory allocation failed.\n");
+		free(tally);
+		return;
+	}
+	for (int m = 0; m < matchups; m++) tally[m].opponent = second ? second : &catalog.species[m];
+	double started = monotonicSeconds();
+	// battle k of matchup m is seeded from (seed, m, k) only; lanes are
+	// filled across matchup boundaries and flushed whenever the batch is full
+	int laneMatchup[BATTLE_BATCH];
+	long total = (long)matchups * battles;
+	for (long k = 0; k < total; k++) {
+		int m = (int)(k / battles);
+		laneMatchup[battleBatchAdd(&batch, first, tally[m].opponent, ((uint64_t)(uint32_t)seed << 32) ^ (uint64_t)k)] = m;
+		if (batch.count == BATTLE_BATCH || k == total - 1) {
+			battleBatchRun(&batch);
+			for (int i = 0; i < batch.count; i++) {
+				MatchupTally *t = &tally[laneMatchup[i]];
+				if (batch.winner[i] == 1) t->wins++;
+				else if (batch.winner[i] == 2) t->losses++;
+				else t->draws++;
+				t->turns += batch.turns[i];
+			}
+			battleBatchClear(&batch);
+		}
+	}
+	double elapsed = monotonicSeconds() - started;
+	battleBatchFree(&batch);
+
+	if (second) {
+		const MatchupTally *t = &tally[0];
+		printf("%s vs %s (%gx vs %gx damage), %d battles:\n", first->name, second->name,
+			typeEffect[first->TYPE][second->TYPE] / 2.0, typeEffect[second->TYPE][first->TYPE] / 2.0, battles);
+		printf("%s wins %ld (%.2f%%), %s wins %ld (%.2f%%), draws %ld\n",
+			first->name, t->wins, 100.0 * t->wins / battles,
+			second->name, t->losses, 100.0 * t->losses / battles, t->draws);
+		printf("Average turns: %.2f\n", (double)t->turns / battles);
+	} else {
+		long wins = 0;
+		for (int m = 0; m < matchups; m++) wins += tally[m].wins;
+		printf("%s vs the whole catalog, %d battles each: won %.2f%% overall\n",
+			first->name, battles, 100.0 * wins / total);
+		qsort(tally, matchups, sizeof(MatchupTally), compareMatchupsByWinRate);
+		printf("Toughest opponents:\n");
+		for (int m = 0; m < matchups && m < SUGGEST_LIMIT; m++)
+			printf("%d. %s: won %.2f%%\n", m + 1, tally[m].opponent->name, 100.0 * tally[m].wins / battles);
+	}
+	printf("Simulated %ld battles in %.3fs\n", total, elapsed);
+	free(tally);
+}
+
+
+// --------------------------------------------------------------
+// Pipelined Replay
+// --------------------------------------------------------------
+
+static int byteQueueInit(ByteQueue *q, size_t capacity) {
+	memset(q, 0, sizeof(*q));
+	q->data = (char *)malloc(capacity);
+	q->mask = capacity - 1;
+	return q->data != NULL;
+}
+
+
+// Called while the other side has not caught up: spin a little, since it
+// is usually about to, then let it have the CPU.
+static void waitForPeer(int *spins) {
+	if (++*spins < PIPE_SPINS) return;
+	*spins = 0;
+	sched_yield();
+}
+
+
+// Block until all of src is queued, or drop it if the consumer has stopped.
+static void byteQueuePush(ByteQueue *q, const char *src, size_t len) {
+	size_t tail = q->tail;
+	int spins = 0;
+	while (len > 0) {
+		size_t room = q->mask + 1 - (tail - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE));
+		if (!room) {
+			if (__atomic_load_n(&q->stop, __ATOMIC_ACQUIRE)) return;
+			waitForPeer(&spins);
+			continue;
+		}
+		size_t offset = tail & q->mask;
+		size_t n = len < room ? len : room;
+		if (n > q->mask + 1 - offset) n = q->mask + 1 - offset;
+		memcpy(q->data + offset, src, n);
+		src += n;
+		len -= n;
+		tail += n;
+		__atomic_store_n(&q->tail, tail, __ATOMIC_RELEASE);
+	}
+}
+
+
+// Block until some bytes are queued; 0 once the producer closed and all were taken.
+static size_t byteQueuePop(ByteQueue *q, char *dst, size_t max) {
+	size_t head = q->head;
+	int spins = 0;
+	while (1) {
+		int closed = __atomic_load_n(&q->closed, __ATOMIC_ACQUIRE);
+		size_t queued = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) - head;
+		if (queued) {
+			size_t offset = head & q->mask;
+			size_t n = queued < max ? queued : max;
+			if (n > q->mask + 1 - offset) n = q->mask + 1 - offset;
+			memcpy(dst, q->data + offset, n);
+			__atomic_store_n(&q->head, head + n, __ATOMIC_RELEASE);
+			return n;
+		}
+		// closed is read before tail, so nothing pushed before the close is missed
+		if (closed) return 0;
+		waitForPeer(&spins);
+	}
+}
+
+
+static void *pipelineReader(void *arg) {
+	(void)arg;
+	char buffer[PRINT_BUFFER];
+	while (!__atomic_load_n(&pipeline.input.stop, __ATOMIC_ACQUIRE)) {
+		ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) break;
+		byteQueuePush(&pipeline.input, buffer, (size_t)n);
+	}
+	__atomic_store_n(&pipeline.input.closed, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+
+static void *pipelineWriter(void *arg) {
+	(void)arg;
+	char buffer[PRINT_BUFFER];
+	int ok = 1;
+	size_t n;
+	// after a failed write keep draining, so the executor never blocks on a full queue
+	while ((n = byteQueuePop(&pipeline.output, buffer, sizeof(buffer))) > 0)
+		if (ok) ok = writeAll(STDOUT_FILENO, buffer, n);
+	return NULL;
+}
+
+
+static ssize_t pipelineStreamRead(void *cookie, char *buf, size_t size) {
+	return (ssize_t)byteQueuePop((ByteQueue *)cookie, buf, size);
+}
+
+
+static ssize_t pipelineStreamWrite(void *cookie, const char *buf, size_t size) {
+	byteQueuePush((ByteQueue *)cookie, buf, size);
+	return (ssize_t)size;
+}
+
+
+int pipelineStart(void) {
+	if (pipeline.running) return 1;
+	if (!byteQueueInit(&pipeline.input, PIPE_QUEUE) || !byteQueueInit(&pipeline.output, PIPE_QUEUE)) {
+		free(pipeline.input.data);
+		free(pipeline.output.data);
+		return 0;
+	}
+	cookie_io_functions_t readIo = { pipelineStreamRead, NULL, NULL, NULL };
+	cookie_io_functions_t writeIo = { NULL, pipelineStreamWrite, NULL, NULL };
+	FILE *in = fopencookie(&pipeline.input, "r", readIo);
+	FILE *out = fopencookie(&pipeline.output, "w", writeIo);
+	int readerUp = 0;
+	int writerUp = 0;
+	if (in && out) {
+		readerUp = pthread_create(&pipeline.reader, NULL, pipelineReader, NULL) == 0;
+		writerUp = readerUp && pthread_create(&pipeline.writer, NULL, pipelineWriter, NULL) == 0;
+	}
+	if (!writerUp) {
+		if (readerUp) {
+			__atomic_store_n(&pipeline.input.stop, 1, __ATOMIC_RELEASE);
+			pthread_cancel(pipeline.reader);
+			pthread_join(pipeline.reader, NULL);
+		}
+		if (in) fclose(in);
+		if (out) fclose(out);
+		free(pipeline.input.data);
+		free(pipeline.output.data);
+		return 0;
+	}
+	setvbuf(out, NULL, _IOFBF, PRINT_BUFFER);
+	fflush(stdout);
+	pipeline.realStdin = stdin;
+	pipeline.realStdout = stdout;
+	stdin = in;
+	stdout = out;
+	pipeline.running = 1;
+	return 1;
+}
+
+
+void pipelineFinish(void) {
+	if (!pipeline.running) return;
+	// closing the stream flushes the last of the output into the queue
+	fclose(stdout);
+	__atomic_store_n(&pipeline.output.closed, 1, __ATOMIC_RELEASE);
+	pthread_join(pipeline.writer, NULL);
+	// the reader may still be blocked in read() on input nobody will use
+	__atomic_store_n(&pipeline.input.stop, 1, __ATOMIC_RELEASE);
+	pthread_cancel(pipeline.reader);
+	pthread_join(pipeline.reader, NULL);
+	fclose(stdin);
+	stdin = pipeline.realStdin;
+	stdout = pipeline.realStdout;
+	free(pipeline.input.data);
+	free(pipeline.output.data);
+	pipeline.running = 0;
+}
+
+
+// --------------------------------------------------------------
+// Export
+// --------------------------------------------------------------
+
+
+static int exportToScreen(void *arg, const void *data, size_t len) {
+	(void)arg;
+	return writeOutput(data, len);
+}
+
+
+void exportMenu(PokedexContext *ctx) {
+	menuText("Export format:\n"
+	"1. JSON Lines\n"
+	"2. CSV\n");
+	int format = readIntSafe("Your choice: ");
+	if (format != EXPORT_JSON_LINES && format != EXPORT_CSV) {
+		printf("Invalid choice.\n");
+		return;
+	}
+	menuText("Enter file name (empty for the screen): ");
+	char *path = getDynamicInput();
+	if (!path) return;
+	if (!*path) {
+		fflush(stdout);  // the rows go out after what was printed so far
+		if (exportOwners(ctx, (ExportFormat)format, exportToScreen, NULL) < 0) printf("Export failed.\n");
+		free(path);
+		return;
+	}
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		printf("Cannot open %s: %s.\n", path, strerror(errno));
+		free(path);
 		return;
 	}
-	freePokemonTree(&treeRoot);
-	int indexID = id - 1;
-	PokemonNode *pokemon = createPokemonNode(&pokedex[indexID]);
-	if (!pokemon) return;
-	pokemon->left = pokemon->right = pokemon;
-	linkToPokedex(&(owner->pokedexRoot), pokemon);
-	printf("Pokemon %s (ID %d) added.\n", pokemon->data->name, id);
+	long owners = 0;
+	if (pkExportOwners(ctx, fd, (ExportFormat)format, &owners) != PK_OK) owners = -1;
+	if (close(fd) != 0) owners = -1;
+	if (owners < 0) printf("Export to %s failed.\n", path);
+	else printf("Exported %ld owners to %s.\n", owners, path);
+	free(path);
 }
 
 
-void  linkToPokedex(PokemonNode **root, PokemonNode *newNode) {
-	if (!(*root)) {
-		newNode->left = newNode->right = newNode;
-		*root = newNode;
+// --------------------------------------------------------------
+// Import
+// --------------------------------------------------------------
+
+
+void importMenu(PokedexContext *ctx) {
+	menuText("Enter file name: ");
+	char *path = getDynamicInput();
+	if (!path) return;
+	ImportReport report;
+	PokedexStatus status = importOwners(ctx, path, &report);
+	if (status == PK_IO_ERROR) {
+		printf("Cannot read %s: %s.\n", path, strerror(errno));
+		free(path);
 		return;
 	}
-	newNode->right = *root;
-	newNode->left = (*root)->left;
-	(*root)->left->right = newNode;
-	(*root)->left = newNode;
+	free(path);
+	if (status == PK_NO_MEMORY) printf("Memory allocation failed; the import stopped partway.\n");
+	printf("Imported %ld rows: %ld new owners, %ld Pokemon added, %ld already owned, %ld rejected.\n",
+		report.rows, report.owners, report.pokemon, report.duplicates, report.rejected);
+	for (int i = 0; i < report.samples; i++) {
+		const char *why = report.sample[i].problem == IMPORT_NO_NAME ? "no owner name"
+			: report.sample[i].problem == IMPORT_BAD_QUOTES ? "unclosed or misplaced quote"
+			: report.sample[i].problem == IMPORT_NUL_NAME ? "NUL byte in owner name"
+			: "unknown species";
+		printf("Line %ld: %s '%s'\n", report.sample[i].line, why, report.sample[i].token);
+	}
+	if (report.rejected > report.samples) printf("... and %ld more rejected rows.\n", report.rejected - report.samples);
 }
 
 
-PokemonNode *createPokemonNode(const PokemonData *data) {
-	PokemonNode *poke = (PokemonNode*)malloc(sizeof(PokemonNode));
-	if (!poke) return NULL;
-	poke->data = data;
-	poke->left = poke->right = NULL;
-	return poke;
+// --------------------------------------------------------------
+// Tools Menu
+// --------------------------------------------------------------
+void toolsMenu(PokedexContext *ctx) {
+	menuText("Tools:\n"
+	"1. Suggest species by name\n"
+	"2. Find Pokemon across all owners\n"
+	"3. Owners of a species\n"
+	"4. Owners of two species\n"
+	"5. Rarest species\n"
+	"6. Global statistics\n"
+	"7. Owner statistics\n"
+	"8. Evolve every owner's Pokemon\n"
+	"9. Undo\n"
+	"10. Redo\n"
+	"11. Checkpoint now\n"
+	"12. Leaderboard\n"
+	"13. Trainer rank\n"
+	"14. Dump all owners\n"
+	"15. Battle simulator\n"
+	"16. Export owners\n"
+	"17. Import owners\n");
+	int choice = readIntSafe("Your choice: ");
+	switch (choice) {
+		case 1: {
+			menuText("Enter the start of a species name: ");
+			char *prefix = getDynamicInput();
+			if (!prefix) return;
+			suggestSpecies(prefix);
+			free(prefix);
+			break;
+		}
+		case 2: queryAllOwners(ctx); break;
+		case 3: printOwnersOfSpecies(ctx); break;
+		case 4: printOwnersOfBoth(ctx); break;
+		case 5: printRarestSpecies(ctx); break;
+		case 6: printGlobalStats(ctx); break;
+		case 7: printOwnerStats(ctx); break;
+		case 8:
+			undoBegin(ctx, "Evolve every owner's Pokemon");
+			evolveAllOwners(ctx);
+			undoEnd(ctx);
+			break;
+		case 9: {
+			const char *label = undoLast(ctx);
+			if (label) printf("Undone: %s.\n", label);
+			else printf("Nothing to undo.\n");
+			break;
+		}
+		case 10: {
+			const char *label = redoLast(ctx);
+			if (label) printf("Redone: %s.\n", label);
+			else printf("Nothing to redo.\n");
+			break;
+		}
+		case 11:
+			if (!ctx->checkpoint.path) printf("Checkpointing is off (start with -s <file>).\n");
+			else if (ctx->checkpoint.writer) printf("Checkpoint %d is still being written.\n", ctx->checkpoint.number);
+			else if (checkpointStart(ctx)) printf("Checkpoint %d started.\n", ctx->checkpoint.number);
+			break;
+		case 12: printLeaderboard(ctx); break;
+		case 13: printTrainerRank(ctx); break;
+		case 14: dumpAllOwners(ctx); break;
+		case 15: battleSimulator(); break;
+		case 16: exportMenu(ctx); break;
+		case 17:
+			undoBegin(ctx, "Import owners");
+			importMenu(ctx);
+			undoEnd(ctx);
+			break;
+	default: printf("Invalid choice.\n");
+	}
 }
 
 
 // --------------------------------------------------------------
 // Main Menu
 // --------------------------------------------------------------
-void mainMenu(void) {
+void mainMenu(PokedexContext *ctx) {
 	int choice;
 	do {
+		checkpointPoll(ctx);
 		choice = 0;
-		printf("\n=== Main Menu ===\n"
+		menuText("\n=== Main Menu ===\n"
 		"1. New Pokedex\n"
 		"2. Existing Pokedex\n"
 		"3. Delete a Pokedex\n"
 		"4. Merge Pokedexes\n"
 		"5. Sort Owners by Name\n"
 		"6. Print Owners in a direction X times\n"
-		"7. Exit\n");
+		"7. Exit\n"
+		"8. Tools\n");
 		choice = readIntSafe("Your choice: ");
 		switch (choice) {
-			case 1: openPokedexMenu(); break;
-			case 2: enterExistingPokedexMenu(); break;
-			case 3: deletePokedex(); break;
-			case 4: mergePokedexMenu(); break;
-			case 5: sortOwners(); break;
-			case 6: printOwnersCircular(ownerHead); break;
+			case 1: undoBegin(ctx, "New Pokedex"); openPokedexMenu(ctx); undoEnd(ctx); break;
+			case 2: enterExistingPokedexMenu(ctx); break;
+			case 3: undoBegin(ctx, "Delete a Pokedex"); deletePokedex(ctx); undoEnd(ctx); break;
+			case 4: undoBegin(ctx, "Merge Pokedexes"); mergePokedexMenu(ctx); undoEnd(ctx); break;
+			case 5: undoBegin(ctx, "Sort Owners by Name"); sortOwners(ctx); undoEnd(ctx); break;
+			case 6: printOwnersCircular(ctx, ctx->ownerHead); break;
 			case 7: printf("Goodbye!\n"); break;
+			case 8: toolsMenu(ctx); break;
 		default: printf("Invalid.\n");
 		}
 	} while (choice != 7);
 }
 
 
-int main(void) {
-	mainMenu();
-	freeAllOwners();
+// Checkpoint results, as the menu reports them.
+static void printCheckpoint(const CheckpointResult *result, void *arg) {
+	(void)arg;
+	if (!result->started) printf("Checkpoint failed: %s.\n", strerror(result->error));
+	else if (!result->ok)
+		printf("Checkpoint %d failed: %s.\n", result->number,
+			result->error ? strerror(result->error) : "writer did not finish");
+	else
+		printf("Checkpoint %d saved to %s: %ld owners, %ld Pokemon. "
+			"Paused %.2f ms, wrote in %.2f ms, done %.2f s after capture (%d change%s behind).\n",
+			result->number, result->path, result->owners, result->pokemon,
+			result->pauseSeconds * 1000, result->writeSeconds * 1000, result->doneAfter,
+			result->changesBehind, result->changesBehind == 1 ? "" : "s");
+}
+
+
+int main(int argc, char *argv[]) {
+	const char *catalogPath = NULL;
+	const char *feedPath = NULL;
+	const char *replicaObject = NULL;
+	int pipelined = 0;
+	Checkpointer checkpoint = {0};
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) catalogPath = argv[++i];
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) checkpoint.path = argv[++i];
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) checkpoint.everySeconds = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) checkpoint.everyChanges = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-q") == 0) quietMode = 1;
+		else if (strcmp(argv[i], "-p") == 0) pipelined = 1;
+		else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) feedPath = argv[++i];
+		else if (strcmp(argv[i], "-r") == 0) replicaObject = i + 1 < argc && argv[i + 1][0] == '/' ? argv[++i] : REPLICA_NAME;
+		else {
+			fprintf(stderr, "Usage: %s [-q] [-p] [-c catalog.csv] [-s snapshot.csv [-t seconds] [-n changes]] [-f feed.sock] [-r [/name]]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (checkpoint.everySeconds < 0 || checkpoint.everyChanges < 0) {
+		fprintf(stderr, "Checkpoint interval and change count must not be negative.\n");
+		return 1;
+	}
+	if (checkpoint.path) {
+		if (!checkpoint.everySeconds && !checkpoint.everyChanges) {
+			checkpoint.everySeconds = CHECKPOINT_SECONDS;
+			checkpoint.everyChanges = CHECKPOINT_CHANGES;
+		}
+		checkpoint.reportFd = -1;
+		checkpoint.lastAt = monotonicSeconds();
+		checkpoint.onResult = printCheckpoint;
+	}
+	char error[CATALOG_ERROR];
+	if (!loadCatalog(catalogPath, error, sizeof(error))) {
+		fprintf(stderr, "%s\n", error);
+		return 1;
+	}
+	PokedexContext *ctx = pokedexCreate();
+	if (!ctx) {
+		fprintf(stderr, "Memory allocation failed.\n");
+		freeCatalog();
+		return 1;
+	}
+	ctx->checkpoint = checkpoint;
+	if (feedPath) {
+		PokedexStatus status = pkFeedOpen(ctx, 0);
+		if (status == PK_OK) status = pkFeedServe(ctx, feedPath);
+		if (status == PK_IO_ERROR) fprintf(stderr, "Could not serve the change feed at %s: %s.\n", feedPath, strerror(errno));
+		else if (status != PK_OK) fprintf(stderr, "Could not start the change feed.\n");
+	}
+	if (replicaObject) {
+		PokedexStatus status = pkReplicaOpen(ctx, replicaObject);
+		if (status == PK_IO_ERROR) fprintf(stderr, "Could not publish the replica %s: %s.\n", replicaObject, strerror(errno));
+		else if (status != PK_OK) fprintf(stderr, "Could not publish the replica.\n");
+	}
+	if (pipelined && !pipelineStart()) fprintf(stderr, "Could not start the pipeline; reading and writing directly.\n");
+	mainMenu(ctx);
+	pokedexDestroy(ctx);
+	pipelineFinish();
+	freeCatalog();
 	return 0;
-}
\ No newline at end of file
+}
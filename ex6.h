@@ -1,76 +1,34 @@
 #ifndef EX6_H
 #define EX6_H
 
-#include <ctype.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
+#include "pokedex.h"
 
-typedef enum
-{
-	GRASS,
-	FIRE,
-	WATER,
-	BUG,
-	NORMAL,
-	POISON,
-	ELECTRIC,
-	GROUND,
-	FAIRY,
-	FIGHTING,
-	PSYCHIC,
-	ROCK,
-	GHOST,
-	DRAGON,
-	ICE
-} PokemonType;
-
-typedef enum
-{
-	CANNOT_EVOLVE,
-	CAN_EVOLVE
-} EvolutionStatus;
-
-typedef struct PokemonData
-{
-	int id;
-	char *name;
-	PokemonType TYPE;
-	int hp;
-	int attack;
-	EvolutionStatus CAN_EVOLVE;
-} PokemonData;
-
-// Binary Tree Node (for Pokédex)
-typedef struct PokemonNode
+// Bytes passed one way between two threads through a power-of-two ring.
+// One thread only pushes and one only pops; each owns one index and
+// publishes it with release stores, so no lock is taken (see section 27).
+typedef struct
 {
-	const PokemonData *data;
-	struct PokemonNode *left;
-	struct PokemonNode *right;
-} PokemonNode;
-
-// Queue Node (for BFS)
-typedef struct QueueNode {
-    PokemonNode *pokemon;
-    struct QueueNode *next;
-} QueueNode;
-
-typedef struct {
-    QueueNode *front;
-    QueueNode *rear;
-} Queue;
-
-// Linked List Node (for Owners)
-typedef struct OwnerNode
+	char *data;
+	size_t mask;             // capacity - 1
+	size_t head;             // bytes popped so far, written by the consumer
+	char padHead[64];        // keep the two indexes on separate cache lines
+	size_t tail;             // bytes pushed so far, written by the producer
+	char padTail[64];
+	int closed;              // the producer is done; pops drain, then return 0
+	int stop;                // the consumer is gone; pushes are dropped
+} ByteQueue;
+
+// Reader -> executor -> writer stages of a -p run
+typedef struct
 {
-	char *ownerName;          // Owner's name
-	PokemonNode *pokedexRoot; // Pointer to the root of the owner's Pokédex
-	struct OwnerNode *prev;   // Previous owner in the linked list
-	struct OwnerNode *next;   // Next owner in the linked list
-} OwnerNode;
-
-// Global head pointer for the linked list of owners
-OwnerNode *ownerHead = NULL;
+	int running;
+	ByteQueue input;         // stdin bytes, read ahead by the reader thread
+	ByteQueue output;        // stdout bytes, written out by the writer thread
+	pthread_t reader;
+	pthread_t writer;
+	FILE *realStdin;
+	FILE *realStdout;
+} Pipeline;
 
 /* ------------------------------------------------------------
    1) Safe Input + Utility
@@ -83,14 +41,6 @@ OwnerNode *ownerHead = NULL;
  */
 void trimWhitespace(char *str);
 
-/**
- * @brief C99-friendly strdup replacement.
- * @param src source string
- * @return newly allocated copy of src
- * Why we made it: Some old systems lack strdup; we do it ourselves.
- */
-char *myStrdup(const char *src);
-
 /**
  * @brief Read an integer safely, re-prompt if invalid.
  * @param prompt text to display
@@ -107,152 +57,29 @@ int readIntSafe(const char *prompt);
 char *getDynamicInput(void);
 
 /**
- * @brief Return a string for a given PokemonType enum.
- * @param type the enum
- * @return string like "GRASS", "FIRE", etc.
- * Why we made it: So we can print readable type names.
- */
-const char *getTypeName(PokemonType type);
-
-/**
- * @brief Prompt the user for a direction (‘F’ or ‘B’) and return it.
- */
-char readDirection(const char *prompt);
-
-/* ------------------------------------------------------------
-   2) Creating & Freeing Nodes
-   ------------------------------------------------------------ */
-
-/**
- * @brief Create a BST node with a copy of the given PokemonData.
- * @param data pointer to PokemonData (like from the global pokedex)
- * @return newly allocated PokemonNode*
- * Why we made it: We need a standard way to allocate BST nodes.
- */
-PokemonNode *createPokemonNode(const PokemonData *data);
-
-/**
- * @brief Create an OwnerNode for the circular owners list.
- * @param ownerName the dynamically allocated name
- * @param starter BST root for the starter Pokemon
- * @return newly allocated OwnerNode*
- * Why we made it: Each user is represented as an OwnerNode.
- */
-OwnerNode *createOwner(char *ownerName, PokemonNode *starter);
-
-/**
- * @brief Free one PokemonNode (including name).
- * @param node pointer to node
- * Why we made it: Avoid memory leaks for single nodes.
- */
-void freePokemonNode(PokemonNode *node);
-
-/**
- * @brief Recursively free a BST of PokemonNodes.
- * @param root BST root
- * Why we made it: Clearing a user’s entire Pokedex means freeing a tree.
- */
-void freePokemonTree(PokemonNode **root);
-
-/**
- * @brief Free an OwnerNode (including name and entire Pokedex BST).
- * @param owner pointer to the owner
- * Why we made it: Deleting an owner also frees their Pokedex & name.
- */
-void freeOwnerNode(OwnerNode *owner);
-
-/* ------------------------------------------------------------
-   3) BST Insert, Search, Remove
-   ------------------------------------------------------------ */
-
-/**
- * @brief Insert a PokemonNode into BST by ID; duplicates freed.
- * @param root pointer to BST root
- * @param newNode node to insert
- * @return updated BST root
- * Why we made it: Standard BST insertion ignoring duplicates.
- */
-void insertPokemonNode(PokemonNode **root, PokemonNode *newNode);
-
-/** */
-void  linkToPokedex(PokemonNode **root, PokemonNode *newNode);
-/** */
-void initQueue(Queue *q);
-/** */
-void enqueue(Queue *q, PokemonNode *p);
-/** */
-PokemonNode *dequeue(Queue *q);
-/** */
-void freeQueue(Queue *q);
-
-/**
- * @brief BFS search for a Pokemon by ID in the BST.
- * @param root BST root
- * @param id ID to find
- * @return pointer to found node or NULL
- * Why we made it: BFS ensures we find nodes even in an unbalanced tree.
+ * @brief printf for menu banners and prompts; prints nothing in quiet mode.
+ * Why we made it: Scripted runs only want the results, and most of a
+ *   session's bytes are menu text it would otherwise format and write.
  */
-PokemonNode *searchPokemonBFS(PokemonNode *root, int id);
+void menuText(const char *format, ...);
 
 /**
- * @brief Remove node from BST by ID if found (BST removal logic).
- * @param root BST root
- * @param id ID to remove
- * @return updated BST root
- * Why we made it: We handle special cases of a BST remove (0,1,2 children).
+ * @brief Read a species ID or name safely, re-prompt if neither.
+ * @param prompt text to display
+ * @return the ID typed, or the ID of the species whose name was typed
+ * Why we made it: Clients know species by name; the ID is still checked by the caller.
  */
-PokemonNode *removeNodeBST(PokemonNode *root, int id);
+int readSpeciesSafe(const char *prompt);
 
 /**
- * @brief Combine BFS search + BST removal to remove Pokemon by ID.
- * @param root BST root
- * @param id the ID to remove
- * @return updated BST root
- * Why we made it: BFS confirms existence, then removeNodeBST does the removal.
+ * @brief Prompt the user for a direction (‘F’ or ‘B’) and return it.
  */
-PokemonNode *removePokemonByID(PokemonNode *root, int id);
+char readDirection(const char *prompt);
 
 /* ------------------------------------------------------------
    4) Generic BST Traversals (Function Pointers)
    ------------------------------------------------------------ */
 
-// Please notice, it's not really generic, it's just a demonstration of function pointers.
-// so don't be confused by the name, but please remember that you must use it.
-
-typedef void (*VisitNodeFunc)(PokemonNode *);
-
-/**
- * @brief Generic BFS traversal: call visit() on each node (level-order).
- * @param root BST root
- * @param visit function pointer for what to do with each node
- * Why we made it: BFS plus function pointers => flexible traversal.
- */
-void BFSGeneric(PokemonNode *root, VisitNodeFunc visit);
-
-/**
- * @brief A generic pre-order traversal (Root-Left-Right).
- * @param root BST root
- * @param visit function pointer
- * Why we made it: Another demonstration of function-pointer-based traversal.
- */
-void preOrderGeneric(PokemonNode *root, VisitNodeFunc visit);
-
-/**
- * @brief A generic in-order traversal (Left-Root-Right).
- * @param root BST root
- * @param visit function pointer
- * Why we made it: Great for seeing sorted order if BST is sorted by ID.
- */
-void inOrderGeneric(PokemonNode *root, VisitNodeFunc visit);
-
-/**
- * @brief A generic post-order traversal (Left-Right-Root).
- * @param root BST root
- * @param visit function pointer
- * Why we made it: Another standard traversal pattern.
- */
-void postOrderGeneric(PokemonNode *root, VisitNodeFunc visit);
-
 /**
  * @brief Print one PokemonNode’s data: ID, Name, Type, HP, Attack, Evolve?
  * @param node pointer to the node
@@ -291,9 +118,10 @@ void addNode(NodeArray *na, PokemonNode *node);
  * @brief Recursively collect all nodes from the BST into a NodeArray.
  * @param root BST root
  * @param na pointer to NodeArray
+ * @return 1, or 0 if the traversal ran out of memory
  * Why we made it: We gather everything for qsort.
  */
-void collectAll(PokemonNode *root, NodeArray *na);
+int collectAll(PokemonNode *root, NodeArray *na);
 
 /**
  * @brief Compare function for qsort (alphabetical by node->data->name).
@@ -339,18 +167,28 @@ void inOrderTraversal(PokemonNode *root);
  */
 void postOrderTraversal(PokemonNode *root);
 
-/**
- * @brief Convert the circular Pokédex list into a temporary BST of cloned nodes.
- * @param root any node in the original circular list
- * @return root of the newly created BST, or NULL if the list is empty or allocation fails
- * Why we made it: To allow pre-, in-, and post-order traversals without altering the circle.
- */
-PokemonNode* pokemonCircleToTree(PokemonNode *root);
-
 /* ------------------------------------------------------------
    6) Pokemon-Specific
    ------------------------------------------------------------ */
 
+/**
+ * @brief Sub-menu wrapper: evolve all eligible Pokemon of one owner.
+ * @param owner pointer to the Owner
+ * @param toFinal nonzero for final form, zero for one stage
+ */
+void evolveAllMenu(PokedexContext *ctx, OwnerNode *owner, int toFinal);
+
+/**
+ * @brief Evolve every owner's Pokemon (one stage or final form).
+ */
+void evolveAllOwners(PokedexContext *ctx);
+
+/**
+ * @brief Prompt for a range, ID list, type or stat filter and release the matches.
+ * @param owner pointer to the Owner
+ */
+void bulkReleaseMenu(PokedexContext *ctx, OwnerNode *owner);
+
 /**
  * @brief Let user pick two Pokemon by ID in the same Pokedex to fight.
  * @param owner pointer to the Owner
@@ -363,21 +201,21 @@ void pokemonFight(OwnerNode *owner);
  * @param owner pointer to the Owner
  * Why we made it: Demonstrates removing an old ID, inserting the next ID.
  */
-void evolvePokemon(OwnerNode *owner);
+void evolvePokemon(PokedexContext *ctx, OwnerNode *owner);
 
 /**
  * @brief Prompt for an ID, BFS-check duplicates, then insert into BST.
  * @param owner pointer to the Owner
  * Why we made it: Primary user function for adding new Pokemon to an owner’s Pokedex.
  */
-void addPokemon(OwnerNode *owner);
+void addPokemon(PokedexContext *ctx, OwnerNode *owner);
 
 /**
  * @brief Prompt for ID, remove that Pokemon from BST by ID.
  * @param owner pointer to the Owner
  * Why we made it: Another user function for releasing a Pokemon.
  */
-void freePokemon(OwnerNode *owner);
+void freePokemon(PokedexContext *ctx, OwnerNode *owner);
 
 /* ------------------------------------------------------------
    7) Display Menu for a Pokedex
@@ -391,48 +229,16 @@ void freePokemon(OwnerNode *owner);
 void displayMenu(OwnerNode *owner);
 
 /* ------------------------------------------------------------
-   8) Sorting Owners (Bubble Sort on Circular List)
+   8) Sorting Owners
    ------------------------------------------------------------ */
 
 /**
  * @brief Sort the circular owners list by name.
  * Why we made it: Another demonstration of pointer manipulation + sorting logic.
+ *   The ring's handles are sorted and relinked; owners never change slots,
+ *   so their handles stay valid.
  */
-void sortOwners(void);
-
-/**
- * @brief Helper to swap name & pokedexRoot in two OwnerNode.
- * @param a pointer to first owner
- * @param b pointer to second owner
- * Why we made it: Used internally by bubble sort to swap data.
- */
-void swapOwnerData(OwnerNode *a, OwnerNode *b);
-
-/* ------------------------------------------------------------
-   9) Circular List Linking & Searching
-   ------------------------------------------------------------ */
-
-/**
- * @brief Insert a new owner into the circular list. If none exist, it's alone.
- * @param newOwner pointer to newly created OwnerNode
- * Why we made it: We need a standard approach to keep the list circular.
- */
-void linkOwnerInCircularList(OwnerNode *newOwner);
-
-/**
- * @brief Remove a specific OwnerNode from the circular list, possibly updating head.
- * @param target pointer to the OwnerNode
- * Why we made it: Deleting or merging owners requires removing them from the ring.
- */
-void removeOwnerFromCircularList(OwnerNode *target);
-
-/**
- * @brief Find an owner by name in the circular list.
- * @param name string to match
- * @return pointer to the matching OwnerNode or NULL
- * Why we made it: We often need to locate an owner quickly.
- */
-OwnerNode *findOwnerByName(const char *name);
+void sortOwners(PokedexContext *ctx);
 
 /* ------------------------------------------------------------
    10) Owner Menus
@@ -442,13 +248,13 @@ OwnerNode *findOwnerByName(const char *name);
  * @brief Let user pick an existing Pokedex (owner) by number, then sub-menu.
  * Why we made it: This is the main interface for adding/fighting/evolving, etc.
  */
-void enterExistingPokedexMenu(void);
+void enterExistingPokedexMenu(PokedexContext *ctx);
 
 /**
  * @brief Creates a new Pokedex (prompt for name, check uniqueness, choose starter).
  * Why we made it: The main entry for building a brand-new Pokedex.
  */
-void openPokedexMenu(void);
+void openPokedexMenu(PokedexContext *ctx);
 
 /**
  * @brief Computes the ID of the starter pokemon
@@ -460,24 +266,24 @@ int computeStarterID(int menuChoice);
 /**
  * @brief Select a Pokedex (owner) from the list by number.
  */
-void ownerByNumber(OwnerNode **cur, int ifDelete);
+void ownerByNumber(PokedexContext *ctx, OwnerNode **cur, int ifDelete);
 
 /**
  * @brief Enter an owner name for the pokedex merge.
  */
-void ownerByName(OwnerNode **owner, int ifDelete);
+void ownerByName(PokedexContext *ctx, OwnerNode **owner, int ifDelete);
 
 /**
  * @brief Delete an entire Pokedex (owner) from the list.
  * Why we made it: Let user pick which Pokedex to remove and free everything.
  */
-void deletePokedex(void);
+void deletePokedex(PokedexContext *ctx);
 
 /**
  * @brief Merge the second owner's Pokedex into the first, then remove the second owner.
  * Why we made it: BFS copy demonstration plus removing an owner.
  */
-void mergePokedexMenu(void);
+void mergePokedexMenu(PokedexContext *ctx);
 
 /* ------------------------------------------------------------
    11) Printing Owners in a Circle
@@ -486,181 +292,158 @@ void mergePokedexMenu(void);
 /**
  * @brief Print owners left or right from head, repeating as many times as user wants.
  * Why we made it: Demonstrates stepping through a circular list in a chosen direction.
+ * The ring is rendered once into a buffer and large counts are streamed
+ * out of it in 64 KB writes.
  */
-void printOwnersCircular(OwnerNode *owner);
+void printOwnersCircular(PokedexContext *ctx, OwnerNode *owner);
 
 /* ------------------------------------------------------------
-   12) Cleanup All Owners at Program End
+   13) The Main Menu
    ------------------------------------------------------------ */
 
 /**
- * @brief Frees every remaining owner in the circular list, setting ownerHead = NULL.
- * Why we made it: Ensures a squeaky-clean exit with no leftover memory.
+ * @brief The main driver loop for the program (new pokedex, merge, fight, etc.).
+ * Why we made it: Our top-level UI that keeps the user engaged until they exit.
  */
-void freeAllOwners(void);
+void mainMenu(PokedexContext *ctx);
 
 /* ------------------------------------------------------------
-   13) The Main Menu
+   14) Species Catalog
    ------------------------------------------------------------ */
 
 /**
- * @brief The main driver loop for the program (new pokedex, merge, fight, etc.).
- * Why we made it: Our top-level UI that keeps the user engaged until they exit.
+ * @brief Print up to SUGGEST_LIMIT species whose name starts with prefix.
+ * @param prefix case-insensitive name prefix
+ */
+void suggestSpecies(const char *prefix);
+
+/* ------------------------------------------------------------
+   15) Species Membership & Filter Queries
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Prompt for a filter and list every owner's matching Pokemon.
+ * Why we made it: One pass over each owner's species words instead of walking every Pokedex.
+ */
+void queryAllOwners(PokedexContext *ctx);
+
+/* ------------------------------------------------------------
+   16) Owner Handles & Species -> Owners Index
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Prompt for a species and list who owns it.
+ */
+void printOwnersOfSpecies(PokedexContext *ctx);
+
+/**
+ * @brief Prompt for two species and list who owns both.
+ * Why we made it: Matchmaking; intersects two sorted handle sets.
+ */
+void printOwnersOfBoth(PokedexContext *ctx);
+
+/**
+ * @brief List the owned species held by the fewest owners.
+ */
+void printRarestSpecies(PokedexContext *ctx);
+
+/* ------------------------------------------------------------
+   17) Materialized Statistics
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Print the global summary (no traversal).
+ */
+void printGlobalStats(PokedexContext *ctx);
+
+/**
+ * @brief Pick an owner by number and print its stored aggregates.
+ */
+void printOwnerStats(PokedexContext *ctx);
+
+/* ------------------------------------------------------------
+   18) Tools Menu
+   ------------------------------------------------------------ */
+
+/**
+ * @brief One-shot menu of catalog and reporting tools.
+ * Why we made it: Keeps the main menu numbering stable for existing scripts.
+ */
+void toolsMenu(PokedexContext *ctx);
+
+/* ------------------------------------------------------------
+   23) Leaderboards
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Ask for K and print the strongest owned species and the strongest trainers.
+ */
+void printLeaderboard(PokedexContext *ctx);
+
+/**
+ * @brief Pick an owner by number and print their leaderboard rank.
+ */
+void printTrainerRank(PokedexContext *ctx);
+
+/* ------------------------------------------------------------
+   24) Dump All Owners
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Ask for a display order and print every owner's Pokedex, in ring order.
+ * Why we made it: One command instead of a menu round trip per owner.
+ *   Worker threads render chunks of the ring into private buffers. The
+ *   calling thread writes those buffers in order as each one is ready,
+ *   so output goes at pipe speed rather than single-core speed.
+ */
+void dumpAllOwners(PokedexContext *ctx);
+
+/* ------------------------------------------------------------
+   25) Battle Engine
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Ask for two species, a battle count and a seed, and report the results.
+ *   Second species 0 fights the first against the whole catalog.
  */
-void mainMenu(void);
-
-// Array of Pokemon data
-static const PokemonData pokedex[] = {
-	{1, "Bulbasaur", GRASS, 45, 49, CAN_EVOLVE},
-	{2, "Ivysaur", GRASS, 60, 62, CAN_EVOLVE},
-	{3, "Venusaur", GRASS, 80, 82, CANNOT_EVOLVE},
-	{4, "Charmander", FIRE, 39, 52, CAN_EVOLVE},
-	{5, "Charmeleon", FIRE, 58, 64, CAN_EVOLVE},
-	{6, "Charizard", FIRE, 78, 84, CANNOT_EVOLVE},
-	{7, "Squirtle", WATER, 44, 48, CAN_EVOLVE},
-	{8, "Wartortle", WATER, 59, 63, CAN_EVOLVE},
-	{9, "Blastoise", WATER, 79, 83, CANNOT_EVOLVE},
-	{10, "Caterpie", BUG, 45, 30, CAN_EVOLVE},
-	{11, "Metapod", BUG, 50, 20, CAN_EVOLVE},
-	{12, "Butterfree", BUG, 60, 45, CANNOT_EVOLVE},
-	{13, "Weedle", BUG, 40, 35, CAN_EVOLVE},
-	{14, "Kakuna", BUG, 45, 25, CAN_EVOLVE},
-	{15, "Beedrill", BUG, 65, 90, CANNOT_EVOLVE},
-	{16, "Pidgey", NORMAL, 40, 45, CAN_EVOLVE},
-	{17, "Pidgeotto", NORMAL, 63, 60, CAN_EVOLVE},
-	{18, "Pidgeot", NORMAL, 83, 80, CANNOT_EVOLVE},
-	{19, "Rattata", NORMAL, 30, 56, CAN_EVOLVE},
-	{20, "Raticate", NORMAL, 55, 81, CANNOT_EVOLVE},
-	{21, "Spearow", NORMAL, 40, 60, CAN_EVOLVE},
-	{22, "Fearow", NORMAL, 65, 90, CANNOT_EVOLVE},
-	{23, "Ekans", POISON, 35, 60, CAN_EVOLVE},
-	{24, "Arbok", POISON, 60, 85, CANNOT_EVOLVE},
-	{25, "Pikachu", ELECTRIC, 35, 55, CAN_EVOLVE},
-	{26, "Raichu", ELECTRIC, 60, 90, CANNOT_EVOLVE},
-	{27, "Sandshrew", GROUND, 50, 75, CAN_EVOLVE},
-	{28, "Sandslash", GROUND, 75, 100, CANNOT_EVOLVE},
-	{29, "NidoranF", POISON, 55, 47, CAN_EVOLVE},
-	{30, "Nidorina", POISON, 70, 62, CAN_EVOLVE},
-	{31, "Nidoqueen", POISON, 90, 92, CANNOT_EVOLVE},
-	{32, "NidoranM", POISON, 46, 57, CAN_EVOLVE},
-	{33, "Nidorino", POISON, 61, 72, CAN_EVOLVE},
-	{34, "Nidoking", POISON, 81, 102, CANNOT_EVOLVE},
-	{35, "Clefairy", FAIRY, 70, 45, CAN_EVOLVE},
-	{36, "Clefable", FAIRY, 95, 70, CANNOT_EVOLVE},
-	{37, "Vulpix", FIRE, 38, 41, CAN_EVOLVE},
-	{38, "Ninetales", FIRE, 73, 76, CANNOT_EVOLVE},
-	{39, "Jigglypuff", NORMAL, 115, 45, CAN_EVOLVE},
-	{40, "Wigglytuff", NORMAL, 140, 70, CANNOT_EVOLVE},
-	{41, "Zubat", POISON, 40, 45, CAN_EVOLVE},
-	{42, "Golbat", POISON, 75, 80, CAN_EVOLVE},
-	{43, "Oddish", GRASS, 45, 50, CAN_EVOLVE},
-	{44, "Gloom", GRASS, 60, 65, CAN_EVOLVE},
-	{45, "Vileplume", GRASS, 75, 80, CANNOT_EVOLVE},
-	{46, "Paras", BUG, 35, 70, CAN_EVOLVE},
-	{47, "Parasect", BUG, 60, 95, CANNOT_EVOLVE},
-	{48, "Venonat", BUG, 60, 55, CAN_EVOLVE},
-	{49, "Venomoth", BUG, 70, 65, CANNOT_EVOLVE},
-	{50, "Diglett", GROUND, 10, 55, CAN_EVOLVE},
-	{51, "Dugtrio", GROUND, 35, 80, CANNOT_EVOLVE},
-	{52, "Meowth", NORMAL, 40, 45, CAN_EVOLVE},
-	{53, "Persian", NORMAL, 65, 70, CANNOT_EVOLVE},
-	{54, "Psyduck", WATER, 50, 52, CAN_EVOLVE},
-	{55, "Golduck", WATER, 80, 82, CANNOT_EVOLVE},
-	{56, "Mankey", FIGHTING, 40, 80, CAN_EVOLVE},
-	{57, "Primeape", FIGHTING, 65, 105, CANNOT_EVOLVE},
-	{58, "Growlithe", FIRE, 55, 70, CAN_EVOLVE},
-	{59, "Arcanine", FIRE, 90, 110, CANNOT_EVOLVE},
-	{60, "Poliwag", WATER, 40, 50, CAN_EVOLVE},
-	{61, "Poliwhirl", WATER, 65, 65, CAN_EVOLVE},
-	{62, "Poliwrath", WATER, 90, 95, CANNOT_EVOLVE},
-	{63, "Abra", PSYCHIC, 25, 20, CAN_EVOLVE},
-	{64, "Kadabra", PSYCHIC, 40, 35, CAN_EVOLVE},
-	{65, "Alakazam", PSYCHIC, 55, 50, CANNOT_EVOLVE},
-	{66, "Machop", FIGHTING, 70, 80, CAN_EVOLVE},
-	{67, "Machoke", FIGHTING, 80, 100, CAN_EVOLVE},
-	{68, "Machamp", FIGHTING, 90, 130, CANNOT_EVOLVE},
-	{69, "Bellsprout", GRASS, 50, 75, CAN_EVOLVE},
-	{70, "Weepinbell", GRASS, 65, 90, CAN_EVOLVE},
-	{71, "Victreebel", GRASS, 80, 105, CANNOT_EVOLVE},
-	{72, "Tentacool", WATER, 40, 40, CAN_EVOLVE},
-	{73, "Tentacruel", WATER, 80, 70, CANNOT_EVOLVE},
-	{74, "Geodude", ROCK, 40, 80, CAN_EVOLVE},
-	{75, "Graveler", ROCK, 55, 95, CAN_EVOLVE},
-	{76, "Golem", ROCK, 80, 120, CANNOT_EVOLVE},
-	{77, "Ponyta", FIRE, 50, 85, CAN_EVOLVE},
-	{78, "Rapidash", FIRE, 65, 100, CANNOT_EVOLVE},
-	{79, "Slowpoke", WATER, 90, 65, CAN_EVOLVE},
-	{80, "Slowbro", WATER, 95, 75, CANNOT_EVOLVE},
-	{81, "Magnemite", ELECTRIC, 25, 35, CAN_EVOLVE},
-	{82, "Magneton", ELECTRIC, 50, 60, CANNOT_EVOLVE},
-	{83, "Farfetch'd", NORMAL, 52, 65, CANNOT_EVOLVE},
-	{84, "Doduo", NORMAL, 35, 85, CAN_EVOLVE},
-	{85, "Dodrio", NORMAL, 60, 110, CANNOT_EVOLVE},
-	{86, "Seel", WATER, 65, 45, CAN_EVOLVE},
-	{87, "Dewgong", WATER, 90, 70, CANNOT_EVOLVE},
-	{88, "Grimer", POISON, 80, 80, CAN_EVOLVE},
-	{89, "Muk", POISON, 105, 105, CANNOT_EVOLVE},
-	{90, "Shellder", WATER, 30, 65, CAN_EVOLVE},
-	{91, "Cloyster", WATER, 50, 95, CANNOT_EVOLVE},
-	{92, "Gastly", GHOST, 30, 35, CAN_EVOLVE},
-	{93, "Haunter", GHOST, 45, 50, CAN_EVOLVE},
-	{94, "Gengar", GHOST, 60, 65, CANNOT_EVOLVE},
-	{95, "Onix", ROCK, 35, 45, CANNOT_EVOLVE},
-	{96, "Drowzee", PSYCHIC, 60, 48, CAN_EVOLVE},
-	{97, "Hypno", PSYCHIC, 85, 73, CANNOT_EVOLVE},
-	{98, "Krabby", WATER, 30, 105, CAN_EVOLVE},
-	{99, "Kingler", WATER, 55, 130, CANNOT_EVOLVE},
-	{100, "Voltorb", ELECTRIC, 40, 30, CAN_EVOLVE},
-	{101, "Electrode", ELECTRIC, 60, 50, CANNOT_EVOLVE},
-	{102, "Exeggcute", GRASS, 60, 40, CAN_EVOLVE},
-	{103, "Exeggutor", GRASS, 95, 95, CANNOT_EVOLVE},
-	{104, "Cubone", GROUND, 50, 50, CAN_EVOLVE},
-	{105, "Marowak", GROUND, 60, 80, CANNOT_EVOLVE},
-	{106, "Hitmonlee", FIGHTING, 50, 120, CANNOT_EVOLVE},
-	{107, "Hitmonchan", FIGHTING, 50, 105, CANNOT_EVOLVE},
-	{108, "Lickitung", NORMAL, 90, 55, CANNOT_EVOLVE},
-	{109, "Koffing", POISON, 40, 65, CAN_EVOLVE},
-	{110, "Weezing", POISON, 65, 90, CANNOT_EVOLVE},
-	{111, "Rhyhorn", GROUND, 80, 85, CAN_EVOLVE},
-	{112, "Rhydon", GROUND, 105, 130, CANNOT_EVOLVE},
-	{113, "Chansey", NORMAL, 250, 5, CANNOT_EVOLVE},
-	{114, "Tangela", GRASS, 65, 55, CANNOT_EVOLVE},
-	{115, "Kangaskhan", NORMAL, 105, 95, CANNOT_EVOLVE},
-	{116, "Horsea", WATER, 30, 40, CAN_EVOLVE},
-	{117, "Seadra", WATER, 55, 65, CANNOT_EVOLVE},
-	{118, "Goldeen", WATER, 45, 67, CAN_EVOLVE},
-	{119, "Seaking", WATER, 80, 92, CANNOT_EVOLVE},
-	{120, "Staryu", WATER, 30, 45, CAN_EVOLVE},
-	{121, "Starmie", WATER, 60, 75, CANNOT_EVOLVE},
-	{122, "Mr. Mime", PSYCHIC, 40, 45, CANNOT_EVOLVE},
-	{123, "Scyther", BUG, 70, 110, CANNOT_EVOLVE},
-	{124, "Jynx", ICE, 65, 50, CANNOT_EVOLVE},
-	{125, "Electabuzz", ELECTRIC, 65, 83, CANNOT_EVOLVE},
-	{126, "Magmar", FIRE, 65, 95, CANNOT_EVOLVE},
-	{127, "Pinsir", BUG, 65, 125, CANNOT_EVOLVE},
-	{128, "Tauros", NORMAL, 75, 100, CANNOT_EVOLVE},
-	{129, "Magikarp", WATER, 20, 10, CAN_EVOLVE},
-	{130, "Gyarados", WATER, 95, 125, CANNOT_EVOLVE},
-	{131, "Lapras", WATER, 130, 85, CANNOT_EVOLVE},
-	{132, "Ditto", NORMAL, 48, 48, CANNOT_EVOLVE},
-	{133, "Eevee", NORMAL, 55, 55, CAN_EVOLVE},
-	{134, "Vaporeon", WATER, 130, 65, CANNOT_EVOLVE},
-	{135, "Jolteon", ELECTRIC, 65, 65, CANNOT_EVOLVE},
-	{136, "Flareon", FIRE, 65, 130, CANNOT_EVOLVE},
-	{137, "Porygon", NORMAL, 65, 60, CANNOT_EVOLVE},
-	{138, "Omanyte", ROCK, 35, 40, CAN_EVOLVE},
-	{139, "Omastar", ROCK, 70, 60, CANNOT_EVOLVE},
-	{140, "Kabuto", ROCK, 30, 80, CAN_EVOLVE},
-	{141, "Kabutops", ROCK, 60, 115, CANNOT_EVOLVE},
-	{142, "Aerodactyl", ROCK, 80, 105, CANNOT_EVOLVE},
-	{143, "Snorlax", NORMAL, 160, 110, CANNOT_EVOLVE},
-	{144, "Articuno", ICE, 90, 85, CANNOT_EVOLVE},
-	{145, "Zapdos", ELECTRIC, 90, 90, CANNOT_EVOLVE},
-	{146, "Moltres", FIRE, 90, 100, CANNOT_EVOLVE},
-	{147, "Dratini", DRAGON, 41, 64, CAN_EVOLVE},
-	{148, "Dragonair", DRAGON, 61, 84, CAN_EVOLVE},
-	{149, "Dragonite", DRAGON, 91, 134, CANNOT_EVOLVE},
-	{150, "Mewtwo", PSYCHIC, 106, 110, CANNOT_EVOLVE},
-	{151, "Mew", PSYCHIC, 100, 100, CANNOT_EVOLVE}};
-
-#endif // EX6_H
\ No newline at end of file
+void battleSimulator(void);
+
+/* ------------------------------------------------------------
+   27) Pipelined Replay
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Start the reader and writer threads and swap stdin/stdout for
+ *   streams over their queues.
+ * @return 1 on success, 0 if a queue, thread or stream could not be made
+ * Why we made it: A replayed script otherwise waits on each read, then
+ *   runs the command, then waits on each write. With -p the three overlap,
+ *   so a run takes as long as its slowest stage instead of the sum of all
+ *   three. Every fgets, getchar and printf works unchanged on the swapped streams.
+ */
+int pipelineStart(void);
+
+/**
+ * @brief Flush and write out everything printed, stop both threads and restore stdin/stdout.
+ */
+void pipelineFinish(void);
+
+/* ------------------------------------------------------------
+   28) Export
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Ask for a format and a file name (empty for the screen) and export.
+ */
+void exportMenu(PokedexContext *ctx);
+
+/* ------------------------------------------------------------
+   29) Import
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Ask for a file name, import it and print the report.
+ */
+void importMenu(PokedexContext *ctx);
+
+#endif // EX6_H
@@ -0,0 +1,327 @@
+// pkquery: read-only queries against the shared-memory replica that
+// "ex6 -r" publishes (layout in pkreplica.h). Nothing is sent to ex6:
+// the segment is mapped and read directly while ex6 keeps running.
+//
+//   pkquery [-r /name] count           owners and Pokemon
+//   pkquery [-r /name] owner NAME      one owner's species
+//   pkquery [-r /name] owns SPECIES    owners holding a species (ID or name)
+//   pkquery [-r /name] dump            every owner, as "name,id,id,..." lines
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "pkreplica.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct {
+	const char *name;
+	int fd;
+	const char *base;
+	size_t size;
+	ReplicaHeader header;    // copied at the start of each attempt
+	uint32_t layout;
+} Replica;
+
+// One owner record copied out under its seqlock
+typedef struct {
+	uint32_t live;
+	uint32_t nameLength;
+	uint32_t pokemonCount;
+	uint64_t nameOffset;
+	uint64_t *species;       // header.wordCount words
+} OwnerCopy;
+
+// Output is kept until the whole answer was read under one layout, so a
+// resize halfway through never prints a mix of the two.
+typedef struct {
+	char *data;
+	size_t length;
+	size_t capacity;
+} Output;
+
+
+// --------------------------------------------------------------
+// Mapping and consistency
+// --------------------------------------------------------------
+
+static void fail(const char *what) {
+	fprintf(stderr, "pkquery: %s: %s\n", what, strerror(errno));
+	exit(1);
+}
+
+
+static void mapReplica(Replica *r) {
+	struct stat st;
+	if (fstat(r->fd, &st) != 0) fail(r->name);
+	if (r->base) munmap((void *)r->base, r->size);
+	r->size = (size_t)st.st_size;
+	r->base = r->size >= sizeof(ReplicaHeader) ? mmap(NULL, r->size, PROT_READ, MAP_SHARED, r->fd, 0) : NULL;
+	if (r->base == MAP_FAILED) fail(r->name);
+}
+
+
+static void openReplica(Replica *r, const char *name) {
+	memset(r, 0, sizeof(*r));
+	r->name = name;
+	r->fd = shm_open(name, O_RDONLY, 0);
+	if (r->fd < 0) fail(name);
+	mapReplica(r);
+}
+
+
+static const ReplicaHeader *liveHeader(const Replica *r) {
+	return (const ReplicaHeader *)r->base;
+}
+
+
+// Wait until the writer is not laying the segment out, then copy the header.
+static void beginRead(Replica *r) {
+	for (;;) {
+		if (!r->base) {
+			// created a moment ago and not sized yet
+			sched_yield();
+			mapReplica(r);
+			continue;
+		}
+		uint32_t layout = __atomic_load_n(&liveHeader(r)->layout, __ATOMIC_ACQUIRE);
+		// odd while being laid out; 0 with no magic yet while it is first sized
+		if ((layout & 1) || (!layout && !liveHeader(r)->magic)) {
+			sched_yield();
+			continue;
+		}
+		memcpy(&r->header, r->base, sizeof(r->header));
+		if (r->header.magic != REPLICA_MAGIC || r->header.version != REPLICA_VERSION) {
+			fprintf(stderr, "pkquery: %s is not a Pokedex replica this tool can read.\n", r->name);
+			exit(1);
+		}
+		if (r->header.size > r->size) {
+			mapReplica(r);
+			continue;
+		}
+		r->layout = layout;
+		return;
+	}
+}
+
+
+// Did everything read since beginRead come from one layout?
+static int endRead(const Replica *r) {
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&liveHeader(r)->layout, __ATOMIC_RELAXED) == r->layout;
+}
+
+
+// Copy record handle. Returns 0 if the layout changed and the read must start over.
+static int readOwner(const Replica *r, uint32_t handle, OwnerCopy *copy) {
+	const ReplicaOwner *record = (const ReplicaOwner *)(r->base + r->header.ownersOffset + (size_t)handle * r->header.ownerStride);
+	for (;;) {
+		uint32_t sequence = __atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE);
+		if (sequence & 1) {
+			if (!endRead(r)) return 0;
+			sched_yield();
+			continue;
+		}
+		copy->live = __atomic_load_n(&record->live, __ATOMIC_RELAXED);
+		copy->nameLength = __atomic_load_n(&record->nameLength, __ATOMIC_RELAXED);
+		copy->pokemonCount = __atomic_load_n(&record->pokemonCount, __ATOMIC_RELAXED);
+		copy->nameOffset = __atomic_load_n(&record->nameOffset, __ATOMIC_RELAXED);
+		for (uint32_t w = 0; w < r->header.wordCount; w++)
+			copy->species[w] = __atomic_load_n(&record->species[w], __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&record->sequence, __ATOMIC_RELAXED) != sequence) continue;
+		// names are never rewritten in place, so a checked offset stays good for this layout
+		if (copy->live && (copy->nameOffset < r->header.namesOffset || copy->nameOffset + copy->nameLength > r->header.size)) {
+			if (!endRead(r)) return 0;
+			errno = EINVAL;
+			fail(r->name);
+		}
+		return 1;
+	}
+}
+
+
+// --------------------------------------------------------------
+// Queries
+// --------------------------------------------------------------
+
+static void put(Output *out, const char *text, size_t len) {
+	if (out->length + len + 1 > out->capacity) {
+		size_t capacity = out->capacity ? out->capacity : 4096;
+		while (capacity < out->length + len + 1) capacity *= 2;
+		char *temp = (char *)realloc(out->data, capacity);
+		if (!temp) fail("output");
+		out->data = temp;
+		out->capacity = capacity;
+	}
+	memcpy(out->data + out->length, text, len);
+	out->length += len;
+}
+
+
+static void putText(Output *out, const char *text) {
+	put(out, text, strlen(text));
+}
+
+
+static void putNumber(Output *out, unsigned long long value) {
+	char digits[24];
+	put(out, digits, (size_t)snprintf(digits, sizeof(digits), "%llu", value));
+}
+
+
+// The name as a CSV field, quoted the way ex6 checkpoints quote it.
+static void putName(Output *out, const char *name, size_t len) {
+	int quote = len && (name[0] == '#' || name[0] == ' ' || name[0] == '\t' || name[len - 1] == ' ' || name[len - 1] == '\t');
+	for (size_t i = 0; i < len && !quote; i++) quote = name[i] == ',' || name[i] == '"';
+	if (!quote) {
+		put(out, name, len);
+		return;
+	}
+	put(out, "\"", 1);
+	for (size_t i = 0; i < len; i++) {
+		if (name[i] == '"') put(out, "\"", 1);
+		put(out, name + i, 1);
+	}
+	put(out, "\"", 1);
+}
+
+
+static const ReplicaSpecies *speciesTable(const Replica *r) {
+	return (const ReplicaSpecies *)(r->base + r->header.speciesOffset);
+}
+
+
+// Catalog index of an ID or a species name (any case), or -1.
+static int findSpecies(const Replica *r, const char *text) {
+	const ReplicaSpecies *species = speciesTable(r);
+	char *end;
+	long id = strtol(text, &end, 10);
+	int byId = *text && *end == '\0';
+	size_t len = strlen(text);
+	for (uint32_t i = 0; i < r->header.speciesCount; i++) {
+		if (byId ? species[i].id == id
+			: species[i].nameLength == len && strncasecmp(r->base + species[i].nameOffset, text, len) == 0)
+			return (int)i;
+	}
+	return -1;
+}
+
+
+static void putSpecies(Output *out, const Replica *r, int index) {
+	const ReplicaSpecies *species = &speciesTable(r)[index];
+	put(out, r->base + species->nameOffset, species->nameLength);
+	put(out, " (", 2);
+	putNumber(out, (unsigned long long)species->id);
+	put(out, ")", 1);
+}
+
+
+// One attempt at the query; 0 if the layout changed and it must run again.
+static int runQuery(const Replica *r, const char *command, const char *argument, OwnerCopy *copy, Output *out) {
+	int target = -1;
+	if (strcmp(command, "owns") == 0 && (target = findSpecies(r, argument)) < 0) {
+		if (!endRead(r)) return 0;
+		fprintf(stderr, "pkquery: no species %s.\n", argument);
+		exit(1);
+	}
+	unsigned long long owners = 0;
+	unsigned long long pokemon = 0;
+	int found = 0;
+	for (uint32_t handle = 0; handle < r->header.ownerCapacity; handle++) {
+		if (!readOwner(r, handle, copy)) return 0;
+		if (!copy->live) continue;
+		const char *name = r->base + copy->nameOffset;
+		owners++;
+		pokemon += copy->pokemonCount;
+		if (strcmp(command, "owner") == 0) {
+			if (copy->nameLength != strlen(argument) || memcmp(name, argument, copy->nameLength) != 0) continue;
+			found = 1;
+			put(out, name, copy->nameLength);
+			put(out, ":", 1);
+			for (uint32_t i = 0; i < r->header.speciesCount; i++) {
+				if (!((copy->species[i / 64] >> (i % 64)) & 1)) continue;
+				put(out, " ", 1);
+				putSpecies(out, r, (int)i);
+			}
+			put(out, "\n", 1);
+			break;
+		} else if (strcmp(command, "owns") == 0) {
+			if (!((copy->species[target / 64] >> (target % 64)) & 1)) continue;
+			found++;
+			put(out, name, copy->nameLength);
+			put(out, "\n", 1);
+		} else if (strcmp(command, "dump") == 0) {
+			putName(out, name, copy->nameLength);
+			for (uint32_t i = 0; i < r->header.speciesCount; i++) {
+				if (!((copy->species[i / 64] >> (i % 64)) & 1)) continue;
+				put(out, ",", 1);
+				putNumber(out, (unsigned long long)speciesTable(r)[i].id);
+			}
+			put(out, "\n", 1);
+		}
+	}
+	if (strcmp(command, "count") == 0) {
+		putNumber(out, owners);
+		putText(out, " owners, ");
+		putNumber(out, pokemon);
+		putText(out, " Pokemon\n");
+	} else if (strcmp(command, "owner") == 0 && !found) {
+		putText(out, "No owner named ");
+		putText(out, argument);
+		putText(out, ".\n");
+	} else if (strcmp(command, "owns") == 0) {
+		putNumber(out, (unsigned long long)found);
+		putText(out, found == 1 ? " owner has " : " owners have ");
+		putSpecies(out, r, target);
+		putText(out, ".\n");
+	}
+	return endRead(r);
+}
+
+
+int main(int argc, char *argv[]) {
+	const char *name = REPLICA_NAME;
+	int i = 1;
+	if (i + 1 < argc && strcmp(argv[i], "-r") == 0) {
+		name = argv[i + 1];
+		i += 2;
+	}
+	const char *command = i < argc ? argv[i] : "";
+	const char *argument = i + 1 < argc ? argv[i + 1] : NULL;
+	int needsArgument = strcmp(command, "owner") == 0 || strcmp(command, "owns") == 0;
+	int known = needsArgument || strcmp(command, "count") == 0 || strcmp(command, "dump") == 0;
+	if (!known || (needsArgument && !argument)) {
+		fprintf(stderr, "Usage: %s [-r /name] count | owner NAME | owns SPECIES | dump\n", argv[0]);
+		return 1;
+	}
+	Replica r;
+	openReplica(&r, name);
+	OwnerCopy copy = {0};
+	Output out = {0};
+	size_t words = 0;
+	for (;;) {
+		beginRead(&r);
+		if (r.header.wordCount > words) {
+			words = r.header.wordCount;
+			free(copy.species);
+			copy.species = (uint64_t *)malloc(words * sizeof(uint64_t));
+			if (!copy.species) fail("memory");
+		}
+		out.length = 0;
+		if (runQuery(&r, command, argument, &copy, &out)) break;
+	}
+	fwrite(out.data, 1, out.length, stdout);
+	free(out.data);
+	free(copy.species);
+	munmap((void *)r.base, r.size);
+	close(r.fd);
+	return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef PKREPLICA_H
+#define PKREPLICA_H
+
+#include <stdint.h>
+
+/* ------------------------------------------------------------
+   Shared-memory replica layout, written by ex6 -r (see section 31
+   of pokedex.h) and read by pkquery. Only ex6 writes; any number of
+   processes map the segment read-only.
+   ------------------------------------------------------------ */
+
+#define REPLICA_NAME "/pokedex"    // default POSIX shared-memory name
+#define REPLICA_MAGIC 0x50524b50u  // "PKRP" in memory on little-endian machines
+#define REPLICA_VERSION 1
+
+// At the start of the segment. Offsets are in bytes from the segment start.
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t layout;         // odd while the writer resizes and rewrites the segment
+	uint32_t speciesCount;
+	uint64_t size;           // bytes in the segment; readers remap when it grows
+	uint64_t speciesOffset;  // ReplicaSpecies[speciesCount], by catalog index
+	uint64_t ownersOffset;   // ReplicaOwner records, one per owner handle
+	uint32_t ownerCapacity;  // records in the table
+	uint32_t ownerStride;    // bytes per record, bitmap included
+	uint32_t wordCount;      // 64-bit words in each species bitmap
+	uint32_t reserved;
+	uint64_t namesOffset;    // owner names, appended and never changed in place
+	uint64_t namesCapacity;
+	uint64_t namesUsed;
+	uint64_t updates;        // records rewritten since the segment was made
+} ReplicaHeader;
+
+typedef struct
+{
+	int32_t id;
+	uint32_t nameLength;
+	uint64_t nameOffset;
+} ReplicaSpecies;
+
+// One owner slot. Each record is its own seqlock: sequence is odd while
+// the writer changes it, and a reader keeps a copy only if it saw the
+// same even sequence before and after.
+typedef struct
+{
+	uint32_t sequence;
+	uint32_t live;           // 1 while the owner is in the ring
+	uint32_t nameLength;
+	uint32_t pokemonCount;
+	uint64_t nameOffset;
+	uint64_t species[];      // wordCount words; bit i = owns catalog index i
+} ReplicaOwner;
+
+#endif
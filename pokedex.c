@@ -0,0 +1,4466 @@
+#include "pokedex.h"
+#include "pkreplica.h"
+#include <ctype.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+# define LOWEST_ID (catalog.lowestId)
+# define HIGHEST_ID (catalog.highestId)
+
+# define DEFAULT_CATALOG "pokedex.csv"
+# define SPECIES_BLOCK 64
+# define MAX_STAT 32767
+# define FILTER_BUFFER 256
+# define MAX_ID_SPAN (1 << 24)
+
+# define SNAPSHOT_BUFFER (1 << 16)
+
+// Global species catalog, read-only once loaded and shared by every context
+Catalog catalog = {0};
+
+// Damage multiplier in halves, [attacker][defender]: 0 immune, 1 = 0.5x, 2 = 1x, 4 = 2x
+const uint8_t typeEffect[TYPE_COUNT][TYPE_COUNT] = {
+	// columns are defenders, in enum order (GRASS .. ICE)
+	/* GRASS    */ {1, 1, 4, 1, 2, 1, 2, 4, 2, 2, 2, 4, 2, 1, 2},
+	/* FIRE     */ {4, 1, 1, 4, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 4},
+	/* WATER    */ {1, 4, 1, 2, 2, 2, 2, 4, 2, 2, 2, 4, 2, 1, 2},
+	/* BUG      */ {4, 1, 2, 2, 2, 1, 2, 2, 1, 1, 4, 2, 1, 2, 2},
+	/* NORMAL   */ {2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 0, 2, 2},
+	/* POISON   */ {4, 2, 2, 2, 2, 1, 2, 1, 4, 2, 2, 1, 1, 2, 2},
+	/* ELECTRIC */ {1, 2, 4, 2, 2, 2, 1, 0, 2, 2, 2, 2, 2, 1, 2},
+	/* GROUND   */ {1, 4, 2, 1, 2, 4, 4, 2, 2, 2, 2, 4, 2, 2, 2},
+	/* FAIRY    */ {2, 1, 2, 2, 2, 1, 2, 2, 2, 4, 2, 2, 2, 4, 2},
+	/* FIGHTING */ {2, 2, 2, 1, 4, 1, 2, 2, 1, 2, 1, 4, 0, 2, 4},
+	/* PSYCHIC  */ {2, 2, 2, 2, 2, 4, 2, 2, 2, 4, 1, 2, 2, 2, 2},
+	/* ROCK     */ {2, 4, 2, 4, 2, 2, 2, 1, 2, 1, 2, 2, 2, 2, 4},
+	/* GHOST    */ {2, 2, 2, 2, 0, 2, 2, 2, 2, 2, 4, 2, 4, 2, 2},
+	/* DRAGON   */ {2, 2, 2, 2, 2, 2, 2, 2, 0, 2, 2, 2, 2, 4, 2},
+	/* ICE      */ {4, 1, 1, 2, 2, 2, 2, 4, 2, 2, 2, 2, 2, 4, 1}
+};
+
+// Built-in catalog, used when no catalog file is available
+static const PokemonData builtinPokedex[] = {
+	{1, "Bulbasaur", GRASS, 45, 49, CAN_EVOLVE},
+	{2, "Ivysaur", GRASS, 60, 62, CAN_EVOLVE},
+	{3, "Venusaur", GRASS, 80, 82, CANNOT_EVOLVE},
+	{4, "Charmander", FIRE, 39, 52, CAN_EVOLVE},
+	{5, "Charmeleon", FIRE, 58, 64, CAN_EVOLVE},
+	{6, "Charizard", FIRE, 78, 84, CANNOT_EVOLVE},
+	{7, "Squirtle", WATER, 44, 48, CAN_EVOLVE},
+	{8, "Wartortle", WATER, 59, 63, CAN_EVOLVE},
+	{9, "Blastoise", WATER, 79, 83, CANNOT_EVOLVE},
+	{10, "Caterpie", BUG, 45, 30, CAN_EVOLVE},
+	{11, "Metapod", BUG, 50, 20, CAN_EVOLVE},
+	{12, "Butterfree", BUG, 60, 45, CANNOT_EVOLVE},
+	{13, "Weedle", BUG, 40, 35, CAN_EVOLVE},
+	{14, "Kakuna", BUG, 45, 25, CAN_EVOLVE},
+	{15, "Beedrill", BUG, 65, 90, CANNOT_EVOLVE},
+	{16, "Pidgey", NORMAL, 40, 45, CAN_EVOLVE},
+	{17, "Pidgeotto", NORMAL, 63, 60, CAN_EVOLVE},
+	{18, "Pidgeot", NORMAL, 83, 80, CANNOT_EVOLVE},
+	{19, "Rattata", NORMAL, 30, 56, CAN_EVOLVE},
+	{20, "Raticate", NORMAL, 55, 81, CANNOT_EVOLVE},
+	{21, "Spearow", NORMAL, 40, 60, CAN_EVOLVE},
+	{22, "Fearow", NORMAL, 65, 90, CANNOT_EVOLVE},
+	{23, "Ekans", POISON, 35, 60, CAN_EVOLVE},
+	{24, "Arbok", POISON, 60, 85, CANNOT_EVOLVE},
+	{25, "Pikachu", ELECTRIC, 35, 55, CAN_EVOLVE},
+	{26, "Raichu", ELECTRIC, 60, 90, CANNOT_EVOLVE},
+	{27, "Sandshrew", GROUND, 50, 75, CAN_EVOLVE},
+	{28, "Sandslash", GROUND, 75, 100, CANNOT_EVOLVE},
+	{29, "NidoranF", POISON, 55, 47, CAN_EVOLVE},
+	{30, "Nidorina", POISON, 70, 62, CAN_EVOLVE},
+	{31, "Nidoqueen", POISON, 90, 92, CANNOT_EVOLVE},
+	{32, "NidoranM", POISON, 46, 57, CAN_EVOLVE},
+	{33, "Nidorino", POISON, 61, 72, CAN_EVOLVE},
+	{34, "Nidoking", POISON, 81, 102, CANNOT_EVOLVE},
+	{35, "Clefairy", FAIRY, 70, 45, CAN_EVOLVE},
+	{36, "Clefable", FAIRY, 95, 70, CANNOT_EVOLVE},
+	{37, "Vulpix", FIRE, 38, 41, CAN_EVOLVE},
+	{38, "Ninetales", FIRE, 73, 76, CANNOT_EVOLVE},
+	{39, "Jigglypuff", NORMAL, 115, 45, CAN_EVOLVE},
+	{40, "Wigglytuff", NORMAL, 140, 70, CANNOT_EVOLVE},
+	{41, "Zubat", POISON, 40, 45, CAN_EVOLVE},
+	{42, "Golbat", POISON, 75, 80, CAN_EVOLVE},
+	{43, "Oddish", GRASS, 45, 50, CAN_EVOLVE},
+	{44, "Gloom", GRASS, 60, 65, CAN_EVOLVE},
+	{45, "Vileplume", GRASS, 75, 80, CANNOT_EVOLVE},
+	{46, "Paras", BUG, 35, 70, CAN_EVOLVE},
+	{47, "Parasect", BUG, 60, 95, CANNOT_EVOLVE},
+	{48, "Venonat", BUG, 60, 55, CAN_EVOLVE},
+	{49, "Venomoth", BUG, 70, 65, CANNOT_EVOLVE},
+	{50, "Diglett", GROUND, 10, 55, CAN_EVOLVE},
+	{51, "Dugtrio", GROUND, 35, 80, CANNOT_EVOLVE},
+	{52, "Meowth", NORMAL, 40, 45, CAN_EVOLVE},
+	{53, "Persian", NORMAL, 65, 70, CANNOT_EVOLVE},
+	{54, "Psyduck", WATER, 50, 52, CAN_EVOLVE},
+	{55, "Golduck", WATER, 80, 82, CANNOT_EVOLVE},
+	{56, "Mankey", FIGHTING, 40, 80, CAN_EVOLVE},
+	{57, "Primeape", FIGHTING, 65, 105, CANNOT_EVOLVE},
+	{58, "Growlithe", FIRE, 55, 70, CAN_EVOLVE},
+	{59, "Arcanine", FIRE, 90, 110, CANNOT_EVOLVE},
+	{60, "Poliwag", WATER, 40, 50, CAN_EVOLVE},
+	{61, "Poliwhirl", WATER, 65, 65, CAN_EVOLVE},
+	{62, "Poliwrath", WATER, 90, 95, CANNOT_EVOLVE},
+	{63, "Abra", PSYCHIC, 25, 20, CAN_EVOLVE},
+	{64, "Kadabra", PSYCHIC, 40, 35, CAN_EVOLVE},
+	{65, "Alakazam", PSYCHIC, 55, 50, CANNOT_EVOLVE},
+	{66, "Machop", FIGHTING, 70, 80, CAN_EVOLVE},
+	{67, "Machoke", FIGHTING, 80, 100, CAN_EVOLVE},
+	{68, "Machamp", FIGHTING, 90, 130, CANNOT_EVOLVE},
+	{69, "Bellsprout", GRASS, 50, 75, CAN_EVOLVE},
+	{70, "Weepinbell", GRASS, 65, 90, CAN_EVOLVE},
+	{71, "Victreebel", GRASS, 80, 105, CANNOT_EVOLVE},
+	{72, "Tentacool", WATER, 40, 40, CAN_EVOLVE},
+	{73, "Tentacruel", WATER, 80, 70, CANNOT_EVOLVE},
+	{74, "Geodude", ROCK, 40, 80, CAN_EVOLVE},
+	{75, "Graveler", ROCK, 55, 95, CAN_EVOLVE},
+	{76, "Golem", ROCK, 80, 120, CANNOT_EVOLVE},
+	{77, "Ponyta", FIRE, 50, 85, CAN_EVOLVE},
+	{78, "Rapidash", FIRE, 65, 100, CANNOT_EVOLVE},
+	{79, "Slowpoke", WATER, 90, 65, CAN_EVOLVE},
+	{80, "Slowbro", WATER, 95, 75, CANNOT_EVOLVE},
+	{81, "Magnemite", ELECTRIC, 25, 35, CAN_EVOLVE},
+	{82, "Magneton", ELECTRIC, 50, 60, CANNOT_EVOLVE},
+	{83, "Farfetch'd", NORMAL, 52, 65, CANNOT_EVOLVE},
+	{84, "Doduo", NORMAL, 35, 85, CAN_EVOLVE},
+	{85, "Dodrio", NORMAL, 60, 110, CANNOT_EVOLVE},
+	{86, "Seel", WATER, 65, 45, CAN_EVOLVE},
+	{87, "Dewgong", WATER, 90, 70, CANNOT_EVOLVE},
+	{88, "Grimer", POISON, 80, 80, CAN_EVOLVE},
+	{89, "Muk", POISON, 105, 105, CANNOT_EVOLVE},
+	{90, "Shellder", WATER, 30, 65, CAN_EVOLVE},
+	{91, "Cloyster", WATER, 50, 95, CANNOT_EVOLVE},
+	{92, "Gastly", GHOST, 30, 35, CAN_EVOLVE},
+	{93, "Haunter", GHOST, 45, 50, CAN_EVOLVE},
+	{94, "Gengar", GHOST, 60, 65, CANNOT_EVOLVE},
+	{95, "Onix", ROCK, 35, 45, CANNOT_EVOLVE},
+	{96, "Drowzee", PSYCHIC, 60, 48, CAN_EVOLVE},
+	{97, "Hypno", PSYCHIC, 85, 73, CANNOT_EVOLVE},
+	{98, "Krabby", WATER, 30, 105, CAN_EVOLVE},
+	{99, "Kingler", WATER, 55, 130, CANNOT_EVOLVE},
+	{100, "Voltorb", ELECTRIC, 40, 30, CAN_EVOLVE},
+	{101, "Electrode", ELECTRIC, 60, 50, CANNOT_EVOLVE},
+	{102, "Exeggcute", GRASS, 60, 40, CAN_EVOLVE},
+	{103, "Exeggutor", GRASS, 95, 95, CANNOT_EVOLVE},
+	{104, "Cubone", GROUND, 50, 50, CAN_EVOLVE},
+	{105, "Marowak", GROUND, 60, 80, CANNOT_EVOLVE},
+	{106, "Hitmonlee", FIGHTING, 50, 120, CANNOT_EVOLVE},
+	{107, "Hitmonchan", FIGHTING, 50, 105, CANNOT_EVOLVE},
+	{108, "Lickitung", NORMAL, 90, 55, CANNOT_EVOLVE},
+	{109, "Koffing", POISON, 40, 65, CAN_EVOLVE},
+	{110, "Weezing", POISON, 65, 90, CANNOT_EVOLVE},
+	{111, "Rhyhorn", GROUND, 80, 85, CAN_EVOLVE},
+	{112, "Rhydon", GROUND, 105, 130, CANNOT_EVOLVE},
+	{113, "Chansey", NORMAL, 250, 5, CANNOT_EVOLVE},
+	{114, "Tangela", GRASS, 65, 55, CANNOT_EVOLVE},
+	{115, "Kangaskhan", NORMAL, 105, 95, CANNOT_EVOLVE},
+	{116, "Horsea", WATER, 30, 40, CAN_EVOLVE},
+	{117, "Seadra", WATER, 55, 65, CANNOT_EVOLVE},
+	{118, "Goldeen", WATER, 45, 67, CAN_EVOLVE},
+	{119, "Seaking", WATER, 80, 92, CANNOT_EVOLVE},
+	{120, "Staryu", WATER, 30, 45, CAN_EVOLVE},
+	{121, "Starmie", WATER, 60, 75, CANNOT_EVOLVE},
+	{122, "Mr. Mime", PSYCHIC, 40, 45, CANNOT_EVOLVE},
+	{123, "Scyther", BUG, 70, 110, CANNOT_EVOLVE},
+	{124, "Jynx", ICE, 65, 50, CANNOT_EVOLVE},
+	{125, "Electabuzz", ELECTRIC, 65, 83, CANNOT_EVOLVE},
+	{126, "Magmar", FIRE, 65, 95, CANNOT_EVOLVE},
+	{127, "Pinsir", BUG, 65, 125, CANNOT_EVOLVE},
+	{128, "Tauros", NORMAL, 75, 100, CANNOT_EVOLVE},
+	{129, "Magikarp", WATER, 20, 10, CAN_EVOLVE},
+	{130, "Gyarados", WATER, 95, 125, CANNOT_EVOLVE},
+	{131, "Lapras", WATER, 130, 85, CANNOT_EVOLVE},
+	{132, "Ditto", NORMAL, 48, 48, CANNOT_EVOLVE},
+	{133, "Eevee", NORMAL, 55, 55, CAN_EVOLVE},
+	{134, "Vaporeon", WATER, 130, 65, CANNOT_EVOLVE},
+	{135, "Jolteon", ELECTRIC, 65, 65, CANNOT_EVOLVE},
+	{136, "Flareon", FIRE, 65, 130, CANNOT_EVOLVE},
+	{137, "Porygon", NORMAL, 65, 60, CANNOT_EVOLVE},
+	{138, "Omanyte", ROCK, 35, 40, CAN_EVOLVE},
+	{139, "Omastar", ROCK, 70, 60, CANNOT_EVOLVE},
+	{140, "Kabuto", ROCK, 30, 80, CAN_EVOLVE},
+	{141, "Kabutops", ROCK, 60, 115, CANNOT_EVOLVE},
+	{142, "Aerodactyl", ROCK, 80, 105, CANNOT_EVOLVE},
+	{143, "Snorlax", NORMAL, 160, 110, CANNOT_EVOLVE},
+	{144, "Articuno", ICE, 90, 85, CANNOT_EVOLVE},
+	{145, "Zapdos", ELECTRIC, 90, 90, CANNOT_EVOLVE},
+	{146, "Moltres", FIRE, 90, 100, CANNOT_EVOLVE},
+	{147, "Dratini", DRAGON, 41, 64, CAN_EVOLVE},
+	{148, "Dragonair", DRAGON, 61, 84, CAN_EVOLVE},
+	{149, "Dragonite", DRAGON, 91, 134, CANNOT_EVOLVE},
+	{150, "Mewtwo", PSYCHIC, 106, 110, CANNOT_EVOLVE},
+	{151, "Mew", PSYCHIC, 100, 100, CANNOT_EVOLVE}};
+
+// --------------------------------------------------------------
+// 1) Utility: string copy
+// --------------------------------------------------------------
+
+
+char *myStrdup(const char *src) {
+	if (!src)
+		return NULL;
+	size_t len = strlen(src);
+	char *dest = (char *)malloc(len + 1);
+	if (!dest)
+		return NULL;
+	strcpy(dest, src);
+	return dest;
+}
+
+// --------------------------------------------------------------
+// 2) Utility: Get type name from enum
+// --------------------------------------------------------------
+const char *getTypeName(PokemonType type) {
+	switch (type) {
+		case GRASS: return "GRASS";
+		case FIRE: return "FIRE";
+		case WATER: return "WATER";
+		case BUG: return "BUG";
+		case NORMAL: return "NORMAL";
+		case POISON: return "POISON";
+		case ELECTRIC: return "ELECTRIC";
+		case GROUND: return "GROUND";
+		case FAIRY: return "FAIRY";
+		case FIGHTING: return "FIGHTING";
+		case PSYCHIC: return "PSYCHIC";
+		case ROCK: return "ROCK";
+		case GHOST: return "GHOST";
+		case DRAGON: return "DRAGON";
+		case ICE: return "ICE";
+	default: return "UNKNOWN";
+	}
+}
+
+
+// --------------------------------------------------------------
+// Utility: raw writes, ring order, trees and traversals
+// --------------------------------------------------------------
+
+
+int writeAll(int fd, const void *data, size_t len) {
+	const char *p = (const char *)data;
+	while (len > 0) {
+		ssize_t n = write(fd, p, len);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return 0;
+		}
+		p += n;
+		len -= (size_t)n;
+	}
+	return 1;
+}
+
+
+int ringLength(PokedexContext *ctx) {
+	if (!ctx->ownerHead) return 0;
+	int count = 0;
+	const OwnerNode *owner = ctx->ownerHead;
+	do {
+		count++;
+		owner = nextOwner(ctx, owner);
+	} while (owner != ctx->ownerHead);
+	return count;
+}
+
+
+void readRingOrder(PokedexContext *ctx, uint32_t *order, int count) {
+	const OwnerNode *owner = ctx->ownerHead;
+	for (int i = 0; i < count; i++, owner = nextOwner(ctx, owner)) order[i] = owner->handle;
+}
+
+
+// Relink the ring to follow order; order[0] becomes the head.
+static void relinkRing(PokedexContext *ctx, const uint32_t *order, int count) {
+	for (int i = 0; i < count; i++) {
+		OwnerNode *owner = ownerByHandle(ctx, order[i]);
+		owner->next = order[(i + 1) % count];
+		owner->prev = order[(i + count - 1) % count];
+	}
+	ctx->ownerHead = ownerByHandle(ctx, order[0]);
+}
+
+
+static int compareHandlesByName(const void *a, const void *b, void *arg) {
+	PokedexContext *ctx = (PokedexContext *)arg;
+	return compareOwnerNames(ownerByHandle(ctx, *(const uint32_t *)a), ownerByHandle(ctx, *(const uint32_t *)b));
+}
+
+void insertPokemonNode(PokemonNode **root, PokemonNode *newNode) {
+	while (*root) {
+		if (newNode->data->id < (*root)->data->id) root = &(*root)->left;
+		else if (newNode->data->id > (*root)->data->id) root = &(*root)->right;
+		else {
+			freePokemonNode(newNode);
+			return;
+		}
+	}
+	*root = newNode;
+	newNode->left = newNode->right = NULL;
+}
+
+void freePokemonTree(PokemonNode **root) {
+	// rotate left children up until there are none, then free and go right;
+	// no recursion and no stack, whatever the tree's shape
+	PokemonNode *node = *root;
+	while (node) {
+		if (node->left) {
+			PokemonNode *left = node->left;
+			node->left = left->right;
+			left->right = node;
+			node = left;
+		} else {
+			PokemonNode *next = node->right;
+			free(node);
+			node = next;
+		}
+	}
+	*root = NULL;
+}
+
+
+// Make room for one more entry; BFS unrolls the ring so head becomes 0.
+static int treeIterReserve(TreeIter *it) {
+	if (it->count < it->capacity) return 1;
+	int capacity = it->capacity * 2;
+	PokemonNode **items = (PokemonNode **)malloc(capacity * sizeof(PokemonNode *));
+	if (!items) return 0;
+	for (int i = 0; i < it->count; i++) items[i] = it->items[(it->head + i) % it->capacity];
+	if (it->items != it->inlineItems) free(it->items);
+	it->items = items;
+	it->head = 0;
+	it->capacity = capacity;
+	return 1;
+}
+
+
+// A node that cannot be pushed is lost, so the traversal ends at the next step.
+static int treeIterPush(TreeIter *it, PokemonNode *node) {
+	if (!treeIterReserve(it)) {
+		it->failed = 1;
+		return 0;
+	}
+	it->items[(it->head + it->count++) % it->capacity] = node;
+	return 1;
+}
+
+
+void treeIterInit(TreeIter *it, PokemonNode *root, TraversalOrder order) {
+	it->order = order;
+	it->items = it->inlineItems;
+	it->head = 0;
+	it->count = 0;
+	it->capacity = TREE_ITER_INLINE;
+	it->cursor = NULL;
+	it->lastVisited = NULL;
+	it->failed = 0;
+	if (!root) return;
+	if (order == ORDER_BFS || order == ORDER_PRE) treeIterPush(it, root);
+	else it->cursor = root;
+}
+
+
+PokemonNode *treeIterNext(TreeIter *it) {
+	PokemonNode *node;
+	if (it->failed) return NULL;
+	switch (it->order) {
+		case ORDER_BFS:
+			if (!it->count) return NULL;
+			node = it->items[it->head];
+			it->head = (it->head + 1) % it->capacity;
+			it->count--;
+			if (node->left) treeIterPush(it, node->left);
+			if (node->right) treeIterPush(it, node->right);
+			return node;
+		case ORDER_PRE:
+			if (!it->count) return NULL;
+			node = it->items[--it->count];
+			if (node->right) treeIterPush(it, node->right);
+			if (node->left) treeIterPush(it, node->left);
+			return node;
+		case ORDER_IN:
+			while (it->cursor) {
+				if (!treeIterPush(it, it->cursor)) return NULL;
+				it->cursor = it->cursor->left;
+			}
+			if (!it->count) return NULL;
+			node = it->items[--it->count];
+			it->cursor = node->right;
+			return node;
+		case ORDER_POST:
+			while (1) {
+				while (it->cursor) {
+					if (!treeIterPush(it, it->cursor)) return NULL;
+					it->cursor = it->cursor->left;
+				}
+				if (!it->count) return NULL;
+				node = it->items[it->count - 1];
+				if (node->right && it->lastVisited != node->right) {
+					it->cursor = node->right;
+					continue;
+				}
+				it->count--;
+				it->lastVisited = node;
+				return node;
+			}
+	}
+	return NULL;
+}
+
+
+int treeIterNextBatch(TreeIter *it, PokemonNode **out, int max) {
+	int n = 0;
+	while (n < max && (out[n] = treeIterNext(it)) != NULL) n++;
+	return it->failed ? -1 : n;
+}
+
+
+void treeIterFree(TreeIter *it) {
+	if (it->items != it->inlineItems) free(it->items);
+	it->items = it->inlineItems;
+	it->count = 0;
+}
+
+
+int traverseTree(PokemonNode *root, TraversalOrder order, VisitNodeCtxFunc visit, void *ctx) {
+	TreeIter it;
+	treeIterInit(&it, root, order);
+	PokemonNode *node;
+	int completed = 1;
+	while ((node = treeIterNext(&it)) != NULL) {
+		if (!visit(node, ctx)) {
+			completed = 0;
+			break;
+		}
+	}
+	if (it.failed) completed = -1;
+	treeIterFree(&it);
+	return completed;
+}
+
+
+// Adapter so the context-free VisitNodeFunc API runs on the iterators.
+static int visitWithoutContext(PokemonNode *node, void *ctx) {
+	VisitNodeFunc *visit = ctx;
+	(*visit)(node);
+	return 1;
+}
+
+
+int BFSGeneric(PokemonNode *root, VisitNodeFunc visit) {
+	if (!root || !visit) return 1;
+	return traverseTree(root, ORDER_BFS, visitWithoutContext, &visit) >= 0;
+}
+
+
+int preOrderGeneric(PokemonNode *root, VisitNodeFunc visit) {
+	if (!root || !visit) return 1;
+	return traverseTree(root, ORDER_PRE, visitWithoutContext, &visit) >= 0;
+}
+
+
+int inOrderGeneric(PokemonNode *root, VisitNodeFunc visit) {
+	if (!root || !visit) return 1;
+	return traverseTree(root, ORDER_IN, visitWithoutContext, &visit) >= 0;
+}
+
+
+int postOrderGeneric(PokemonNode *root, VisitNodeFunc visit) {
+	if (!root || !visit) return 1;
+	return traverseTree(root, ORDER_POST, visitWithoutContext, &visit) >= 0;
+}
+
+
+// --------------------------------------------------------------
+// Queues, BST Removal & Bulk Changes
+// --------------------------------------------------------------
+
+
+void initQueue(Queue *q) {
+	q->front = q->rear = NULL;
+}
+
+
+void enqueue(Queue *q, PokemonNode *p) {
+	QueueNode *n = (QueueNode *)malloc(sizeof(QueueNode));
+	if (!n) return;
+	n->pokemon = p;
+	n->next = NULL;
+	if (!q->rear) q->front = q->rear = n;
+	else q->rear = q->rear->next = n;
+}
+
+
+PokemonNode *dequeue(Queue *q) {
+	if (!q->front) return NULL;
+	QueueNode *n = q->front;
+	PokemonNode *p = n->pokemon;
+	if (!(q->front = n->next)) q->rear = NULL;
+	free(n);
+	return p;
+}
+
+
+void freeQueue(Queue *q) {
+	while (q->front) dequeue(q);
+	q->rear = NULL;
+}
+
+
+typedef struct {
+	int id;
+	PokemonNode *found;
+} SearchContext;
+
+
+static int matchPokemonID(PokemonNode *node, void *ctx) {
+	SearchContext *search = ctx;
+	if (node->data->id != search->id) return 1;
+	search->found = node;
+	return 0;
+}
+
+
+PokemonNode *searchPokemonBFS(PokemonNode *root, int id) {
+	SearchContext search = {id, NULL};
+	if (traverseTree(root, ORDER_BFS, matchPokemonID, &search) >= 0) return search.found;
+	// out of memory mid-search: it is a BST by ID, so descend instead
+	while (root && root->data->id != id) root = id < root->data->id ? root->left : root->right;
+	return root;
+}
+
+
+PokemonNode *removeNodeBST(PokemonNode *root, int id) {
+	if (!root || id < LOWEST_ID || id > HIGHEST_ID) return NULL;
+	if (id < root->data->id) root->left = removeNodeBST(root->left, id);
+	else if (id > root->data->id) root->right = removeNodeBST(root->right, id);
+	else {
+		if (!root->left && !root->right) {
+			freePokemonNode(root);
+			return NULL;
+		} else if (!root->left) {
+			PokemonNode *temp = root->right;
+			freePokemonNode(root);
+			return temp;
+		} else if (!root->right) {
+			PokemonNode *temp = root->left;
+			freePokemonNode(root);
+			return temp;
+		} else {
+			PokemonNode *temp = root->right;
+			while (temp->left) temp = temp->left;
+			root->data = temp->data;
+			root->right = removeNodeBST(root->right, temp->data->id);
+		}
+	}
+	return root;
+}
+
+
+PokemonNode *removePokemonByID(PokemonNode *root, int id) {
+	if (!searchPokemonBFS(root, id)) return root;
+	return removeNodeBST(root, id);
+}
+
+int releaseMatching(PokedexContext *ctx, OwnerNode *owner, const uint64_t *mask, uint16_t *released) {
+	Pokedex *dex = &owner->pokedex;
+	int kept = 0;
+	int count = 0;
+	for (int i = 0; i < dex->length; i++) {
+		int index = dex->slots[i];
+		if (index != SPECIES_TOMBSTONE && (mask[index / 64] >> (index % 64)) & 1) {
+			undoSavePokedex(ctx, owner);
+			break;
+		}
+	}
+	for (int i = 0; i < dex->length; i++) {
+		int index = dex->slots[i];
+		if (index == SPECIES_TOMBSTONE) continue;
+		if ((mask[index / 64] >> (index % 64)) & 1) {
+			const PokemonData *data = &catalog.species[index];
+			notePokemonRemoved(ctx, owner, data);
+			feedEmit(ctx, FEED_POKEMON_RELEASED, owner, (uint32_t)data->id, 0);
+			released[count++] = (uint16_t)index;
+		} else dex->slots[kept++] = (uint16_t)index;
+	}
+	dex->length = dex->live = kept;
+	return count;
+}
+
+
+void freePokemonNode(PokemonNode *node) {
+	if (!node) return;
+	node->data = NULL;
+	node->left = node->right = NULL;
+	free(node);
+}
+
+
+int evolveAllInPokedex(PokedexContext *ctx, OwnerNode *owner, int toFinal, EvolveChange *changes, int *released) {
+	int evolvedCount = 0;
+	int releasedCount = 0;
+	if (released) *released = 0;
+	Pokedex *dex = &owner->pokedex;
+	if (!dex->live) return 0;
+	// species each slot ends up as, decided in insertion order
+	uint64_t *taken = (uint64_t *)calloc(catalog.wordCount, sizeof(uint64_t));
+	int *changed = (int *)malloc(dex->live * sizeof(int));
+	const PokemonData **targets = (const PokemonData **)calloc(dex->live, sizeof(*targets));
+	if (!taken || !changed || !targets) {
+		free(taken);
+		free(changed);
+		free(targets);
+		return -1;
+	}
+	int changedCount = 0;
+	for (int i = 0; i < dex->length; i++) {
+		int index = dex->slots[i];
+		if (index == SPECIES_TOMBSTONE) continue;
+		int target = toFinal ? catalog.finalStage[index] : catalog.nextStage[index];
+		if (target < 0) target = index;
+		int duplicate = (taken[target / 64] >> (target % 64)) & 1;
+		taken[target / 64] |= 1ULL << (target % 64);
+		if (target != index || duplicate) {
+			// a NULL target means "release this one"
+			targets[changedCount] = duplicate ? NULL : &catalog.species[target];
+			changed[changedCount++] = i;
+		}
+	}
+	if (!notePokemonReserve(ctx, owner, targets, changedCount)) {
+		free(taken);
+		free(changed);
+		free(targets);
+		return -1;
+	}
+	if (changedCount) {
+		undoSavePokedex(ctx, owner);
+		feedEvolutions(ctx, owner, changed, targets, changedCount);
+	}
+	// drop the old species from the indexes first, so the new ones never collide
+	for (int i = 0; i < changedCount; i++) notePokemonRemoved(ctx, owner, &catalog.species[dex->slots[changed[i]]]);
+	for (int i = 0; i < changedCount; i++) {
+		int pos = changed[i];
+		const PokemonData *from = &catalog.species[dex->slots[pos]];
+		const PokemonData *to = targets[i];
+		if (changes) {
+			changes[i].from = from;
+			changes[i].to = to;
+		}
+		if (to) {
+			dex->slots[pos] = (uint16_t)(to - catalog.species);
+			notePokemonAdded(ctx, owner, to);  // reserved above
+			evolvedCount++;
+			continue;
+		}
+		int index = (int)(from - catalog.species);
+		int target = toFinal ? catalog.finalStage[index] : catalog.nextStage[index];
+		if (target >= 0 && target != index) evolvedCount++;
+		pokedexRemoveAt(dex, pos);
+		releasedCount++;
+	}
+	if (changes) changes[changedCount].from = NULL;
+	pokedexCompactIfSparse(dex);
+	free(taken);
+	free(targets);
+	free(changed);
+	if (released) *released = releasedCount;
+	return evolvedCount;
+}
+
+
+// --------------------------------------------------------------
+// Owners & the Ring
+// --------------------------------------------------------------
+
+
+void linkOwnerInCircularList(PokedexContext *ctx, OwnerNode *newOwner) {
+	OwnerNode *tail = prevOwner(ctx, ctx->ownerHead);
+	newOwner->prev = tail->handle;
+	newOwner->next = ctx->ownerHead->handle;
+	tail->next = newOwner->handle;
+	ctx->ownerHead->prev = newOwner->handle;
+}
+
+
+void removeOwnerFromCircularList(PokedexContext *ctx, OwnerNode *owner) {
+	if (!owner || !ctx->ownerHead || owner->next == NO_OWNER) return;
+	if (owner->next == owner->handle) ctx->ownerHead = NULL;
+	else {
+		OwnerNode *prev = prevOwner(ctx, owner);
+		OwnerNode *next = nextOwner(ctx, owner);
+		prev->next = next->handle;
+		next->prev = prev->handle;
+		if (ctx->ownerHead == owner) ctx->ownerHead = next;
+	}
+	owner->prev = owner->next = NO_OWNER;
+	replicaOwner(ctx, owner);
+}
+
+
+OwnerNode *nextOwner(PokedexContext *ctx, const OwnerNode *owner) {
+	return ownerByHandle(ctx, owner->next);
+}
+
+
+OwnerNode *prevOwner(PokedexContext *ctx, const OwnerNode *owner) {
+	return ownerByHandle(ctx, owner->prev);
+}
+
+
+OwnerNode *findOwnerByName(PokedexContext *ctx, const char *name) {
+	// names are unique in the ring, so a sweep over the slots finds the
+	// same owner a ring walk would; owners held only by undo are skipped.
+	// Hash and length reject almost every slot before any name byte is read.
+	size_t len = strlen(name);
+	uint32_t hash = hashOwnerName(name, len);
+	for (uint32_t handle = 0; handle < ctx->registry.nextHandle; handle++) {
+		OwnerNode *owner = ownerByHandle(ctx, handle);
+		if (owner && owner->nameHash == hash && owner->nameLength == len && owner->next != NO_OWNER
+			&& memcmp(owner->ownerName, name, len) == 0) return owner;
+	}
+	return NULL;
+}
+
+
+OwnerNode *createOwner(PokedexContext *ctx, const char *ownerName, const PokemonData *starter) {
+	if (!(ownerName || starter)) return NULL; 
+	OwnerNode *owner = registerOwner(ctx);
+	if (!owner) return NULL;
+	owner->stats.bestScore10 = -1;
+	if (!setOwnerName(ctx, owner, ownerName ? ownerName : "")
+		|| (starter && (!pokedexAppend(&owner->pokedex, starter) || !notePokemonAdded(ctx, owner, starter)))) {
+		pokedexFree(&owner->pokedex);
+		unregisterOwner(ctx, owner);
+		return NULL;
+	}
+	return owner;
+}
+
+
+void freeAllOwners(PokedexContext *ctx) {
+	// Everyone goes, so there is no index to keep right Pokemon by Pokemon:
+	// free each Pokedex array, then empty the owner sets and totals wholesale.
+	// Slots are released with their chunks in freeRegistry.
+	for (uint32_t handle = 0; handle < ctx->registry.nextHandle; handle++) {
+		OwnerNode *owner = ownerByHandle(ctx, handle);
+		if (!owner) continue;
+		pokedexFree(&owner->pokedex);
+		unregisterOwner(ctx, owner);
+	}
+	if (ctx->registry.speciesOwners)
+		for (int i = 0; i < catalog.count; i++) ctx->registry.speciesOwners[i].count = 0;
+	if (ctx->registry.coveredByRank) memset(ctx->registry.coveredByRank, 0, catalog.wordCount * sizeof(uint64_t));
+	ctx->registry.boardRoot = NO_OWNER;
+	memset(&ctx->summary, 0, sizeof(ctx->summary));
+	ctx->summary.bestSpecies = -1;
+	ctx->ownerHead = NULL;
+}
+
+
+void freeOwnerNode(PokedexContext *ctx, OwnerNode *owner) {
+	if (!owner) return;
+	// the species set, not the Pokedex: an owner kept for undo still has
+	// its Pokedex but was already counted out when it was detached
+	for (int rank = ownerFirstRank(owner); rank >= 0; rank = ownerFirstRank(owner))
+		notePokemonRemoved(ctx, owner, &catalog.species[catalog.byScore[rank]]);
+	removeOwnerFromCircularList(ctx, owner);
+	pokedexFree(&owner->pokedex);
+	unregisterOwner(ctx, owner);  // the slot goes back to the free list
+}
+
+
+PokemonNode *createPokemonNode(const PokemonData *data) {
+	PokemonNode *poke = (PokemonNode*)malloc(sizeof(PokemonNode));
+	if (!poke) return NULL;
+	poke->data = data;
+	poke->left = poke->right = NULL;
+	return poke;
+}
+
+
+// --------------------------------------------------------------
+// Pokedex Storage
+// --------------------------------------------------------------
+// Grows geometrically, so appending one at a time stays linear overall.
+int pokedexReserve(Pokedex *dex, int extra) {
+	if (dex->length + extra <= dex->capacity) return 1;
+	int capacity = dex->capacity ? dex->capacity * 2 : 4;
+	if (capacity < dex->length + extra) capacity = dex->length + extra;
+	uint16_t *temp = (uint16_t *)realloc(dex->slots, capacity * sizeof(uint16_t));
+	if (!temp) return 0;
+	dex->slots = temp;
+	dex->capacity = capacity;
+	return 1;
+}
+
+
+int pokedexAppend(Pokedex *dex, const PokemonData *data) {
+	if (!pokedexReserve(dex, 1)) return 0;
+	dex->slots[dex->length++] = (uint16_t)(data - catalog.species);
+	dex->live++;
+	return 1;
+}
+
+
+int pokedexFind(const Pokedex *dex, const PokemonData *data) {
+	uint16_t index = (uint16_t)(data - catalog.species);
+	for (int i = 0; i < dex->length; i++)
+		if (dex->slots[i] == index) return i;
+	return -1;
+}
+
+
+void pokedexRemoveAt(Pokedex *dex, int pos) {
+	if (pos < 0 || pos >= dex->length || dex->slots[pos] == SPECIES_TOMBSTONE) return;
+	dex->slots[pos] = SPECIES_TOMBSTONE;
+	dex->live--;
+	// trailing tombstones cost nothing to drop
+	while (dex->length > 0 && dex->slots[dex->length - 1] == SPECIES_TOMBSTONE) dex->length--;
+}
+
+
+void pokedexCompactIfSparse(Pokedex *dex) {
+	if (dex->length - dex->live <= dex->live) return;
+	int kept = 0;
+	for (int i = 0; i < dex->length; i++)
+		if (dex->slots[i] != SPECIES_TOMBSTONE) dex->slots[kept++] = dex->slots[i];
+	dex->length = kept;
+}
+
+
+PokemonNode *pokedexToTree(const Pokedex *dex) {
+	if (!dex->live) return NULL;
+	// species are unique in a Pokedex, so every node is inserted and the
+	// first one stays the root: freeing the root frees the whole block
+	PokemonNode *nodes = (PokemonNode *)malloc(dex->live * sizeof(PokemonNode));
+	if (!nodes) return NULL;
+	PokemonNode *treeRoot = NULL;
+	int used = 0;
+	for (int i = 0; i < dex->length; i++) {
+		if (dex->slots[i] == SPECIES_TOMBSTONE) continue;
+		PokemonNode *node = &nodes[used++];
+		node->data = &catalog.species[dex->slots[i]];
+		insertPokemonNode(&treeRoot, node);
+	}
+	return treeRoot;
+}
+
+
+void freePokedexTree(PokemonNode **root) {
+	free(*root);
+	*root = NULL;
+}
+
+
+void pokedexFree(Pokedex *dex) {
+	free(dex->slots);
+	memset(dex, 0, sizeof(*dex));
+}
+
+
+// --------------------------------------------------------------
+// Undo / Redo
+// --------------------------------------------------------------
+static Change *newChange(PokedexContext *ctx, ChangeKind kind) {
+	UndoCommand *cmd = &ctx->history.pending;
+	if (cmd->count == cmd->capacity) {
+		int capacity = cmd->capacity ? cmd->capacity * 2 : 4;
+		Change *temp = (Change *)realloc(cmd->changes, capacity * sizeof(Change));
+		if (!temp) {
+			ctx->history.failed = 1;
+			return NULL;
+		}
+		cmd->changes = temp;
+		cmd->capacity = capacity;
+	}
+	Change *c = &cmd->changes[cmd->count++];
+	memset(c, 0, sizeof(*c));
+	c->kind = kind;
+	return c;
+}
+
+
+// Free an owner that only the history still holds; it is out of the ring already.
+static void freeRetiredOwner(PokedexContext *ctx, OwnerNode *owner) {
+	ctx->summary.ownerCount++;  // detachOwner counted it out; unregisterOwner will again
+	freeOwnerNode(ctx, owner);
+}
+
+
+static void detachOwner(PokedexContext *ctx, OwnerNode *owner, Change *c) {
+	c->wasHead = (owner == ctx->ownerHead);
+	c->prevHandle = owner->prev;  // its own handle if it is alone
+	const Pokedex *dex = &owner->pokedex;
+	for (int i = 0; i < dex->length; i++)
+		if (dex->slots[i] != SPECIES_TOMBSTONE) notePokemonRemoved(ctx, owner, &catalog.species[dex->slots[i]]);
+	removeOwnerFromCircularList(ctx, owner);
+	ctx->summary.ownerCount--;
+	c->present = 0;
+	feedEmit(ctx, FEED_OWNER_DELETED, owner, 0, 0);
+}
+
+
+static void attachOwner(PokedexContext *ctx, OwnerNode *owner, Change *c) {
+	if (!ctx->ownerHead) {
+		ctx->ownerHead = owner;
+		owner->prev = owner->next = owner->handle;
+	}
+	else {
+		OwnerNode *prev = ownerByHandle(ctx, c->prevHandle);
+		OwnerNode *next = nextOwner(ctx, prev);
+		owner->prev = prev->handle;
+		owner->next = next->handle;
+		next->prev = owner->handle;
+		prev->next = owner->handle;
+		if (c->wasHead) ctx->ownerHead = owner;
+	}
+	// the owner held these before it was detached, and the species sets
+	// never shrink, so noting them again cannot run out of memory
+	const Pokedex *dex = &owner->pokedex;
+	for (int i = 0; i < dex->length; i++)
+		if (dex->slots[i] != SPECIES_TOMBSTONE) notePokemonAdded(ctx, owner, &catalog.species[dex->slots[i]]);
+	ctx->summary.ownerCount++;
+	c->present = 1;
+	replicaOwner(ctx, owner);
+	feedOwnerCreated(ctx, owner);
+}
+
+
+static void flipChange(PokedexContext *ctx, Change *c) {
+	switch (c->kind) {
+		case CHANGE_POKEDEX: {
+			OwnerNode *owner = ownerByHandle(ctx, c->handle);
+			Pokedex *dex = &owner->pokedex;
+			feedPokedexDifference(ctx, owner, &c->other, FEED_POKEMON_ADDED);
+			for (int i = 0; i < dex->length; i++)
+				if (dex->slots[i] != SPECIES_TOMBSTONE) notePokemonRemoved(ctx, owner, &catalog.species[dex->slots[i]]);
+			Pokedex current = *dex;
+			*dex = c->other;
+			c->other = current;
+			// a state the sets already held once, so this needs no memory
+			for (int i = 0; i < dex->length; i++)
+				if (dex->slots[i] != SPECIES_TOMBSTONE) notePokemonAdded(ctx, owner, &catalog.species[dex->slots[i]]);
+			feedPokedexDifference(ctx, owner, &c->other, FEED_POKEMON_RELEASED);
+			break;
+		}
+		case CHANGE_OWNER: {
+			OwnerNode *owner = ownerByHandle(ctx, c->handle);
+			if (c->present) detachOwner(ctx, owner, c);
+			else attachOwner(ctx, owner, c);
+			break;
+		}
+		case CHANGE_ORDER: {
+			// owners are unchanged, only their links: relink in the saved order,
+			// keeping the current one in the second half of the buffer
+			int n = c->orderCount;
+			uint32_t *saved = c->order;
+			uint32_t *current = c->order + n;
+			readRingOrder(ctx, current, n);
+			relinkRing(ctx, saved, n);
+			memcpy(saved, current, n * sizeof(uint32_t));
+			if (ctx->changeFeed.slots) feedEmit(ctx, FEED_OWNERS_REORDERED, ctx->ownerHead, 0, 0);
+			break;
+		}
+	}
+}
+
+
+static void discardCommand(PokedexContext *ctx, UndoCommand *cmd) {
+	for (int i = 0; i < cmd->count; i++) {
+		Change *c = &cmd->changes[i];
+		if (c->kind == CHANGE_POKEDEX) pokedexFree(&c->other);
+		else if (c->kind == CHANGE_ORDER) free(c->order);
+		else if (!c->present) freeRetiredOwner(ctx, ownerByHandle(ctx, c->handle));
+	}
+	free(cmd->changes);
+	memset(cmd, 0, sizeof(*cmd));
+}
+
+
+// Forget every step; the live state stays as it is.
+static void clearHistory(PokedexContext *ctx) {
+	for (int i = 0; i < ctx->history.count; i++) discardCommand(ctx, &ctx->history.commands[i]);
+	ctx->history.count = ctx->history.done = 0;
+}
+
+
+void undoBegin(PokedexContext *ctx, const char *label) {
+	memset(&ctx->history.pending, 0, sizeof(ctx->history.pending));
+	ctx->history.pending.label = label;
+	ctx->history.recording = 1;
+	ctx->history.failed = 0;
+}
+
+
+void undoEnd(PokedexContext *ctx) {
+	if (!ctx->history.recording) return;
+	ctx->history.recording = 0;
+	if (ctx->history.pending.count || ctx->history.failed) checkpointNoteChange(ctx);
+	if (ctx->history.failed) {
+		// this command cannot be reverted, and older steps may not fit on top of it
+		discardCommand(ctx, &ctx->history.pending);
+		clearHistory(ctx);
+		return;
+	}
+	if (!ctx->history.pending.count) {
+		discardCommand(ctx, &ctx->history.pending);
+		return;
+	}
+	while (ctx->history.count > ctx->history.done) discardCommand(ctx, &ctx->history.commands[--ctx->history.count]);
+	if (ctx->history.count == UNDO_DEPTH) {
+		discardCommand(ctx, &ctx->history.commands[0]);
+		memmove(ctx->history.commands, ctx->history.commands + 1, (UNDO_DEPTH - 1) * sizeof(UndoCommand));
+		ctx->history.count--;
+	}
+	ctx->history.commands[ctx->history.count++] = ctx->history.pending;
+	ctx->history.done = ctx->history.count;
+	memset(&ctx->history.pending, 0, sizeof(ctx->history.pending));
+}
+
+
+void undoSavePokedex(PokedexContext *ctx, OwnerNode *owner) {
+	if (!ctx->history.recording || ctx->history.failed) return;
+	UndoCommand *cmd = &ctx->history.pending;
+	for (int i = 0; i < cmd->count; i++)
+		if (cmd->changes[i].kind == CHANGE_POKEDEX && cmd->changes[i].handle == owner->handle) return;
+	const Pokedex *dex = &owner->pokedex;
+	Pokedex copy = {0};
+	if (dex->live) {
+		copy.slots = (uint16_t *)malloc(dex->live * sizeof(uint16_t));
+		if (!copy.slots) {
+			ctx->history.failed = 1;
+			return;
+		}
+		for (int i = 0; i < dex->length; i++)
+			if (dex->slots[i] != SPECIES_TOMBSTONE) copy.slots[copy.length++] = dex->slots[i];
+		copy.capacity = copy.live = copy.length;
+	}
+	Change *c = newChange(ctx, CHANGE_POKEDEX);
+	if (!c) {
+		pokedexFree(&copy);
+		return;
+	}
+	c->handle = owner->handle;
+	c->other = copy;
+}
+
+
+void undoOwnerCreated(PokedexContext *ctx, OwnerNode *owner) {
+	if (!ctx->history.recording || ctx->history.failed) return;
+	Change *c = newChange(ctx, CHANGE_OWNER);
+	if (!c) return;
+	c->handle = owner->handle;
+	c->present = 1;
+}
+
+
+void undoSaveOrder(PokedexContext *ctx) {
+	if (!ctx->history.recording || ctx->history.failed || !ctx->ownerHead) return;
+	int count = ringLength(ctx);
+	// second half is scratch space for flipping
+	uint32_t *order = (uint32_t *)malloc(2 * (size_t)count * sizeof(uint32_t));
+	if (!order) {
+		ctx->history.failed = 1;
+		return;
+	}
+	readRingOrder(ctx, order, count);
+	Change *c = newChange(ctx, CHANGE_ORDER);
+	if (!c) {
+		free(order);
+		return;
+	}
+	c->order = order;
+	c->orderCount = count;
+}
+
+
+void retireOwner(PokedexContext *ctx, OwnerNode *owner) {
+	Change *c = NULL;
+	if (ctx->history.recording && !ctx->history.failed) c = newChange(ctx, CHANGE_OWNER);
+	if (!c) {
+		feedEmit(ctx, FEED_OWNER_DELETED, owner, 0, 0);
+		freeOwnerNode(ctx, owner);
+		return;
+	}
+	c->handle = owner->handle;
+	detachOwner(ctx, owner, c);
+}
+
+
+const char *undoLast(PokedexContext *ctx) {
+	if (!ctx->history.done) return NULL;
+	UndoCommand *cmd = &ctx->history.commands[--ctx->history.done];
+	for (int i = cmd->count - 1; i >= 0; i--) flipChange(ctx, &cmd->changes[i]);
+	return cmd->label;
+}
+
+
+const char *redoLast(PokedexContext *ctx) {
+	if (ctx->history.done == ctx->history.count) return NULL;
+	UndoCommand *cmd = &ctx->history.commands[ctx->history.done++];
+	for (int i = 0; i < cmd->count; i++) flipChange(ctx, &cmd->changes[i]);
+	return cmd->label;
+}
+
+
+void freeHistory(PokedexContext *ctx) {
+	if (ctx->history.recording) discardCommand(ctx, &ctx->history.pending);
+	ctx->history.recording = 0;
+	clearHistory(ctx);
+}
+
+
+// --------------------------------------------------------------
+// Checkpoints
+// --------------------------------------------------------------
+
+// What the writer child sends back through its pipe.
+typedef struct {
+	int ok;
+	int error;          // errno of the failed call
+	long owners;
+	long pokemon;
+	double seconds;     // time spent serializing
+	double finishedAt;  // monotonic time the file was in place
+} CheckpointReport;
+
+
+double monotonicSeconds(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+// A name too long for the snapshot buffer, written straight to fd.
+static int writeLongName(int fd, const char *name, size_t len, int quote) {
+	if (!quote) return writeAll(fd, name, len);
+	if (!writeAll(fd, "\"", 1)) return 0;
+	const char *end = name + len;
+	while (name < end) {
+		// up to and including the next quote, which is then doubled
+		const char *q = memchr(name, '"', end - name);
+		const char *stop = q ? q + 1 : end;
+		if (!writeAll(fd, name, stop - name) || (q && !writeAll(fd, "\"", 1))) return 0;
+		name = stop;
+	}
+	return writeAll(fd, "\"", 1);
+}
+
+
+int writeSnapshot(PokedexContext *ctx, int fd, long *owners, long *pokemon) {
+	long ownerCount = 0;
+	long pokemonCount = 0;
+	char *buf = (char *)malloc(SNAPSHOT_BUFFER);
+	if (!buf) {
+		errno = ENOMEM;
+		return 0;
+	}
+	size_t used = (size_t)snprintf(buf, SNAPSHOT_BUFFER, "# Pokedex snapshot: owner,id,id,... in ring and insertion order\n");
+	int ok = 1;
+	OwnerNode *owner = ctx->ownerHead;
+	while (ok && owner) {
+		const char *name = owner->ownerName;
+		size_t len = owner->nameLength;
+		const char *lastChar = name + len - (len > 0);
+		// quote whatever a reader would split, skip or trim
+		int quote = strpbrk(name, ",\"") || name[0] == '#' || name[0] == ' ' || name[0] == '\t'
+			|| *lastChar == ' ' || *lastChar == '\t';
+		// worst case for the name is every character doubled plus quotes
+		size_t need = 2 * len + 3;
+		if (used + need > SNAPSHOT_BUFFER) {
+			ok = writeAll(fd, buf, used);
+			used = 0;
+		}
+		if (!ok) break;
+		if (need > SNAPSHOT_BUFFER) ok = writeLongName(fd, name, len, quote);
+		else if (quote) {
+			buf[used++] = '"';
+			for (; *name; name++) {
+				if (*name == '"') buf[used++] = '"';
+				buf[used++] = *name;
+			}
+			buf[used++] = '"';
+		} else {
+			memcpy(buf + used, name, len);
+			used += len;
+		}
+		const Pokedex *dex = &owner->pokedex;
+		for (int i = 0; ok && i < dex->length; i++) {
+			if (dex->slots[i] == SPECIES_TOMBSTONE) continue;
+			if (used + 16 > SNAPSHOT_BUFFER) {
+				ok = writeAll(fd, buf, used);
+				used = 0;
+			}
+			used += (size_t)snprintf(buf + used, 16, ",%d", catalog.species[dex->slots[i]].id);
+			pokemonCount++;
+		}
+		buf[used++] = '\n';
+		ownerCount++;
+		owner = nextOwner(ctx, owner);
+		if (owner == ctx->ownerHead) break;
+	}
+	if (ok) ok = writeAll(fd, buf, used);
+	free(buf);
+	if (owners) *owners = ownerCount;
+	if (pokemon) *pokemon = pokemonCount;
+	return ok;
+}
+
+
+// Child side: write to path.tmp, then rename over path so readers never see half a file.
+static void writeSnapshotFile(PokedexContext *ctx, CheckpointReport *report) {
+	size_t len = strlen(ctx->checkpoint.path);
+	char *temp = (char *)malloc(len + 5);
+	if (!temp) {
+		report->error = ENOMEM;
+		return;
+	}
+	memcpy(temp, ctx->checkpoint.path, len);
+	memcpy(temp + len, ".tmp", 5);
+	int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		report->error = errno;
+		free(temp);
+		return;
+	}
+	int ok = writeSnapshot(ctx, fd, &report->owners, &report->pokemon) && fsync(fd) == 0;
+	if (!ok) report->error = errno;
+	if (close(fd) != 0 && ok) {
+		report->error = errno;
+		ok = 0;
+	}
+	if (ok && rename(temp, ctx->checkpoint.path) != 0) {
+		report->error = errno;
+		ok = 0;
+	}
+	if (!ok) unlink(temp);
+	free(temp);
+	report->ok = ok;
+}
+
+
+// Hand a result to the caller's callback, if it set one.
+static void deliverCheckpoint(PokedexContext *ctx, CheckpointResult *result) {
+	result->number = ctx->checkpoint.number;
+	result->path = ctx->checkpoint.path;
+	result->changesBehind = ctx->checkpoint.changes;
+	if (ctx->checkpoint.onResult) ctx->checkpoint.onResult(result, ctx->checkpoint.resultArg);
+}
+
+
+static void reportCheckpoint(PokedexContext *ctx, int status) {
+	CheckpointReport report;
+	memset(&report, 0, sizeof(report));
+	ssize_t got = read(ctx->checkpoint.reportFd, &report, sizeof(report));
+	close(ctx->checkpoint.reportFd);
+	ctx->checkpoint.reportFd = -1;
+	ctx->checkpoint.writer = 0;
+	CheckpointResult result;
+	memset(&result, 0, sizeof(result));
+	result.started = 1;
+	result.ok = got == (ssize_t)sizeof(report) && WIFEXITED(status) && report.ok;
+	result.error = report.error;
+	if (result.ok) {
+		result.owners = report.owners;
+		result.pokemon = report.pokemon;
+		result.pauseSeconds = ctx->checkpoint.forkSeconds;
+		result.writeSeconds = report.seconds;
+		result.doneAfter = report.finishedAt - ctx->checkpoint.lastAt;
+	}
+	deliverCheckpoint(ctx, &result);
+}
+
+
+// The writer could not be started; errno says why.
+static void reportCheckpointNotStarted(PokedexContext *ctx) {
+	CheckpointResult result;
+	memset(&result, 0, sizeof(result));
+	result.error = errno;
+	deliverCheckpoint(ctx, &result);
+}
+
+
+void checkpointNoteChange(PokedexContext *ctx) {
+	if (ctx->checkpoint.path) ctx->checkpoint.changes++;
+}
+
+
+int checkpointStart(PokedexContext *ctx) {
+	if (!ctx->checkpoint.path || ctx->checkpoint.writer) return 0;
+	int fds[2];
+	if (pipe(fds) != 0) {
+		reportCheckpointNotStarted(ctx);
+		return 0;
+	}
+	// the child leaves with _exit, so it never flushes the caller's stdio buffers
+	double capturedAt = monotonicSeconds();
+	pid_t pid = fork();
+	if (pid < 0) {
+		reportCheckpointNotStarted(ctx);
+		close(fds[0]);
+		close(fds[1]);
+		return 0;
+	}
+	if (pid == 0) {
+		close(fds[0]);
+		CheckpointReport report;
+		memset(&report, 0, sizeof(report));
+		double start = monotonicSeconds();
+		writeSnapshotFile(ctx, &report);
+		report.finishedAt = monotonicSeconds();
+		report.seconds = report.finishedAt - start;
+		writeAll(fds[1], &report, sizeof(report));
+		_exit(report.ok ? 0 : 1);
+	}
+	close(fds[1]);
+	ctx->checkpoint.forkSeconds = monotonicSeconds() - capturedAt;
+	ctx->checkpoint.writer = pid;
+	ctx->checkpoint.reportFd = fds[0];
+	ctx->checkpoint.lastAt = capturedAt;
+	ctx->checkpoint.changes = 0;
+	ctx->checkpoint.number++;
+	return 1;
+}
+
+
+void checkpointPoll(PokedexContext *ctx) {
+	if (!ctx->checkpoint.path) return;
+	if (ctx->checkpoint.writer) {
+		int status = 0;
+		pid_t done = waitpid(ctx->checkpoint.writer, &status, WNOHANG);
+		if (done == 0) return;  // still writing
+		reportCheckpoint(ctx, status);
+	}
+	if (!ctx->checkpoint.changes) return;
+	if ((ctx->checkpoint.everyChanges && ctx->checkpoint.changes >= ctx->checkpoint.everyChanges)
+		|| (ctx->checkpoint.everySeconds && monotonicSeconds() - ctx->checkpoint.lastAt >= ctx->checkpoint.everySeconds))
+		checkpointStart(ctx);
+}
+
+
+void checkpointFinish(PokedexContext *ctx) {
+	if (!ctx->checkpoint.path) return;
+	int status = 0;
+	if (ctx->checkpoint.writer) {
+		waitpid(ctx->checkpoint.writer, &status, 0);
+		reportCheckpoint(ctx, status);
+	}
+	if (ctx->checkpoint.changes && checkpointStart(ctx)) {
+		waitpid(ctx->checkpoint.writer, &status, 0);
+		reportCheckpoint(ctx, status);
+	}
+}
+
+
+// --------------------------------------------------------------
+// Species Catalog
+// --------------------------------------------------------------
+
+// One parsed catalog line before the index tables are built.
+typedef struct {
+	PokemonData data;
+	int evolvesTo;
+	int line;
+} CatalogRow;
+
+
+int typeFromName(const char *name, size_t len) {
+	for (int t = 0; t < TYPE_COUNT; t++) {
+		const char *typeName = getTypeName((PokemonType)t);
+		size_t i = 0;
+		while (i < len && typeName[i] && toupper((unsigned char)name[i]) == typeName[i]) i++;
+		if (i == len && !typeName[i]) return t;
+	}
+	return -1;
+}
+
+
+const PokemonData *speciesById(int id) {
+	if (!catalog.species || id < LOWEST_ID || id > HIGHEST_ID) return NULL;
+	int slot = catalog.slotById[id - LOWEST_ID];
+	return slot < 0 ? NULL : &catalog.species[slot];
+}
+
+
+const PokemonData *evolutionOf(const PokemonData *data) {
+	if (!data) return NULL;
+	int next = catalog.nextStage[data - catalog.species];
+	return next < 0 ? NULL : &catalog.species[next];
+}
+
+
+static unsigned char foldNameChar(char ch) {
+	return (unsigned char)tolower((unsigned char)ch);
+}
+
+
+// Case-insensitive name hash; every output bit depends on every input byte.
+static uint64_t hashSpeciesName(const char *name, size_t len) {
+	uint64_t h = 1469598103934665603ULL;
+	for (size_t i = 0; i < len; i++) {
+		h ^= foldNameChar(name[i]);
+		h *= 1099511628211ULL;
+	}
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+
+// Slot of a name hash under bucket displacement (d0, d1).
+static uint32_t nameSlotOf(uint64_t h, uint32_t slots, uint32_t d0, uint32_t d1) {
+	uint64_t f1 = (uint32_t)h % slots;
+	uint64_t f2 = (uint32_t)(h >> 32) % slots;
+	return (uint32_t)((f1 + (uint64_t)d0 * f2 + d1) % slots);
+}
+
+
+static uint32_t nameBucketOf(uint64_t h, uint32_t buckets) {
+	return (uint32_t)((h >> 16) % buckets);
+}
+
+
+// Compare a species name with the first plen characters of prefix, ignoring case.
+static int compareNamePrefix(const char *name, const char *prefix, size_t plen) {
+	for (size_t i = 0; i < plen; i++) {
+		unsigned char a = name[i] ? foldNameChar(name[i]) : 0;
+		unsigned char b = foldNameChar(prefix[i]);
+		if (a != b || !a) return (int)a - (int)b;
+	}
+	return 0;
+}
+
+
+static const Catalog *sortingCatalog;
+
+static int compareSpeciesNames(const void *a, const void *b) {
+	int i1 = *(const int *)a;
+	int i2 = *(const int *)b;
+	const char *n1 = sortingCatalog->species[i1].name;
+	const char *n2 = sortingCatalog->species[i2].name;
+	int diff = compareNamePrefix(n1, n2, strlen(n2) + 1);
+	return diff ? diff : i1 - i2;
+}
+
+
+// Higher fight score first; equal scores by catalog index, i.e. by ID.
+static int compareSpeciesScores(const void *a, const void *b) {
+	int i1 = *(const int *)a;
+	int i2 = *(const int *)b;
+	int s1 = fightScore10(&sortingCatalog->species[i1]);
+	int s2 = fightScore10(&sortingCatalog->species[i2]);
+	return s1 != s2 ? s2 - s1 : i1 - i2;
+}
+
+
+static int compareBucketSizes(const void *a, const void *b) {
+	const uint32_t *b1 = a;
+	const uint32_t *b2 = b;
+	// [0] = size, [1] = bucket; larger buckets first, then bucket number
+	if (b1[0] != b2[0]) return b1[0] < b2[0] ? 1 : -1;
+	return (b1[1] > b2[1]) - (b1[1] < b2[1]);
+}
+
+
+// Build the sorted prefix index and a CHD-style perfect hash over the names.
+// Names that differ only in case resolve to the lowest ID.
+static int buildNameIndex(Catalog *c) {
+	int n = c->count;
+	c->byName = (int *)malloc(n * sizeof(int));
+	if (!c->byName) return 0;
+	for (int i = 0; i < n; i++) c->byName[i] = i;
+	sortingCatalog = c;
+	qsort(c->byName, n, sizeof(int), compareSpeciesNames);
+	c->nameBuckets = (uint32_t)(n + 3) / 4;
+	c->nameSlots = (uint32_t)n + (uint32_t)n / 4 + 1;
+	c->nameDisplace = (uint32_t *)calloc(2 * (size_t)c->nameBuckets, sizeof(uint32_t));
+	c->nameSlot = (int *)malloc(c->nameSlots * sizeof(int));
+	uint64_t *hashes = (uint64_t *)malloc(n * sizeof(uint64_t));
+	int *keys = (int *)malloc(n * sizeof(int));
+	uint32_t *bucketStart = (uint32_t *)calloc(c->nameBuckets + 1, sizeof(uint32_t));
+	uint32_t *fill = (uint32_t *)malloc(c->nameBuckets * sizeof(uint32_t));
+	uint32_t *order = (uint32_t *)malloc(2 * (size_t)c->nameBuckets * sizeof(uint32_t));
+	uint32_t *placed = (uint32_t *)malloc(n * sizeof(uint32_t));
+	int ok = c->nameDisplace && c->nameSlot && hashes && keys && bucketStart && fill && order && placed;
+	if (ok) {
+		for (uint32_t s = 0; s < c->nameSlots; s++) c->nameSlot[s] = -1;
+		// hash the distinct names and count bucket sizes
+		int distinct = 0;
+		for (int k = 0; k < n; k++) {
+			int i = c->byName[k];
+			const char *name = c->species[i].name;
+			if (k > 0 && compareNamePrefix(c->species[c->byName[k - 1]].name, name, strlen(name) + 1) == 0)
+				continue;  // same name as a lower ID
+			hashes[i] = hashSpeciesName(name, strlen(name));
+			keys[distinct++] = i;
+			bucketStart[nameBucketOf(hashes[i], c->nameBuckets) + 1]++;
+		}
+		for (uint32_t b = 0; b < c->nameBuckets; b++) {
+			order[2 * b] = bucketStart[b + 1];
+			order[2 * b + 1] = b;
+			bucketStart[b + 1] += bucketStart[b];
+			fill[b] = bucketStart[b];
+		}
+		// regroup keys by bucket, reusing placed[] as scratch
+		for (int k = 0; k < distinct; k++)
+			placed[fill[nameBucketOf(hashes[keys[k]], c->nameBuckets)]++] = (uint32_t)keys[k];
+		for (int k = 0; k < distinct; k++) keys[k] = (int)placed[k];
+		qsort(order, c->nameBuckets, 2 * sizeof(uint32_t), compareBucketSizes);
+		// place the biggest buckets first while the table is still empty
+		for (uint32_t k = 0; ok && k < c->nameBuckets && order[2 * k] > 0; k++) {
+			uint32_t b = order[2 * k + 1];
+			uint32_t size = order[2 * k];
+			const int *bucket = &keys[bucketStart[b]];
+			int found = 0;
+			for (uint64_t t = 0; !found && t < (uint64_t)c->nameSlots * c->nameSlots; t++) {
+				uint32_t d0 = (uint32_t)(t / c->nameSlots);
+				uint32_t d1 = (uint32_t)(t % c->nameSlots);
+				uint32_t j = 0;
+				for (; j < size; j++) {
+					uint32_t s = nameSlotOf(hashes[bucket[j]], c->nameSlots, d0, d1);
+					if (c->nameSlot[s] >= 0) break;
+					c->nameSlot[s] = bucket[j];
+					placed[j] = s;
+				}
+				if (j == size) {
+					c->nameDisplace[2 * b] = d0;
+					c->nameDisplace[2 * b + 1] = d1;
+					found = 1;
+				} else {
+					while (j > 0) c->nameSlot[placed[--j]] = -1;
+				}
+			}
+			if (!found) ok = 0;
+		}
+	}
+	free(hashes);
+	free(keys);
+	free(bucketStart);
+	free(fill);
+	free(order);
+	free(placed);
+	return ok;
+}
+
+
+static int compareCatalogRows(const void *a, const void *b) {
+	const CatalogRow *r1 = a;
+	const CatalogRow *r2 = b;
+	return (r1->data.id > r2->data.id) - (r1->data.id < r2->data.id);
+}
+
+
+// Columnar copy of id/type/hp/attack/evolve, padded to whole SPECIES_BLOCKs.
+// Padding rows never match: filter results are trimmed to count bits.
+static int buildCatalogColumns(Catalog *c) {
+	int length = (c->count + SPECIES_BLOCK - 1) / SPECIES_BLOCK * SPECIES_BLOCK;
+	size_t rowBytes = sizeof(int32_t) + 2 * sizeof(int16_t) + 2 * sizeof(uint8_t);
+	char *block = (char *)calloc(length, rowBytes);
+	if (!block) return 0;
+	c->wordCount = length / 64;
+	c->columnLength = length;
+	c->colId = (int32_t *)block;
+	c->colHp = (int16_t *)(c->colId + length);
+	c->colAttack = c->colHp + length;
+	c->colType = (uint8_t *)(c->colAttack + length);
+	c->colEvolve = c->colType + length;
+	for (int i = 0; i < c->count; i++) {
+		c->colId[i] = c->species[i].id;
+		c->colHp[i] = (int16_t)c->species[i].hp;
+		c->colAttack[i] = (int16_t)c->species[i].attack;
+		c->colType[i] = (uint8_t)c->species[i].TYPE;
+		c->colEvolve[i] = (uint8_t)c->species[i].CAN_EVOLVE;
+	}
+	return 1;
+}
+
+
+// byScore and scoreRank share one block, already allocated.
+static void buildScoreRanking(Catalog *c) {
+	c->scoreRank = c->byScore + c->count;
+	for (int i = 0; i < c->count; i++) c->byScore[i] = i;
+	sortingCatalog = c;
+	qsort(c->byScore, c->count, sizeof(int), compareSpeciesScores);
+	for (int r = 0; r < c->count; r++) c->scoreRank[c->byScore[r]] = r;
+}
+
+
+// Why the catalog failed to load, as one line without the newline.
+static void catalogError(char *error, size_t errorSize, const char *format, ...) {
+	if (!error || !errorSize) return;
+	va_list args;
+	va_start(args, format);
+	vsnprintf(error, errorSize, format, args);
+	va_end(args);
+}
+
+
+// Resolve every species to its final stage; rejects evolution cycles.
+static int buildEvolutionChains(Catalog *c, const CatalogRow *rows, const char *source, char *error, size_t errorSize) {
+	c->finalStage = (int *)malloc(c->count * sizeof(int));
+	if (!c->finalStage) {
+		catalogError(error, errorSize, "Memory allocation failed while loading catalog.");
+		return 0;
+	}
+	for (int i = 0; i < c->count; i++) c->finalStage[i] = -1;
+	for (int i = 0; i < c->count; i++) {
+		if (c->finalStage[i] >= 0) continue;
+		int j = i;
+		// -2 marks the chain we are walking right now
+		while (c->finalStage[j] == -1 && c->nextStage[j] >= 0) {
+			c->finalStage[j] = -2;
+			j = c->nextStage[j];
+		}
+		if (c->finalStage[j] == -2) {
+			catalogError(error, errorSize, "Catalog %s: line %d: evolution cycle through %s.", source, rows[j].line, rows[j].data.name);
+			return 0;
+		}
+		int last = c->finalStage[j] >= 0 ? c->finalStage[j] : j;
+		for (int k = i; k != j; k = c->nextStage[k]) c->finalStage[k] = last;
+		c->finalStage[j] = last;
+	}
+	return 1;
+}
+
+
+// Build species[], slotById, nextStage and byType from parsed rows.
+// Takes ownership of pool; rows stay with the caller.
+static int buildCatalog(const char *source, CatalogRow *rows, int count, int sorted, char *pool, char *error, size_t errorSize) {
+	if (count == 0) {
+		catalogError(error, errorSize, "Catalog %s: no species found.", source);
+		free(pool);
+		return 0;
+	}
+	if (!sorted) qsort(rows, count, sizeof(CatalogRow), compareCatalogRows);
+	for (int i = 1; i < count; i++) {
+		if (rows[i].data.id == rows[i - 1].data.id) {
+			catalogError(error, errorSize, "Catalog %s: line %d: duplicate ID %d.", source, rows[i].line, rows[i].data.id);
+			free(pool);
+			return 0;
+		}
+	}
+	for (int i = 0; i < count; i++) {
+		if (rows[i].data.hp > MAX_STAT || rows[i].data.attack > MAX_STAT) {
+			catalogError(error, errorSize, "Catalog %s: line %d: stats above %d are not supported.", source, rows[i].line, MAX_STAT);
+			free(pool);
+			return 0;
+		}
+	}
+	if (count >= SPECIES_TOMBSTONE) {
+		catalogError(error, errorSize, "Catalog %s: more than %d species are not supported.", source, SPECIES_TOMBSTONE - 1);
+		free(pool);
+		return 0;
+	}
+	int lowest = rows[0].data.id;
+	int highest = rows[count - 1].data.id;
+	if ((long)highest - lowest >= MAX_ID_SPAN) {
+		catalogError(error, errorSize, "Catalog %s: IDs %d..%d span too wide.", source, lowest, highest);
+		free(pool);
+		return 0;
+	}
+	int span = highest - lowest + 1;
+	Catalog c = {0};
+	c.count = count;
+	c.lowestId = lowest;
+	c.highestId = highest;
+	c.namePool = pool;
+	c.species = (PokemonData *)malloc(count * sizeof(PokemonData));
+	c.slotById = (int *)malloc(span * sizeof(int));
+	c.nextStage = (int *)malloc(count * sizeof(int));
+	c.byType = (int *)malloc(count * sizeof(int));
+	c.byScore = (int *)malloc(2 * count * sizeof(int));  // byScore, then scoreRank
+	if (!c.species || !c.slotById || !c.nextStage || !c.byType || !c.byScore) {
+		catalogError(error, errorSize, "Memory allocation failed while loading catalog.");
+		catalog = c;
+		freeCatalog();
+		return 0;
+	}
+	for (int i = 0; i < span; i++) c.slotById[i] = -1;
+	for (int i = 0; i < count; i++) {
+		c.species[i] = rows[i].data;
+		c.slotById[rows[i].data.id - lowest] = i;
+		c.typeStart[rows[i].data.TYPE + 1]++;
+	}
+	for (int i = 0; i < count; i++) {
+		int target = rows[i].evolvesTo;
+		c.nextStage[i] = -1;
+		if (!target) continue;
+		if (target == rows[i].data.id || target < lowest || target > highest || c.slotById[target - lowest] < 0) {
+			catalogError(error, errorSize, "Catalog %s: line %d: %s evolves into unknown ID %d.",
+				source, rows[i].line, rows[i].data.name, target);
+			catalog = c;
+			freeCatalog();
+			return 0;
+		}
+		c.nextStage[i] = c.slotById[target - lowest];
+	}
+	for (int i = 0; i < count; i++)
+		c.species[i].CAN_EVOLVE = (c.nextStage[i] >= 0) ? CAN_EVOLVE : CANNOT_EVOLVE;
+	if (!buildEvolutionChains(&c, rows, source, error, errorSize)) {
+		catalog = c;
+		freeCatalog();
+		return 0;
+	}
+	if (!buildCatalogColumns(&c)) {
+		catalogError(error, errorSize, "Memory allocation failed while loading catalog.");
+		catalog = c;
+		freeCatalog();
+		return 0;
+	}
+	// counting sort by type; rows are already in ID order
+	int fill[TYPE_COUNT];
+	for (int t = 0; t < TYPE_COUNT; t++) {
+		c.typeStart[t + 1] += c.typeStart[t];
+		fill[t] = c.typeStart[t];
+	}
+	for (int i = 0; i < count; i++) c.byType[fill[c.species[i].TYPE]++] = i;
+	buildScoreRanking(&c);
+	if (!buildNameIndex(&c)) {
+		catalogError(error, errorSize, "Memory allocation failed while loading catalog.");
+		catalog = c;
+		freeCatalog();
+		return 0;
+	}
+	catalog = c;
+	return 1;
+}
+
+
+const PokemonData *speciesByName(const char *name, size_t len) {
+	if (!catalog.nameSlot || len == 0) return NULL;
+	uint64_t h = hashSpeciesName(name, len);
+	uint32_t b = nameBucketOf(h, catalog.nameBuckets);
+	uint32_t s = nameSlotOf(h, catalog.nameSlots, catalog.nameDisplace[2 * b], catalog.nameDisplace[2 * b + 1]);
+	int i = catalog.nameSlot[s];
+	if (i < 0) return NULL;
+	const char *candidate = catalog.species[i].name;
+	if (compareNamePrefix(candidate, name, len) != 0 || candidate[len] != '\0') return NULL;
+	return &catalog.species[i];
+}
+
+
+int speciesByPrefix(const char *prefix, int *first) {
+	size_t plen = strlen(prefix);
+	int lo = 0;
+	int hi = catalog.count;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (compareNamePrefix(catalog.species[catalog.byName[mid]].name, prefix, plen) < 0) lo = mid + 1;
+		else hi = mid;
+	}
+	int total = 0;
+	while (lo + total < catalog.count
+		&& compareNamePrefix(catalog.species[catalog.byName[lo + total]].name, prefix, plen) == 0) total++;
+	*first = lo;
+	return total;
+}
+
+
+static int loadBuiltinCatalog(char *error, size_t errorSize) {
+	int count = (int)(sizeof(builtinPokedex) / sizeof(builtinPokedex[0]));
+	size_t poolSize = 0;
+	for (int i = 0; i < count; i++) poolSize += strlen(builtinPokedex[i].name) + 1;
+	CatalogRow *rows = (CatalogRow *)malloc(count * sizeof(CatalogRow));
+	char *pool = (char *)malloc(poolSize);
+	if (!rows || !pool) {
+		catalogError(error, errorSize, "Memory allocation failed while loading catalog.");
+		free(rows);
+		free(pool);
+		return 0;
+	}
+	char *p = pool;
+	for (int i = 0; i < count; i++) {
+		size_t len = strlen(builtinPokedex[i].name);
+		rows[i].data = builtinPokedex[i];
+		rows[i].data.name = memcpy(p, builtinPokedex[i].name, len + 1);
+		rows[i].evolvesTo = builtinPokedex[i].CAN_EVOLVE ? builtinPokedex[i].id + 1 : 0;
+		rows[i].line = i + 1;
+		p += len + 1;
+	}
+	int ok = buildCatalog("(built-in)", rows, count, 1, pool, error, errorSize);
+	free(rows);
+	return ok;
+}
+
+
+// Parse a non-negative decimal field, allowing surrounding blanks.
+static int parseCatalogInt(const char *p, const char *end, int *out) {
+	while (p < end && (*p == ' ' || *p == '\t')) p++;
+	while (end > p && (end[-1] == ' ' || end[-1] == '\t')) end--;
+	if (p == end) return 0;
+	long value = 0;
+	for (; p < end; p++) {
+		if (*p < '0' || *p > '9') return 0;
+		value = value * 10 + (*p - '0');
+		if (value > 0x7fffffffL) return 0;
+	}
+	*out = (int)value;
+	return 1;
+}
+
+
+// Parse one "id,name,type,hp,attack,evolves_to" line into row; name goes to *poolCur.
+static int parseCatalogLine(const char *p, const char *end, CatalogRow *row, char **poolCur) {
+	const char *field[6];
+	const char *fieldEnd[6];
+	int n = 0;
+	while (n < 6) {
+		const char *comma = memchr(p, ',', end - p);
+		field[n] = p;
+		fieldEnd[n] = comma ? comma : end;
+		n++;
+		if (!comma) break;
+		p = comma + 1;
+	}
+	if (n != 6 || memchr(field[5], ',', end - field[5])) return 0;
+	const char *name = field[1];
+	const char *nameEnd = fieldEnd[1];
+	while (name < nameEnd && (*name == ' ' || *name == '\t')) name++;
+	while (nameEnd > name && (nameEnd[-1] == ' ' || nameEnd[-1] == '\t')) nameEnd--;
+	const char *type = field[2];
+	const char *typeEnd = fieldEnd[2];
+	while (type < typeEnd && (*type == ' ' || *type == '\t')) type++;
+	while (typeEnd > type && (typeEnd[-1] == ' ' || typeEnd[-1] == '\t')) typeEnd--;
+	int typeValue = typeFromName(type, typeEnd - type);
+	if (name == nameEnd || typeValue < 0) return 0;
+	if (!parseCatalogInt(field[0], fieldEnd[0], &row->data.id) || row->data.id <= 0) return 0;
+	if (!parseCatalogInt(field[3], fieldEnd[3], &row->data.hp)) return 0;
+	if (!parseCatalogInt(field[4], fieldEnd[4], &row->data.attack)) return 0;
+	if (!parseCatalogInt(field[5], fieldEnd[5], &row->evolvesTo)) return 0;
+	size_t len = nameEnd - name;
+	memcpy(*poolCur, name, len);
+	(*poolCur)[len] = '\0';
+	row->data.name = *poolCur;
+	row->data.TYPE = (PokemonType)typeValue;
+	row->data.CAN_EVOLVE = row->evolvesTo ? CAN_EVOLVE : CANNOT_EVOLVE;
+	*poolCur += len + 1;
+	return 1;
+}
+
+
+int loadCatalog(const char *path, char *error, size_t errorSize) {
+	int explicitPath = (path != NULL);
+	if (!path) path = DEFAULT_CATALOG;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		if (!explicitPath) return loadBuiltinCatalog(error, errorSize);
+		catalogError(error, errorSize, "Cannot open catalog %s.", path);
+		return 0;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		catalogError(error, errorSize, "Catalog %s: no species found.", path);
+		close(fd);
+		return 0;
+	}
+	size_t size = (size_t)st.st_size;
+	const char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		catalogError(error, errorSize, "Cannot map catalog %s.", path);
+		return 0;
+	}
+	// names are never longer than the file itself, so one pool allocation suffices
+	char *pool = (char *)malloc(size);
+	int capacity = 256;
+	CatalogRow *rows = (CatalogRow *)malloc(capacity * sizeof(CatalogRow));
+	if (!pool || !rows) {
+		catalogError(error, errorSize, "Memory allocation failed while loading catalog.");
+		free(pool);
+		free(rows);
+		munmap((void *)map, size);
+		return 0;
+	}
+	char *poolCur = pool;
+	int count = 0;
+	int sorted = 1;
+	int line = 0;
+	const char *p = map;
+	const char *end = map + size;
+	while (p < end) {
+		const char *eol = memchr(p, '\n', end - p);
+		const char *lineEnd = eol ? eol : end;
+		line++;
+		const char *q = p;
+		p = eol ? eol + 1 : end;
+		if (lineEnd > q && lineEnd[-1] == '\r') lineEnd--;
+		while (q < lineEnd && (*q == ' ' || *q == '\t')) q++;
+		if (q == lineEnd || *q == '#') continue;
+		if (count == capacity) {
+			capacity *= 2;
+			CatalogRow *temp = (CatalogRow *)realloc(rows, capacity * sizeof(CatalogRow));
+			if (!temp) {
+				catalogError(error, errorSize, "Memory allocation failed while loading catalog.");
+				free(pool);
+				free(rows);
+				munmap((void *)map, size);
+				return 0;
+			}
+			rows = temp;
+		}
+		if (!parseCatalogLine(q, lineEnd, &rows[count], &poolCur)) {
+			catalogError(error, errorSize, "Catalog %s: line %d: expected id,name,type,hp,attack,evolves_to.", path, line);
+			free(pool);
+			free(rows);
+			munmap((void *)map, size);
+			return 0;
+		}
+		rows[count].line = line;
+		if (count > 0 && rows[count].data.id < rows[count - 1].data.id) sorted = 0;
+		count++;
+	}
+	munmap((void *)map, size);
+	int ok = buildCatalog(path, rows, count, sorted, pool, error, errorSize);
+	free(rows);
+	return ok;
+}
+
+
+void freeCatalog(void) {
+	free(catalog.species);
+	free(catalog.slotById);
+	free(catalog.nextStage);
+	free(catalog.finalStage);
+	free(catalog.byType);
+	free(catalog.namePool);
+	free(catalog.byName);
+	free(catalog.nameDisplace);
+	free(catalog.nameSlot);
+	free(catalog.colId);
+	free(catalog.byScore);
+	memset(&catalog, 0, sizeof(catalog));
+}
+
+
+// --------------------------------------------------------------
+// Materialized Statistics
+// --------------------------------------------------------------
+int fightScore10(const PokemonData *data) {
+	return data->attack * 15 + data->hp * 12;
+}
+
+
+// Called after the species set and species -> owners index already include data.
+// The totals part of statsPokemonAdded; the owner must be off the leaderboard.
+static void countPokemonAdded(PokedexContext *ctx, OwnerNode *owner, const PokemonData *data) {
+	int score = fightScore10(data);
+	int index = (int)(data - catalog.species);
+	OwnerStats *s = &owner->stats;
+	s->pokemonCount++;
+	s->typeCount[data->TYPE]++;
+	s->totalScore10 += score;
+	if (score > s->bestScore10) s->bestScore10 = score;
+	ctx->summary.pokemonCount++;
+	ctx->summary.typeCount[data->TYPE]++;
+	ctx->summary.totalScore10 += score;
+	if (ctx->registry.speciesOwners[index].count == 1) {
+		int rank = catalog.scoreRank[index];
+		ctx->registry.coveredByRank[rank / 64] |= 1ULL << (rank % 64);
+		ctx->summary.speciesCovered++;
+	}
+	// score rank orders by score, then by ID, the same tie-break the removal
+	// path and topSpecies use, so the answer does not depend on add order
+	if (ctx->summary.bestSpecies < 0 || catalog.scoreRank[index] < catalog.scoreRank[ctx->summary.bestSpecies])
+		ctx->summary.bestSpecies = index;
+}
+
+
+static void statsPokemonAdded(PokedexContext *ctx, OwnerNode *owner, const PokemonData *data) {
+	if (owner->stats.pokemonCount) leaderboardRemove(ctx, owner);
+	countPokemonAdded(ctx, owner, data);
+	leaderboardInsert(ctx, owner);
+}
+
+
+// Called after the species set and species -> owners index already dropped data.
+static void statsPokemonRemoved(PokedexContext *ctx, OwnerNode *owner, const PokemonData *data) {
+	int score = fightScore10(data);
+	int index = (int)(data - catalog.species);
+	OwnerStats *s = &owner->stats;
+	leaderboardRemove(ctx, owner);
+	s->pokemonCount--;
+	s->typeCount[data->TYPE]--;
+	s->totalScore10 -= score;
+	if (score == s->bestScore10) {
+		// the species set is in score order, so the best one left is its first bit
+		int rank = ownerFirstRank(owner);
+		s->bestScore10 = rank < 0 ? -1 : fightScore10(&catalog.species[catalog.byScore[rank]]);
+	}
+	if (s->pokemonCount) leaderboardInsert(ctx, owner);
+	ctx->summary.pokemonCount--;
+	ctx->summary.typeCount[data->TYPE]--;
+	ctx->summary.totalScore10 -= score;
+	if (ctx->registry.speciesOwners[index].count == 0) {
+		int rank = catalog.scoreRank[index];
+		ctx->registry.coveredByRank[rank / 64] &= ~(1ULL << (rank % 64));
+		ctx->summary.speciesCovered--;
+		if (ctx->summary.bestSpecies == index) {
+			// the first owned species in score order: best score, lowest ID
+			int best = -1;
+			topSpecies(ctx, &best, 1);
+			ctx->summary.bestSpecies = best;
+		}
+	}
+}
+
+
+// --------------------------------------------------------------
+// Leaderboards
+// --------------------------------------------------------------
+// Trainers with at least one Pokemon sit in a treap ordered by total fight
+// score (best first, ties by name). The links and subtree sizes live in the
+// owner records, and a priority is a hash of the handle.
+
+static OwnerNode *boardNode(PokedexContext *ctx, uint32_t handle) {
+	return &ctx->registry.chunks[handle / OWNER_CHUNK][handle % OWNER_CHUNK];
+}
+
+
+static uint32_t boardSizeOf(PokedexContext *ctx, uint32_t handle) {
+	return handle == NO_OWNER ? 0 : boardNode(ctx, handle)->boardSize;
+}
+
+
+static uint32_t boardPriority(uint32_t handle) {
+	uint32_t x = handle * 0x9E3779B1u;
+	x ^= x >> 15;
+	x *= 0x85EBCA77u;
+	return x ^ (x >> 13);
+}
+
+
+// Does a rank ahead of b?
+static int boardAhead(const OwnerNode *a, const OwnerNode *b) {
+	if (a->stats.totalScore10 != b->stats.totalScore10) return a->stats.totalScore10 > b->stats.totalScore10;
+	return compareOwnerNames(a, b) < 0;
+}
+
+
+static void boardUpdate(PokedexContext *ctx, OwnerNode *node) {
+	node->boardSize = 1 + boardSizeOf(ctx, node->boardLeft) + boardSizeOf(ctx, node->boardRight);
+}
+
+
+// Split t into the owners ahead of key (*ahead) and the rest (*behind).
+static void boardSplit(PokedexContext *ctx, uint32_t t, const OwnerNode *key, uint32_t *ahead, uint32_t *behind) {
+	if (t == NO_OWNER) {
+		*ahead = *behind = NO_OWNER;
+		return;
+	}
+	OwnerNode *node = boardNode(ctx, t);
+	if (boardAhead(node, key)) {
+		boardSplit(ctx, node->boardRight, key, &node->boardRight, behind);
+		*ahead = t;
+	} else {
+		boardSplit(ctx, node->boardLeft, key, ahead, &node->boardLeft);
+		*behind = t;
+	}
+	boardUpdate(ctx, node);
+}
+
+
+// Join two treaps where every owner in a ranks ahead of every owner in b.
+static uint32_t boardJoin(PokedexContext *ctx, uint32_t a, uint32_t b) {
+	if (a == NO_OWNER) return b;
+	if (b == NO_OWNER) return a;
+	if (boardPriority(a) > boardPriority(b)) {
+		OwnerNode *node = boardNode(ctx, a);
+		node->boardRight = boardJoin(ctx, node->boardRight, b);
+		boardUpdate(ctx, node);
+		return a;
+	}
+	OwnerNode *node = boardNode(ctx, b);
+	node->boardLeft = boardJoin(ctx, a, node->boardLeft);
+	boardUpdate(ctx, node);
+	return b;
+}
+
+
+static uint32_t boardInsertAt(PokedexContext *ctx, uint32_t t, OwnerNode *owner) {
+	if (t == NO_OWNER) return owner->handle;
+	OwnerNode *node = boardNode(ctx, t);
+	if (boardPriority(owner->handle) > boardPriority(t)) {
+		boardSplit(ctx, t, owner, &owner->boardLeft, &owner->boardRight);
+		boardUpdate(ctx, owner);
+		return owner->handle;
+	}
+	if (boardAhead(owner, node)) node->boardLeft = boardInsertAt(ctx, node->boardLeft, owner);
+	else node->boardRight = boardInsertAt(ctx, node->boardRight, owner);
+	boardUpdate(ctx, node);
+	return t;
+}
+
+
+static int compareBoardOrder(const void *a, const void *b, void *arg) {
+	PokedexContext *ctx = (PokedexContext *)arg;
+	const OwnerNode *x = boardNode(ctx, *(const uint32_t *)a);
+	const OwnerNode *y = boardNode(ctx, *(const uint32_t *)b);
+	return boardAhead(x, y) ? -1 : boardAhead(y, x);
+}
+
+
+// Relink every owner with a Pokemon into a fresh treap: sort once, then
+// build it left to right in O(n) with a stack of the right spine. The
+// priorities are fixed, so this is the same treap the inserts would make.
+// Returns 0, with the board untouched, if memory runs out.
+static int boardRebuild(PokedexContext *ctx) {
+	uint32_t count = 0;
+	for (uint32_t handle = 0; handle < ctx->registry.nextHandle; handle++) {
+		OwnerNode *owner = ownerByHandle(ctx, handle);
+		if (owner && owner->stats.pokemonCount) count++;
+	}
+	uint32_t *order = (uint32_t *)malloc(2 * (size_t)count * sizeof(uint32_t) + 1);
+	if (!order) return 0;
+	uint32_t *spine = order + count;
+	count = 0;
+	for (uint32_t handle = 0; handle < ctx->registry.nextHandle; handle++) {
+		OwnerNode *owner = ownerByHandle(ctx, handle);
+		if (owner && owner->stats.pokemonCount) order[count++] = handle;
+	}
+	qsort_r(order, count, sizeof(uint32_t), compareBoardOrder, ctx);
+	uint32_t depth = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		OwnerNode *node = boardNode(ctx, order[i]);
+		uint32_t priority = boardPriority(order[i]);
+		uint32_t last = NO_OWNER;
+		// a popped owner's subtree is complete, so its size is final
+		while (depth && boardPriority(spine[depth - 1]) < priority) {
+			last = spine[--depth];
+			boardUpdate(ctx, boardNode(ctx, last));
+		}
+		node->boardLeft = last;
+		node->boardRight = NO_OWNER;
+		if (depth) boardNode(ctx, spine[depth - 1])->boardRight = order[i];
+		spine[depth++] = order[i];
+	}
+	while (depth > 1) boardUpdate(ctx, boardNode(ctx, spine[--depth]));
+	if (depth) boardUpdate(ctx, boardNode(ctx, spine[0]));
+	ctx->registry.boardRoot = count ? spine[0] : NO_OWNER;
+	free(order);
+	return 1;
+}
+
+
+static uint32_t boardRemoveAt(PokedexContext *ctx, uint32_t t, const OwnerNode *owner) {
+	if (t == NO_OWNER) return NO_OWNER;
+	OwnerNode *node = boardNode(ctx, t);
+	if (node == owner) return boardJoin(ctx, node->boardLeft, node->boardRight);
+	if (boardAhead(owner, node)) node->boardLeft = boardRemoveAt(ctx, node->boardLeft, owner);
+	else node->boardRight = boardRemoveAt(ctx, node->boardRight, owner);
+	boardUpdate(ctx, node);
+	return t;
+}
+
+
+void leaderboardRemove(PokedexContext *ctx, OwnerNode *owner) {
+	ctx->registry.boardRoot = boardRemoveAt(ctx, ctx->registry.boardRoot, owner);
+	owner->boardLeft = owner->boardRight = NO_OWNER;
+	owner->boardSize = 0;
+}
+
+
+void leaderboardInsert(PokedexContext *ctx, OwnerNode *owner) {
+	owner->boardLeft = owner->boardRight = NO_OWNER;
+	owner->boardSize = 1;
+	ctx->registry.boardRoot = boardInsertAt(ctx, ctx->registry.boardRoot, owner);
+}
+
+
+int trainerRank(PokedexContext *ctx, const OwnerNode *owner) {
+	if (!owner->boardSize) return 0;
+	int rank = 1;
+	uint32_t t = ctx->registry.boardRoot;
+	while (t != NO_OWNER) {
+		const OwnerNode *node = boardNode(ctx, t);
+		if (node == owner) return rank + (int)boardSizeOf(ctx, node->boardLeft);
+		if (boardAhead(owner, node)) t = node->boardLeft;
+		else {
+			rank += 1 + (int)boardSizeOf(ctx, node->boardLeft);
+			t = node->boardRight;
+		}
+	}
+	return 0;
+}
+
+
+int leaderboardSize(PokedexContext *ctx) {
+	return (int)boardSizeOf(ctx, ctx->registry.boardRoot);
+}
+
+
+// In-order walk of t that stops once out holds k owners.
+static void boardCollect(PokedexContext *ctx, uint32_t t, OwnerNode **out, int k, int *count) {
+	if (t == NO_OWNER || *count >= k) return;
+	OwnerNode *node = boardNode(ctx, t);
+	boardCollect(ctx, node->boardLeft, out, k, count);
+	if (*count < k) out[(*count)++] = node;
+	boardCollect(ctx, node->boardRight, out, k, count);
+}
+
+
+int topTrainers(PokedexContext *ctx, OwnerNode **out, int k) {
+	int count = 0;
+	boardCollect(ctx, ctx->registry.boardRoot, out, k, &count);
+	return count;
+}
+
+
+int topSpecies(PokedexContext *ctx, int *out, int k) {
+	int count = 0;
+	for (int w = 0; w < catalog.wordCount && count < k; w++) {
+		uint64_t bits = ctx->registry.coveredByRank[w];
+		while (bits && count < k) {
+			out[count++] = catalog.byScore[w * 64 + __builtin_ctzll(bits)];
+			bits &= bits - 1;
+		}
+	}
+	return count;
+}
+
+
+// --------------------------------------------------------------
+// Owner Handles & Species -> Owners Index
+// --------------------------------------------------------------
+
+// Index of the first element >= handle.
+static uint32_t ownerSetLowerBound(const OwnerSet *set, uint32_t handle) {
+	uint32_t lo = 0;
+	uint32_t hi = set->count;
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		if (set->owners[mid] < handle) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo;
+}
+
+
+// Room for extra more handles; 0 on allocation failure. Sets never shrink.
+static int ownerSetReserve(OwnerSet *set, uint32_t extra) {
+	if (set->count + extra <= set->capacity) return 1;
+	uint32_t capacity = set->capacity ? set->capacity * 2 : 4;
+	if (capacity < set->count + extra) capacity = set->count + extra;
+	uint32_t *temp = (uint32_t *)realloc(set->owners, capacity * sizeof(uint32_t));
+	if (!temp) return 0;
+	set->owners = temp;
+	set->capacity = capacity;
+	return 1;
+}
+
+
+// Add a handle at the end, leaving the set unsorted until the caller sorts it.
+static int ownerSetAppend(OwnerSet *set, uint32_t handle) {
+	if (!ownerSetReserve(set, 1)) return 0;
+	set->owners[set->count++] = handle;
+	return 1;
+}
+
+
+static int ownerSetInsert(OwnerSet *set, uint32_t handle) {
+	uint32_t at = set->count;
+	// new handles are usually the largest, so check the tail first
+	if (at > 0 && set->owners[at - 1] >= handle) {
+		at = ownerSetLowerBound(set, handle);
+		if (set->owners[at] == handle) return 1;
+	}
+	if (!ownerSetReserve(set, 1)) return 0;
+	memmove(&set->owners[at + 1], &set->owners[at], (set->count - at) * sizeof(uint32_t));
+	set->owners[at] = handle;
+	set->count++;
+	return 1;
+}
+
+
+static void ownerSetErase(OwnerSet *set, uint32_t handle) {
+	uint32_t at = ownerSetLowerBound(set, handle);
+	if (at == set->count || set->owners[at] != handle) return;
+	memmove(&set->owners[at], &set->owners[at + 1], (set->count - at - 1) * sizeof(uint32_t));
+	set->count--;
+}
+
+
+int initRegistry(PokedexContext *ctx) {
+	ctx->registry.speciesOwners = (OwnerSet *)calloc(catalog.count, sizeof(OwnerSet));
+	ctx->registry.coveredByRank = (uint64_t *)calloc(catalog.wordCount, sizeof(uint64_t));
+	ctx->registry.boardRoot = NO_OWNER;
+	return ctx->registry.speciesOwners && ctx->registry.coveredByRank;
+}
+
+
+void freeRegistry(PokedexContext *ctx) {
+	if (ctx->registry.speciesOwners)
+		for (int i = 0; i < catalog.count; i++) free(ctx->registry.speciesOwners[i].owners);
+	free(ctx->registry.speciesOwners);
+	for (uint32_t i = 0; i < ctx->registry.chunkCount; i++) free(ctx->registry.chunks[i]);
+	free(ctx->registry.chunks);
+	free(ctx->registry.freeHandles);
+	free(ctx->registry.coveredByRank);
+	freeOwnerNames(ctx);
+	memset(&ctx->registry, 0, sizeof(ctx->registry));
+}
+
+
+OwnerNode *registerOwner(PokedexContext *ctx) {
+	uint32_t handle;
+	if (ctx->registry.freeCount > 0) handle = ctx->registry.freeHandles[--ctx->registry.freeCount];
+	else {
+		if (ctx->registry.nextHandle == ctx->registry.chunkCount * OWNER_CHUNK) {
+			if (ctx->registry.chunkCount == NO_OWNER / OWNER_CHUNK) return NULL;
+			OwnerNode **chunks = (OwnerNode **)realloc(ctx->registry.chunks, (ctx->registry.chunkCount + 1) * sizeof(OwnerNode *));
+			if (!chunks) return NULL;
+			ctx->registry.chunks = chunks;
+			uint32_t *freeHandles = (uint32_t *)realloc(ctx->registry.freeHandles,
+				(size_t)(ctx->registry.chunkCount + 1) * OWNER_CHUNK * sizeof(uint32_t));
+			if (!freeHandles) return NULL;
+			ctx->registry.freeHandles = freeHandles;
+			OwnerNode *chunk = (OwnerNode *)calloc(OWNER_CHUNK, sizeof(OwnerNode));
+			if (!chunk) return NULL;
+			ctx->registry.chunks[ctx->registry.chunkCount++] = chunk;
+		}
+		handle = ctx->registry.nextHandle++;
+	}
+	OwnerNode *owner = &ctx->registry.chunks[handle / OWNER_CHUNK][handle % OWNER_CHUNK];
+	memset(owner, 0, sizeof(*owner));
+	owner->handle = handle;
+	owner->prev = owner->next = NO_OWNER;
+	owner->inUse = 1;
+	ctx->summary.ownerCount++;
+	return owner;
+}
+
+
+void unregisterOwner(PokedexContext *ctx, OwnerNode *owner) {
+	releaseOwnerName(ctx, owner);
+	free(owner->species);
+	ctx->registry.freeHandles[ctx->registry.freeCount++] = owner->handle;
+	memset(owner, 0, sizeof(*owner));
+	ctx->summary.ownerCount--;
+}
+
+
+OwnerNode *ownerByHandle(PokedexContext *ctx, uint32_t handle) {
+	if (handle >= ctx->registry.nextHandle) return NULL;
+	OwnerNode *owner = &ctx->registry.chunks[handle / OWNER_CHUNK][handle % OWNER_CHUNK];
+	return owner->inUse ? owner : NULL;
+}
+
+
+const OwnerSet *ownersOfSpecies(PokedexContext *ctx, const PokemonData *data) {
+	return &ctx->registry.speciesOwners[data - catalog.species];
+}
+
+
+// --------------------------------------------------------------
+// Owner Names
+// --------------------------------------------------------------
+uint32_t hashOwnerName(const char *name, size_t len) {
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < len; i++) {
+		h ^= (unsigned char)name[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+
+// Size class of a name needing need bytes, or -1 if it is over a quarter
+// block and gets a malloc of its own.
+static int nameClass(size_t need) {
+	if (need > NAME_BLOCK / 4) return -1;
+	int c = 0;
+	while ((size_t)NAME_CLASS_MIN << c < need) c++;
+	return c;
+}
+
+
+// Copy len bytes plus a NUL into a slot of the arena: a freed one of the
+// right size if there is one, else the next one in the current block.
+static char *nameArenaCopy(NameArena *arena, const char *name, size_t len) {
+	size_t need = len + 1;
+	int c = nameClass(need);
+	char *copy;
+	if (c < 0) {
+		if (!(copy = (char *)malloc(need))) return NULL;
+	} else if (arena->freeSlots[c]) {
+		copy = arena->freeSlots[c];
+		memcpy(&arena->freeSlots[c], copy, sizeof(char *));
+	} else {
+		size_t size = (size_t)NAME_CLASS_MIN << c;
+		if (arena->used + size > arena->capacity) {
+			// the tail of the old block is left unused; it is under a quarter block
+			char **blocks = (char **)realloc(arena->blocks, (arena->count + 1) * sizeof(char *));
+			if (!blocks) return NULL;
+			arena->blocks = blocks;
+			char *block = (char *)malloc(NAME_BLOCK);
+			if (!block) return NULL;
+			arena->blocks[arena->count++] = block;
+			arena->used = 0;
+			arena->capacity = NAME_BLOCK;
+		}
+		copy = arena->blocks[arena->count - 1] + arena->used;
+		arena->used += size;
+	}
+	memcpy(copy, name, len);
+	copy[len] = '\0';
+	return copy;
+}
+
+
+void releaseOwnerName(PokedexContext *ctx, OwnerNode *owner) {
+	char *name = owner->ownerName;
+	if (!name || name == owner->nameInline) return;
+	int c = nameClass((size_t)owner->nameLength + 1);
+	if (c < 0) free(name);
+	else {
+		memcpy(name, &ctx->registry.names.freeSlots[c], sizeof(char *));
+		ctx->registry.names.freeSlots[c] = name;
+	}
+	owner->ownerName = NULL;
+}
+
+
+int setOwnerName(PokedexContext *ctx, OwnerNode *owner, const char *name) {
+	size_t len = strlen(name);
+	if (len > UINT32_MAX) return 0;
+	char *copy = owner->nameInline;
+	if (len >= OWNER_INLINE_NAME) {
+		copy = nameArenaCopy(&ctx->registry.names, name, len);
+		if (!copy) return 0;
+	} else {
+		memcpy(copy, name, len + 1);
+	}
+	uint64_t key = 0;
+	for (size_t i = 0; i < 8; i++) key = key << 8 | (i < len ? (unsigned char)name[i] : 0);
+	owner->ownerName = copy;
+	owner->nameLength = (uint32_t)len;
+	owner->nameHash = hashOwnerName(name, len);
+	owner->nameKey = key;
+	return 1;
+}
+
+
+int compareOwnerNames(const OwnerNode *a, const OwnerNode *b) {
+	if (a->nameKey != b->nameKey) return a->nameKey < b->nameKey ? -1 : 1;
+	// same first 8 bytes; a name that ends inside them is a prefix of the other
+	if (a->nameLength <= 8 || b->nameLength <= 8)
+		return (a->nameLength > b->nameLength) - (a->nameLength < b->nameLength);
+	return strcmp(a->ownerName + 8, b->ownerName + 8);
+}
+
+
+void freeOwnerNames(PokedexContext *ctx) {
+	for (int i = 0; i < ctx->registry.names.count; i++) free(ctx->registry.names.blocks[i]);
+	free(ctx->registry.names.blocks);
+	memset(&ctx->registry.names, 0, sizeof(ctx->registry.names));
+}
+
+
+// --------------------------------------------------------------
+// Species Membership & Filter Queries
+// --------------------------------------------------------------
+// Position of word in the owner's species set, or where it would go.
+static uint32_t speciesWordLowerBound(const OwnerNode *owner, uint32_t word) {
+	uint32_t lo = 0;
+	uint32_t hi = owner->speciesCount;
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		if (owner->species[mid].word < word) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo;
+}
+
+
+// Room for extra more words in the owner's species set; 0 on allocation failure.
+static int ownerSpeciesReserve(OwnerNode *owner, uint32_t extra) {
+	if (owner->speciesCount + extra <= owner->speciesCapacity) return 1;
+	uint32_t capacity = owner->speciesCapacity ? owner->speciesCapacity * 2 : 2;
+	if (capacity < owner->speciesCount + extra) capacity = owner->speciesCount + extra;
+	SpeciesWord *temp = (SpeciesWord *)realloc(owner->species, capacity * sizeof(SpeciesWord));
+	if (!temp) return 0;
+	owner->species = temp;
+	owner->speciesCapacity = capacity;
+	return 1;
+}
+
+
+static int ownerSpeciesAdd(OwnerNode *owner, int rank) {
+	uint32_t word = (uint32_t)rank / 64;
+	uint32_t at = speciesWordLowerBound(owner, word);
+	if (at == owner->speciesCount || owner->species[at].word != word) {
+		if (!ownerSpeciesReserve(owner, 1)) return 0;
+		memmove(&owner->species[at + 1], &owner->species[at], (owner->speciesCount - at) * sizeof(SpeciesWord));
+		owner->species[at].word = word;
+		owner->species[at].bits = 0;
+		owner->speciesCount++;
+	}
+	owner->species[at].bits |= 1ULL << (rank % 64);
+	return 1;
+}
+
+
+static void ownerSpeciesRemove(OwnerNode *owner, int rank) {
+	uint32_t word = (uint32_t)rank / 64;
+	uint32_t at = speciesWordLowerBound(owner, word);
+	if (at == owner->speciesCount || owner->species[at].word != word) return;
+	owner->species[at].bits &= ~(1ULL << (rank % 64));
+	if (owner->species[at].bits) return;
+	memmove(&owner->species[at], &owner->species[at + 1], (owner->speciesCount - at - 1) * sizeof(SpeciesWord));
+	owner->speciesCount--;
+}
+
+
+int notePokemonAdded(PokedexContext *ctx, OwnerNode *owner, const PokemonData *data) {
+	int index = (int)(data - catalog.species);
+	OwnerSet *set = &ctx->registry.speciesOwners[index];
+	// both allocations come first, so a failure leaves nothing half noted
+	if (!ownerSpeciesReserve(owner, 1) || !ownerSetReserve(set, 1)) return 0;
+	ownerSpeciesAdd(owner, catalog.scoreRank[index]);
+	ownerSetInsert(set, owner->handle);
+	statsPokemonAdded(ctx, owner, data);
+	replicaSpecies(ctx, owner, index, 1);
+	return 1;
+}
+
+
+int notePokemonReserve(PokedexContext *ctx, OwnerNode *owner, const PokemonData *const *species, int count) {
+	int words = 0;
+	for (int i = 0; i < count; i++) {
+		if (!species[i]) continue;
+		if (!ownerSetReserve(&ctx->registry.speciesOwners[species[i] - catalog.species], 1)) return 0;
+		words++;
+	}
+	return ownerSpeciesReserve(owner, (uint32_t)words);
+}
+
+
+void notePokemonRemoved(PokedexContext *ctx, OwnerNode *owner, const PokemonData *data) {
+	int index = (int)(data - catalog.species);
+	ownerSpeciesRemove(owner, catalog.scoreRank[index]);
+	ownerSetErase(&ctx->registry.speciesOwners[index], owner->handle);
+	statsPokemonRemoved(ctx, owner, data);
+	replicaSpecies(ctx, owner, index, 0);
+}
+
+
+int ownerHasSpecies(const OwnerNode *owner, const PokemonData *data) {
+	int rank = catalog.scoreRank[data - catalog.species];
+	uint32_t at = speciesWordLowerBound(owner, (uint32_t)rank / 64);
+	return at < owner->speciesCount && owner->species[at].word == (uint32_t)rank / 64
+		&& ((owner->species[at].bits >> (rank % 64)) & 1);
+}
+
+
+int ownerFirstRank(const OwnerNode *owner) {
+	if (!owner->speciesCount) return -1;
+	return (int)owner->species[0].word * 64 + __builtin_ctzll(owner->species[0].bits);
+}
+
+
+// Intersect [lo, hi] with the range implied by "op value".
+static int applyStatTerm(const char *op, int value, int *lo, int *hi) {
+	int low = *lo;
+	int high = *hi;
+	if (strcmp(op, ">") == 0) low = value + 1;
+	else if (strcmp(op, ">=") == 0) low = value;
+	else if (strcmp(op, "<") == 0) high = value - 1;
+	else if (strcmp(op, "<=") == 0) high = value;
+	else if (strcmp(op, "=") == 0) low = high = value;
+	else return 0;
+	if (low > *lo) *lo = low;
+	if (high < *hi) *hi = high;
+	return 1;
+}
+
+
+// Add "25", "100-151" or "1,4,7" (any mix) to the filter's ID set.
+// Returns 0 if the term is not an ID list.
+static int parseIdTerm(const char *term, SpeciesFilter *filter) {
+	if (!isdigit((unsigned char)term[0])) return 0;
+	for (const char *q = term; *q; q++)
+		if (!isdigit((unsigned char)*q) && *q != ',' && *q != '-') return 0;
+	if (!filter->ids) {
+		filter->ids = (uint64_t *)calloc(catalog.wordCount, sizeof(uint64_t));
+		if (!filter->ids) return 0;
+	}
+	const char *q = term;
+	while (*q) {
+		char *endptr;
+		long from = strtol(q, &endptr, 10);
+		long to = from;
+		if (endptr == q) return 0;
+		q = endptr;
+		if (*q == '-') {
+			to = strtol(q + 1, &endptr, 10);
+			if (endptr == q + 1 || to < from) return 0;
+			q = endptr;
+		}
+		if (*q == ',') q++;
+		else if (*q) return 0;
+		if (from < LOWEST_ID) from = LOWEST_ID;
+		if (to > HIGHEST_ID) to = HIGHEST_ID;
+		for (long id = from; id <= to; id++) {
+			int slot = catalog.slotById[id - LOWEST_ID];
+			if (slot >= 0) filter->ids[slot / 64] |= 1ULL << (slot % 64);
+		}
+	}
+	return 1;
+}
+
+
+void freeSpeciesFilter(SpeciesFilter *filter) {
+	free(filter->ids);
+	filter->ids = NULL;
+}
+
+
+// Apply one lowercased, NUL-terminated filter term of len bytes.
+// Returns 0 if the term is not valid.
+static int parseFilterTerm(char *term, size_t len, SpeciesFilter *filter) {
+	int type = typeFromName(term, len);
+	if (type >= 0) {
+		filter->typeMask |= (uint16_t)(1u << type);
+		return 1;
+	}
+	if (strcmp(term, "any") == 0) return 1;
+	if (parseIdTerm(term, filter)) return 1;
+	const PokemonData *named = speciesByName(term, len);
+	if (named) {
+		if (!filter->ids) filter->ids = (uint64_t *)calloc(catalog.wordCount, sizeof(uint64_t));
+		if (filter->ids) {
+			int slot = (int)(named - catalog.species);
+			filter->ids[slot / 64] |= 1ULL << (slot % 64);
+			return 1;
+		}
+	}
+	if (strcmp(term, "evolve=yes") == 0) {
+		filter->evolve = CAN_EVOLVE;
+		return 1;
+	}
+	if (strcmp(term, "evolve=no") == 0) {
+		filter->evolve = CANNOT_EVOLVE;
+		return 1;
+	}
+	size_t nameLen = strcspn(term, "<>=");
+	char op[3] = {0};
+	size_t opLen = strspn(term + nameLen, "<>=");
+	char *endptr = NULL;
+	long value = 0;
+	if (opLen >= 1 && opLen <= 2) {
+		memcpy(op, term + nameLen, opLen);
+		value = strtol(term + nameLen + opLen, &endptr, 10);
+	}
+	int ok = endptr && endptr != term + nameLen + opLen && *endptr == '\0' && value >= 0 && value <= MAX_STAT;
+	term[nameLen] = '\0';
+	if (ok && strcmp(term, "hp") == 0)
+		return applyStatTerm(op, (int)value, &filter->hpMin, &filter->hpMax);
+	if (ok && (strcmp(term, "attack") == 0 || strcmp(term, "atk") == 0))
+		return applyStatTerm(op, (int)value, &filter->attackMin, &filter->attackMax);
+	return 0;
+}
+
+
+int parseSpeciesFilter(const char *text, SpeciesFilter *filter, const char **bad) {
+	filter->typeMask = 0;
+	filter->hpMin = filter->attackMin = 0;
+	filter->hpMax = filter->attackMax = MAX_STAT;
+	filter->evolve = -1;
+	filter->ids = NULL;
+	const char *p = text;
+	while (*p) {
+		while (*p == ' ' || *p == '\t') p++;
+		if (!*p) break;
+		const char *start = p;
+		while (*p && *p != ' ' && *p != '\t') p++;
+		size_t len = (size_t)(p - start);
+		// Most terms fit on the stack; a long ID list is copied whole to
+		// the heap, never cut short
+		char small[FILTER_BUFFER];
+		char *term = len < sizeof(small) ? small : (char *)malloc(len + 1);
+		int ok = term != NULL;
+		if (ok) {
+			for (size_t i = 0; i < len; i++) term[i] = (char)tolower((unsigned char)start[i]);
+			term[len] = '\0';
+			ok = parseFilterTerm(term, len, filter);
+			if (term != small) free(term);
+		}
+		if (!ok) {
+			if (bad) *bad = start;
+			freeSpeciesFilter(filter);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+int evaluateSpeciesFilter(const SpeciesFilter *filter, uint64_t *mask) {
+	int hpMin = filter->hpMin < 0 ? 0 : filter->hpMin;
+	int hpMax = filter->hpMax > MAX_STAT ? MAX_STAT : filter->hpMax;
+	int atkMin = filter->attackMin < 0 ? 0 : filter->attackMin;
+	int atkMax = filter->attackMax > MAX_STAT ? MAX_STAT : filter->attackMax;
+	memset(mask, 0, catalog.wordCount * sizeof(uint64_t));
+	if (hpMin > hpMax || atkMin > atkMax) return 0;
+#ifdef __SSE2__
+	const __m128i vHpMin = _mm_set1_epi16((short)hpMin);
+	const __m128i vHpMax = _mm_set1_epi16((short)hpMax);
+	const __m128i vAtkMin = _mm_set1_epi16((short)atkMin);
+	const __m128i vAtkMax = _mm_set1_epi16((short)atkMax);
+	const __m128i vEvolve = _mm_set1_epi8((char)filter->evolve);
+	for (int i = 0; i < catalog.columnLength; i += 16) {
+		__m128i hpLo = _mm_loadu_si128((const __m128i *)(catalog.colHp + i));
+		__m128i hpHi = _mm_loadu_si128((const __m128i *)(catalog.colHp + i + 8));
+		__m128i atkLo = _mm_loadu_si128((const __m128i *)(catalog.colAttack + i));
+		__m128i atkHi = _mm_loadu_si128((const __m128i *)(catalog.colAttack + i + 8));
+		__m128i outLo = _mm_or_si128(
+			_mm_or_si128(_mm_cmplt_epi16(hpLo, vHpMin), _mm_cmpgt_epi16(hpLo, vHpMax)),
+			_mm_or_si128(_mm_cmplt_epi16(atkLo, vAtkMin), _mm_cmpgt_epi16(atkLo, vAtkMax)));
+		__m128i outHi = _mm_or_si128(
+			_mm_or_si128(_mm_cmplt_epi16(hpHi, vHpMin), _mm_cmpgt_epi16(hpHi, vHpMax)),
+			_mm_or_si128(_mm_cmplt_epi16(atkHi, vAtkMin), _mm_cmpgt_epi16(atkHi, vAtkMax)));
+		// 16 x int16 "out of range" lanes -> 16 x int8 "in range" lanes
+		__m128i hit = _mm_andnot_si128(_mm_packs_epi16(outLo, outHi), _mm_set1_epi8(-1));
+		if (filter->typeMask) {
+			__m128i types = _mm_loadu_si128((const __m128i *)(catalog.colType + i));
+			__m128i typeHit = _mm_setzero_si128();
+			for (int t = 0; t < TYPE_COUNT; t++)
+				if (filter->typeMask & (1u << t))
+					typeHit = _mm_or_si128(typeHit, _mm_cmpeq_epi8(types, _mm_set1_epi8((char)t)));
+			hit = _mm_and_si128(hit, typeHit);
+		}
+		if (filter->evolve >= 0) {
+			__m128i evolve = _mm_loadu_si128((const __m128i *)(catalog.colEvolve + i));
+			hit = _mm_and_si128(hit, _mm_cmpeq_epi8(evolve, vEvolve));
+		}
+		mask[i / 64] |= (uint64_t)(unsigned)_mm_movemask_epi8(hit) << (i % 64);
+	}
+#else
+	for (int i = 0; i < catalog.columnLength; i++) {
+		int hit = catalog.colHp[i] >= hpMin && catalog.colHp[i] <= hpMax
+			&& catalog.colAttack[i] >= atkMin && catalog.colAttack[i] <= atkMax
+			&& (!filter->typeMask || (filter->typeMask >> catalog.colType[i]) & 1)
+			&& (filter->evolve < 0 || catalog.colEvolve[i] == filter->evolve);
+		mask[i / 64] |= (uint64_t)hit << (i % 64);
+	}
+#endif
+	// drop padding rows
+	if (catalog.count % 64) mask[catalog.count / 64] &= (1ULL << (catalog.count % 64)) - 1;
+	if (filter->ids)
+		for (int w = 0; w < catalog.wordCount; w++) mask[w] &= filter->ids[w];
+	int matches = 0;
+	for (int w = 0; w < catalog.wordCount; w++) matches += __builtin_popcountll(mask[w]);
+	return matches;
+}
+
+
+// --------------------------------------------------------------
+// Battle Engine
+// --------------------------------------------------------------
+int battleBatchInit(BattleBatch *batch, int capacity) {
+	memset(batch, 0, sizeof(*batch));
+	batch->capacity = capacity;
+	for (int side = 0; side < 2; side++) {
+		batch->hp[side] = (int32_t *)malloc(capacity * sizeof(int32_t));
+		batch->power[side] = (int32_t *)malloc(capacity * sizeof(int32_t));
+	}
+	batch->rng = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+	batch->turns = (int32_t *)malloc(capacity * sizeof(int32_t));
+	batch->swapped = (uint8_t *)malloc(capacity);
+	batch->winner = (uint8_t *)malloc(capacity);
+	if (batch->hp[0] && batch->hp[1] && batch->power[0] && batch->power[1]
+		&& batch->rng && batch->turns && batch->swapped && batch->winner) return 1;
+	battleBatchFree(batch);
+	return 0;
+}
+
+
+void battleBatchFree(BattleBatch *batch) {
+	for (int side = 0; side < 2; side++) {
+		free(batch->hp[side]);
+		free(batch->power[side]);
+	}
+	free(batch->rng);
+	free(batch->turns);
+	free(batch->swapped);
+	free(batch->winner);
+	memset(batch, 0, sizeof(*batch));
+}
+
+
+void battleBatchClear(BattleBatch *batch) {
+	batch->count = 0;
+}
+
+
+// splitmix64 finalizer: spreads a seed over all 64 bits.
+static uint64_t mixSeed(uint64_t z) {
+	z += 0x9E3779B97F4A7C15ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+
+int battleBatchAdd(BattleBatch *batch, const PokemonData *a, const PokemonData *b, uint64_t seed) {
+	if (batch->count == batch->capacity) return -1;
+	int i = batch->count++;
+	uint64_t z = mixSeed(seed);
+	int swap = (int)(z >> 63);
+	const PokemonData *first = swap ? b : a;
+	const PokemonData *second = swap ? a : b;
+	batch->hp[0][i] = first->hp;
+	batch->hp[1][i] = second->hp;
+	batch->power[0][i] = first->attack * typeEffect[first->TYPE][second->TYPE];
+	batch->power[1][i] = second->attack * typeEffect[second->TYPE][first->TYPE];
+	uint32_t state = (uint32_t)z;
+	batch->rng[i] = state ? state : 0x9E3779B9u;
+	batch->swapped[i] = (uint8_t)swap;
+	return i;
+}
+
+
+// One turn for every lane: side 0 strikes, then side 1 if it is still up.
+// Finished lanes keep stepping their generator but take no damage, so a
+// lane's result never depends on the others in the batch.
+// Returns nonzero while any lane is still fighting.
+static int32_t battleTurn(int n, int32_t *restrict hp0, int32_t *restrict hp1,
+	const int32_t *restrict power0, const int32_t *restrict power1,
+	uint32_t *restrict rng, int32_t *restrict turns) {
+	int32_t going = 0;
+	for (int i = 0; i < n; i++) {
+		int32_t live = (hp0[i] > 0) & (hp1[i] > 0);
+		uint32_t x = rng[i];
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		int32_t hit = (power0[i] * (int32_t)(BATTLE_ROLL_MIN + (x & 31))) >> BATTLE_DAMAGE_SHIFT;
+		hit += (hit == 0) & (power0[i] > 0);  // a hit that lands does at least 1
+		hp1[i] -= hit & -live;
+		int32_t reply = live & (hp1[i] > 0);
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		hit = (power1[i] * (int32_t)(BATTLE_ROLL_MIN + (x & 31))) >> BATTLE_DAMAGE_SHIFT;
+		hit += (hit == 0) & (power1[i] > 0);
+		hp0[i] -= hit & -reply;
+		rng[i] = x;
+		turns[i] += live;
+		going |= reply & (hp0[i] > 0);
+	}
+	return going;
+}
+
+
+void battleBatchRun(BattleBatch *batch) {
+	int n = batch->count;
+	for (int i = 0; i < n; i++) batch->turns[i] = 0;
+	for (int turn = 0; turn < BATTLE_MAX_TURNS; turn++)
+		if (!battleTurn(n, batch->hp[0], batch->hp[1], batch->power[0], batch->power[1], batch->rng, batch->turns)) break;
+	for (int i = 0; i < n; i++) {
+		int32_t hp0 = batch->hp[0][i], hp1 = batch->hp[1][i];
+		int side = hp1 <= 0 ? 1 : hp0 <= 0 ? 2 : 0;  // 1: lane side 0 won
+		if (side && batch->swapped[i]) side = 3 - side;
+		batch->winner[i] = (uint8_t)side;
+	}
+}
+
+
+// --------------------------------------------------------------
+// Library API
+// --------------------------------------------------------------
+
+// Undo step around one library call.
+typedef struct {
+	PokedexContext *ctx;
+	int ownsUndo;   // the call opened the undo step, so it closes it
+} ApiCall;
+
+
+static void apiEnter(ApiCall *call, PokedexContext *ctx, const char *label) {
+	call->ctx = ctx;
+	// inside a menu command the menu's step already records this change
+	call->ownsUndo = label && !ctx->history.recording;
+	if (call->ownsUndo) undoBegin(ctx, label);
+}
+
+
+static void apiLeave(ApiCall *call) {
+	if (call->ownsUndo) undoEnd(call->ctx);
+}
+
+
+// An owner in the ring; owners kept aside by the undo history don't count.
+static OwnerNode *liveOwner(PokedexContext *ctx, uint32_t handle) {
+	OwnerNode *owner = ownerByHandle(ctx, handle);
+	return owner && owner->next != NO_OWNER ? owner : NULL;
+}
+
+
+PokedexContext *pokedexCreate(void) {
+	PokedexContext *ctx = (PokedexContext *)calloc(1, sizeof(PokedexContext));
+	if (!ctx) return NULL;
+	ctx->summary.bestSpecies = -1;
+	int ok = initRegistry(ctx);
+	if (!ok) freeRegistry(ctx);
+	if (!ok) {
+		free(ctx);
+		return NULL;
+	}
+	return ctx;
+}
+
+
+void pokedexDestroy(PokedexContext *ctx) {
+	if (!ctx) return;
+	checkpointFinish(ctx);
+	feedClose(ctx);
+	replicaClose(ctx);
+	freeHistory(ctx);
+	freeAllOwners(ctx);
+	freeRegistry(ctx);
+	free(ctx);
+}
+
+
+PokedexStatus pkNewOwner(PokedexContext *ctx, const char *name, int speciesId, uint32_t *handle) {
+	// a line break would split the owner's line in snapshots and exports
+	if (!name || strpbrk(name, "\r\n")) return PK_INVALID;
+	ApiCall call;
+	apiEnter(&call, ctx, "New Pokedex");
+	PokedexStatus status = PK_OK;
+	const PokemonData *starter = speciesById(speciesId);
+	OwnerNode *owner = NULL;
+	if (findOwnerByName(ctx, name)) status = PK_EXISTS;
+	else if (!starter) status = PK_INVALID;
+	else if (!(owner = createOwner(ctx, name, starter))) status = PK_NO_MEMORY;
+	else {
+		if (!ctx->ownerHead) {
+			ctx->ownerHead = owner;
+			owner->prev = owner->next = owner->handle;
+		}
+		else linkOwnerInCircularList(ctx, owner);
+		undoOwnerCreated(ctx, owner);
+		replicaOwner(ctx, owner);
+		feedOwnerCreated(ctx, owner);
+		if (handle) *handle = owner->handle;
+	}
+	apiLeave(&call);
+	return status;
+}
+
+
+PokedexStatus pkFindOwner(PokedexContext *ctx, const char *name, uint32_t *handle) {
+	if (!name) return PK_NO_OWNER;
+	OwnerNode *owner = findOwnerByName(ctx, name);
+	if (owner && handle) *handle = owner->handle;
+	return owner ? PK_OK : PK_NO_OWNER;
+}
+
+
+PokedexStatus pkDeleteOwner(PokedexContext *ctx, uint32_t owner) {
+	ApiCall call;
+	apiEnter(&call, ctx, "Delete a Pokedex");
+	OwnerNode *node = liveOwner(ctx, owner);
+	if (node) retireOwner(ctx, node);
+	apiLeave(&call);
+	return node ? PK_OK : PK_NO_OWNER;
+}
+
+
+PokedexStatus pkMergeOwners(PokedexContext *ctx, uint32_t dst, uint32_t src) {
+	if (dst == src) return PK_INVALID;
+	ApiCall call;
+	apiEnter(&call, ctx, "Merge Pokedexes");
+	OwnerNode *to = liveOwner(ctx, dst);
+	OwnerNode *from = liveOwner(ctx, src);
+	if (!to || !from) {
+		apiLeave(&call);
+		return PK_NO_OWNER;
+	}
+	// everything is allocated before dst changes, so running out of memory
+	// leaves both owners as they were
+	int live = from->pokedex.live;
+	PokemonNode *srcTree = NULL;
+	PokemonNode **order = NULL;
+	PokedexStatus status = PK_OK;
+	if (live) {
+		srcTree = pokedexToTree(&from->pokedex);
+		order = (PokemonNode **)malloc(live * sizeof(PokemonNode *));
+		if (!srcTree || !order || !pokedexReserve(&to->pokedex, live)
+			|| !ownerSpeciesReserve(to, from->speciesCount)) status = PK_NO_MEMORY;
+		// and a place in the owner set of every species dst gains
+		for (int i = 0; status == PK_OK && i < from->pokedex.length; i++) {
+			int index = from->pokedex.slots[i];
+			if (index != SPECIES_TOMBSTONE && !ownerHasSpecies(to, &catalog.species[index])
+				&& !ownerSetReserve(&ctx->registry.speciesOwners[index], 1)) status = PK_NO_MEMORY;
+		}
+	}
+	if (status == PK_OK) {
+		feedEmit(ctx, FEED_OWNERS_MERGED, to, src, 0);
+		if (srcTree) {
+			// appending in the BFS order of src's tree keeps dst's display unchanged
+			undoSavePokedex(ctx, to);
+			int head = 0;
+			int tail = 0;
+			order[tail++] = srcTree;
+			while (head < tail) {
+				PokemonNode *n = order[head++];
+				if (!ownerHasSpecies(to, n->data)) {
+					pokedexAppend(&to->pokedex, n->data);  // reserved above
+					notePokemonAdded(ctx, to, n->data);    // likewise
+					feedEmit(ctx, FEED_POKEMON_ADDED, to, (uint32_t)n->data->id, 0);
+				}
+				if (n->left) order[tail++] = n->left;
+				if (n->right) order[tail++] = n->right;
+			}
+		}
+		retireOwner(ctx, from);
+	}
+	free(order);
+	freePokedexTree(&srcTree);
+	apiLeave(&call);
+	return status;
+}
+
+
+PokedexStatus pkSortOwners(PokedexContext *ctx) {
+	ApiCall call;
+	apiEnter(&call, ctx, "Sort Owners by Name");
+	PokedexStatus status = PK_OK;
+	if (ctx->ownerHead && ctx->ownerHead->next != ctx->ownerHead->handle) {
+		// owners stay in their slots (handles are slot numbers); only the links change
+		int count = ringLength(ctx);
+		uint32_t *order = (uint32_t *)malloc(count * sizeof(uint32_t));
+		if (!order) status = PK_NO_MEMORY;
+		else {
+			undoSaveOrder(ctx);
+			readRingOrder(ctx, order, count);
+			qsort_r(order, count, sizeof(uint32_t), compareHandlesByName, ctx);
+			relinkRing(ctx, order, count);
+			free(order);
+			feedEmit(ctx, FEED_OWNERS_SORTED, ctx->ownerHead, 0, 0);
+		}
+	}
+	apiLeave(&call);
+	return status;
+}
+
+
+PokedexStatus pkAddPokemon(PokedexContext *ctx, uint32_t owner, int speciesId) {
+	ApiCall call;
+	apiEnter(&call, ctx, "Add Pokemon");
+	PokedexStatus status = PK_OK;
+	OwnerNode *node = liveOwner(ctx, owner);
+	const PokemonData *data = speciesById(speciesId);
+	if (!node) status = PK_NO_OWNER;
+	else if (!data) status = PK_INVALID;
+	else if (ownerHasSpecies(node, data)) status = PK_EXISTS;
+	else {
+		undoSavePokedex(ctx, node);
+		if (!pokedexAppend(&node->pokedex, data)) status = PK_NO_MEMORY;
+		else if (!notePokemonAdded(ctx, node, data)) {
+			pokedexRemoveAt(&node->pokedex, node->pokedex.length - 1);
+			status = PK_NO_MEMORY;
+		}
+		else feedEmit(ctx, FEED_POKEMON_ADDED, node, (uint32_t)data->id, 0);
+	}
+	apiLeave(&call);
+	return status;
+}
+
+
+PokedexStatus pkReleasePokemon(PokedexContext *ctx, uint32_t owner, int speciesId) {
+	ApiCall call;
+	apiEnter(&call, ctx, "Release Pokemon");
+	PokedexStatus status = PK_OK;
+	OwnerNode *node = liveOwner(ctx, owner);
+	const PokemonData *data = speciesById(speciesId);
+	if (!node) status = PK_NO_OWNER;
+	else if (!node->pokedex.live) status = PK_EMPTY;
+	else if (!data || !ownerHasSpecies(node, data)) status = PK_NOT_FOUND;
+	else {
+		undoSavePokedex(ctx, node);
+		notePokemonRemoved(ctx, node, data);
+		pokedexRemoveAt(&node->pokedex, pokedexFind(&node->pokedex, data));
+		pokedexCompactIfSparse(&node->pokedex);
+		feedEmit(ctx, FEED_POKEMON_RELEASED, node, (uint32_t)data->id, 0);
+	}
+	apiLeave(&call);
+	return status;
+}
+
+
+PokedexStatus pkEvolvePokemon(PokedexContext *ctx, uint32_t owner, int speciesId, int *evolvedId) {
+	ApiCall call;
+	apiEnter(&call, ctx, "Evolve Pokemon");
+	PokedexStatus status = PK_OK;
+	OwnerNode *node = liveOwner(ctx, owner);
+	const PokemonData *current = speciesById(speciesId);
+	const PokemonData *evolved = NULL;
+	if (!node) status = PK_NO_OWNER;
+	else if (!node->pokedex.live) status = PK_EMPTY;
+	else if (!current || !ownerHasSpecies(node, current)) status = PK_NOT_FOUND;
+	else if (!(evolved = evolutionOf(current))) status = PK_CANNOT_EVOLVE;
+	else {
+		if (evolvedId) *evolvedId = evolved->id;
+		undoSavePokedex(ctx, node);
+		int pos = pokedexFind(&node->pokedex, current);
+		notePokemonRemoved(ctx, node, current);
+		if (ownerHasSpecies(node, evolved)) {
+			// the evolved form is already owned; keep that one, drop this one
+			pokedexRemoveAt(&node->pokedex, pos);
+			pokedexCompactIfSparse(&node->pokedex);
+			feedEmit(ctx, FEED_POKEMON_RELEASED, node, (uint32_t)current->id, 0);
+			status = PK_EXISTS;
+		} else if (notePokemonAdded(ctx, node, evolved)) {
+			node->pokedex.slots[pos] = (uint16_t)(evolved - catalog.species);
+			feedEmit(ctx, FEED_POKEMON_EVOLVED, node, (uint32_t)current->id, (uint32_t)evolved->id);
+		} else {
+			// current's own places were just freed, so taking them back cannot fail
+			notePokemonAdded(ctx, node, current);
+			status = PK_NO_MEMORY;
+		}
+	}
+	apiLeave(&call);
+	return status;
+}
+
+
+PokedexStatus pkUndo(PokedexContext *ctx) {
+	const char *label = undoLast(ctx);
+	return label ? PK_OK : PK_EMPTY;
+}
+
+
+PokedexStatus pkRedo(PokedexContext *ctx) {
+	const char *label = redoLast(ctx);
+	return label ? PK_OK : PK_EMPTY;
+}
+
+
+int pkListOwners(PokedexContext *ctx, uint32_t *handles, int max) {
+	int count = 0;
+	const OwnerNode *owner = ctx->ownerHead;
+	if (owner) do {
+		if (count < max) handles[count] = owner->handle;
+		count++;
+		owner = nextOwner(ctx, owner);
+	} while (owner != ctx->ownerHead);
+	return count;
+}
+
+
+const char *pkOwnerName(PokedexContext *ctx, uint32_t owner) {
+	const OwnerNode *node = liveOwner(ctx, owner);
+	return node ? node->ownerName : NULL;
+}
+
+
+int pkOwnerPokemon(PokedexContext *ctx, uint32_t owner, int *ids, int max) {
+	const OwnerNode *node = liveOwner(ctx, owner);
+	int count = -1;
+	if (node) {
+		count = 0;
+		for (int i = 0; i < node->pokedex.length; i++) {
+			int index = node->pokedex.slots[i];
+			if (index == SPECIES_TOMBSTONE) continue;
+			if (count < max) ids[count] = catalog.species[index].id;
+			count++;
+		}
+	}
+	return count;
+}
+
+
+// --------------------------------------------------------------
+// Export
+// --------------------------------------------------------------
+
+// Rows are formatted in place in data and handed to the sink when it fills.
+typedef struct {
+	ExportSink sink;
+	void *arg;
+	char *data;
+	size_t used;
+	int ok;
+} ExportWriter;
+
+
+static void exportFlush(ExportWriter *w) {
+	if (w->ok && w->used)
+		w->ok = w->sink(w->arg, w->data, w->used);
+	w->used = 0;
+}
+
+
+static void exportPut(ExportWriter *w, const char *text, size_t len) {
+	if (w->used + len > EXPORT_BUFFER) {
+		exportFlush(w);
+		if (len > EXPORT_BUFFER) {
+			// too big to stage; goes straight out
+			if (w->ok) w->ok = w->sink(w->arg, text, len);
+			return;
+		}
+	}
+	memcpy(w->data + w->used, text, len);
+	w->used += len;
+}
+
+
+static void exportText(ExportWriter *w, const char *text) {
+	exportPut(w, text, strlen(text));
+}
+
+
+// JSON string body of src; dst needs room for 6 * len bytes.
+static size_t escapeJson(char *dst, const char *src, size_t len) {
+	static const char hex[] = "0123456789abcdef";
+	size_t at = 0;
+	for (size_t i = 0; i < len; i++) {
+		unsigned char c = (unsigned char)src[i];
+		if (c == '"' || c == '\\') {
+			dst[at++] = '\\';
+			dst[at++] = (char)c;
+		} else if (c < 0x20) {
+			memcpy(dst + at, "\\u00", 4);
+			dst[at + 4] = hex[c >> 4];
+			dst[at + 5] = hex[c & 15];
+			at += 6;
+		} else dst[at++] = (char)c;
+	}
+	return at;
+}
+
+
+// CSV field for src, quoted only when it has to be; dst needs room for 2 * len + 2 bytes.
+// A leading '#' or blank and a trailing blank are quoted too, as checkpoints
+// do, so Tool 17 does not skip the row or trim the name.
+static size_t escapeCsv(char *dst, const char *src, size_t len) {
+	int edge = len && (src[0] == '#' || src[0] == ' ' || src[0] == '\t' || src[len - 1] == ' ' || src[len - 1] == '\t');
+	if (!edge && !memchr(src, ',', len) && !memchr(src, '"', len) && !memchr(src, '\n', len) && !memchr(src, '\r', len)) {
+		memcpy(dst, src, len);
+		return len;
+	}
+	size_t at = 0;
+	dst[at++] = '"';
+	for (size_t i = 0; i < len; i++) {
+		if (src[i] == '"') dst[at++] = '"';
+		dst[at++] = src[i];
+	}
+	dst[at++] = '"';
+	return at;
+}
+
+
+static size_t formatUnsigned(char *dst, uint32_t value) {
+	char digits[10];
+	size_t n = 0;
+	do {
+		digits[n++] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value);
+	for (size_t i = 0; i < n; i++) dst[i] = digits[n - 1 - i];
+	return n;
+}
+
+
+// Every species' fields in the chosen format, rendered once: species i is
+// text[start[i] .. start[i + 1]).
+static char *exportRenderSpecies(ExportFormat format, size_t **start) {
+	size_t total = 0;
+	for (int i = 0; i < catalog.count; i++) total += 6 * strlen(catalog.species[i].name) + 128;
+	char *text = (char *)malloc(total);
+	*start = (size_t *)malloc((catalog.count + 1) * sizeof(size_t));
+	if (!text || !*start) {
+		free(text);
+		free(*start);
+		*start = NULL;
+		return NULL;
+	}
+	size_t at = 0;
+	for (int i = 0; i < catalog.count; i++) {
+		const PokemonData *data = &catalog.species[i];
+		const char *evolves = data->CAN_EVOLVE == CAN_EVOLVE ? "true" : "false";
+		(*start)[i] = at;
+		if (format == EXPORT_JSON_LINES) {
+			at += (size_t)snprintf(text + at, total - at, "{\"id\":%d,\"name\":\"", data->id);
+			at += escapeJson(text + at, data->name, strlen(data->name));
+			at += (size_t)snprintf(text + at, total - at, "\",\"type\":\"%s\",\"hp\":%d,\"attack\":%d,\"canEvolve\":%s}",
+				getTypeName(data->TYPE), data->hp, data->attack, evolves);
+		} else {
+			at += (size_t)snprintf(text + at, total - at, "%d,", data->id);
+			at += escapeCsv(text + at, data->name, strlen(data->name));
+			at += (size_t)snprintf(text + at, total - at, ",%s,%d,%d,%s",
+				getTypeName(data->TYPE), data->hp, data->attack, evolves);
+		}
+	}
+	(*start)[catalog.count] = at;
+	return text;
+}
+
+
+long exportOwners(PokedexContext *ctx, ExportFormat format, ExportSink sink, void *arg) {
+	size_t *start = NULL;
+	char *species = exportRenderSpecies(format, &start);
+	ExportWriter w = { sink, arg, (char *)malloc(EXPORT_BUFFER), 0, 1 };
+	// the escaped owner name; grows to the longest name, not per row
+	char *name = NULL;
+	size_t nameCapacity = 0;
+	if (!species || !w.data) {
+		free(species);
+		free(start);
+		free(w.data);
+		return -1;
+	}
+	if (format == EXPORT_CSV) exportText(&w, "owner,position,id,name,type,hp,attack,can_evolve\n");
+	long owners = 0;
+	const OwnerNode *owner = ctx->ownerHead;
+	if (owner) do {
+		size_t worst = 6 * (size_t)owner->nameLength + 2;
+		if (worst > nameCapacity) {
+			char *grown = (char *)realloc(name, worst);
+			if (!grown) {
+				w.ok = 0;
+				break;
+			}
+			name = grown;
+			nameCapacity = worst;
+		}
+		size_t nameLen = format == EXPORT_JSON_LINES
+			? escapeJson(name, owner->ownerName, owner->nameLength)
+			: escapeCsv(name, owner->ownerName, owner->nameLength);
+		const Pokedex *dex = &owner->pokedex;
+		if (format == EXPORT_JSON_LINES) {
+			exportText(&w, "{\"owner\":\"");
+			exportPut(&w, name, nameLen);
+			exportText(&w, "\",\"pokemon\":[");
+			int first = 1;
+			for (int i = 0; i < dex->length; i++) {
+				int index = dex->slots[i];
+				if (index == SPECIES_TOMBSTONE) continue;
+				if (!first) exportText(&w, ",");
+				exportPut(&w, species + start[index], start[index + 1] - start[index]);
+				first = 0;
+			}
+			exportText(&w, "]}\n");
+		} else if (!dex->live) {
+			// an owner with no Pokemon still gets a row
+			exportPut(&w, name, nameLen);
+			exportText(&w, ",,,,,,,\n");
+		} else {
+			uint32_t position = 0;
+			char number[12];
+			for (int i = 0; i < dex->length; i++) {
+				int index = dex->slots[i];
+				if (index == SPECIES_TOMBSTONE) continue;
+				exportPut(&w, name, nameLen);
+				number[0] = ',';
+				size_t len = 1 + formatUnsigned(number + 1, ++position);
+				number[len++] = ',';
+				exportPut(&w, number, len);
+				exportPut(&w, species + start[index], start[index + 1] - start[index]);
+				exportText(&w, "\n");
+			}
+		}
+		owners++;
+		owner = nextOwner(ctx, owner);
+	} while (w.ok && owner != ctx->ownerHead);
+	exportFlush(&w);
+	free(name);
+	free(w.data);
+	free(species);
+	free(start);
+	return w.ok ? owners : -1;
+}
+
+
+static int exportToFd(void *arg, const void *data, size_t len) {
+	return writeAll(*(const int *)arg, data, len);
+}
+
+
+PokedexStatus pkExportOwners(PokedexContext *ctx, int fd, ExportFormat format, long *owners) {
+	if (format != EXPORT_JSON_LINES && format != EXPORT_CSV) return PK_INVALID;
+	long written = exportOwners(ctx, format, exportToFd, &fd);
+	if (owners) *owners = written < 0 ? 0 : written;
+	return written < 0 ? PK_IO_ERROR : PK_OK;
+}
+
+
+// --------------------------------------------------------------
+// Import
+// --------------------------------------------------------------
+
+// Owner handles by name for the length of one import; open addressing on
+// the cached name hash, NO_OWNER marks an empty slot.
+typedef struct {
+	uint32_t *slots;
+	uint32_t mask;
+	uint32_t used;
+} NameIndex;
+
+
+static int nameIndexInit(NameIndex *index, uint32_t expected) {
+	uint32_t capacity = 64;
+	while (capacity / 2 < expected) capacity *= 2;
+	index->slots = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+	if (!index->slots) return 0;
+	memset(index->slots, 0xff, capacity * sizeof(uint32_t));
+	index->mask = capacity - 1;
+	index->used = 0;
+	return 1;
+}
+
+
+static void nameIndexPlace(NameIndex *index, const OwnerNode *owner) {
+	uint32_t at = owner->nameHash & index->mask;
+	while (index->slots[at] != NO_OWNER) at = (at + 1) & index->mask;
+	index->slots[at] = owner->handle;
+}
+
+
+static int nameIndexPut(PokedexContext *ctx, NameIndex *index, const OwnerNode *owner) {
+	if (2 * (index->used + 1) > index->mask + 1) {
+		// keep it at most half full so probes stay short
+		NameIndex grown;
+		grown.mask = 2 * (index->mask + 1) - 1;
+		grown.slots = (uint32_t *)malloc((size_t)(grown.mask + 1) * sizeof(uint32_t));
+		if (!grown.slots) return 0;
+		memset(grown.slots, 0xff, (size_t)(grown.mask + 1) * sizeof(uint32_t));
+		for (uint32_t i = 0; i <= index->mask; i++)
+			if (index->slots[i] != NO_OWNER) nameIndexPlace(&grown, ownerByHandle(ctx, index->slots[i]));
+		free(index->slots);
+		index->slots = grown.slots;
+		index->mask = grown.mask;
+	}
+	nameIndexPlace(index, owner);
+	index->used++;
+	return 1;
+}
+
+
+static OwnerNode *nameIndexFind(PokedexContext *ctx, const NameIndex *index, const char *name, size_t len, uint32_t hash) {
+	for (uint32_t at = hash & index->mask; index->slots[at] != NO_OWNER; at = (at + 1) & index->mask) {
+		OwnerNode *owner = ownerByHandle(ctx, index->slots[at]);
+		if (owner->nameHash == hash && owner->nameLength == len && memcmp(owner->ownerName, name, len) == 0)
+			return owner;
+	}
+	return NULL;
+}
+
+
+// Catalog index of a species field (an ID or a name), or -1.
+static int importSpecies(const char *field, size_t len) {
+	size_t digits = 0;
+	int id = 0;
+	while (digits < len && field[digits] >= '0' && field[digits] <= '9') {
+		// anything this long is out of range anyway; stop before int overflows
+		if (id < MAX_ID_SPAN) id = id * 10 + (field[digits] - '0');
+		digits++;
+	}
+	const PokemonData *data = digits == len ? speciesById(id) : speciesByName(field, len);
+	return data ? (int)(data - catalog.species) : -1;
+}
+
+
+static void importReject(ImportReport *report, long line, ImportProblem problem, const char *token, size_t len) {
+	report->rejected++;
+	if (report->samples == IMPORT_SAMPLES) return;
+	if (len > IMPORT_TOKEN - 1) len = IMPORT_TOKEN - 1;
+	report->sample[report->samples].line = line;
+	report->sample[report->samples].problem = problem;
+	memcpy(report->sample[report->samples].token, token, len);
+	report->sample[report->samples].token[len] = '\0';
+	report->samples++;
+}
+
+
+// An import keeps the species -> owners sets and the leaderboard loose while
+// it runs: handles are appended unsorted and each touched owner leaves the
+// board once. importSettle puts both back in order at the end.
+typedef struct {
+	char *dirty;             // by catalog index: the owner set needs sorting
+	char *touched;           // by handle: the owner is off the leaderboard
+	uint32_t touchedCapacity;
+	uint32_t touchedCount;
+} ImportBatch;
+
+
+static int compareHandleValues(const void *a, const void *b) {
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+	return (x > y) - (x < y);
+}
+
+
+static int importTouch(PokedexContext *ctx, ImportBatch *batch, OwnerNode *owner) {
+	if (owner->handle >= batch->touchedCapacity) {
+		uint32_t capacity = batch->touchedCapacity ? batch->touchedCapacity : 1024;
+		while (capacity <= owner->handle) capacity *= 2;
+		char *grown = (char *)realloc(batch->touched, capacity);
+		if (!grown) return 0;
+		memset(grown + batch->touchedCapacity, 0, capacity - batch->touchedCapacity);
+		batch->touched = grown;
+		batch->touchedCapacity = capacity;
+	}
+	if (!batch->touched[owner->handle]) {
+		batch->touched[owner->handle] = 1;
+		batch->touchedCount++;
+		if (owner->stats.pokemonCount) leaderboardRemove(ctx, owner);
+	}
+	return 1;
+}
+
+
+// notePokemonAdded for a touched owner, with the sorting and the board left to importSettle.
+static int importPokemon(PokedexContext *ctx, ImportBatch *batch, OwnerNode *owner, const PokemonData *data) {
+	int index = (int)(data - catalog.species);
+	if (!pokedexAppend(&owner->pokedex, data)) return 0;
+	if (!ownerSpeciesAdd(owner, catalog.scoreRank[index])) {
+		owner->pokedex.length--;
+		owner->pokedex.live--;
+		return 0;
+	}
+	if (!ownerSetAppend(&ctx->registry.speciesOwners[index], owner->handle)) {
+		ownerSpeciesRemove(owner, catalog.scoreRank[index]);
+		owner->pokedex.length--;
+		owner->pokedex.live--;
+		return 0;
+	}
+	batch->dirty[index] = 1;
+	countPokemonAdded(ctx, owner, data);
+	replicaSpecies(ctx, owner, index, 1);
+	feedEmit(ctx, FEED_POKEMON_ADDED, owner, (uint32_t)data->id, 0);
+	return 1;
+}
+
+
+static void importSettle(PokedexContext *ctx, ImportBatch *batch) {
+	for (int i = 0; i < catalog.count; i++)
+		if (batch->dirty[i])
+			qsort(ctx->registry.speciesOwners[i].owners, ctx->registry.speciesOwners[i].count, sizeof(uint32_t), compareHandleValues);
+	// past a few percent of the board, one rebuild beats an insert per owner
+	if (batch->touchedCount > boardSizeOf(ctx, ctx->registry.boardRoot) / 16 && boardRebuild(ctx)) return;
+	for (uint32_t handle = 0; handle < batch->touchedCapacity; handle++) {
+		if (!batch->touched[handle]) continue;
+		OwnerNode *owner = ownerByHandle(ctx, handle);
+		if (owner->stats.pokemonCount) leaderboardInsert(ctx, owner);
+	}
+}
+
+
+static int isBlank(char c) {
+	return c == ' ' || c == '\t';
+}
+
+
+// The 1-based field after the owner name whose header is "id" (any case),
+// or 0. fields starts at the comma that ends the name.
+static int importIdColumn(const char *fields, const char *lineEnd) {
+	int column = 0;
+	while (fields < lineEnd) {
+		const char *field = fields + 1;
+		const char *comma = memchr(field, ',', lineEnd - field);
+		const char *fieldEnd = comma ? comma : lineEnd;
+		fields = fieldEnd;
+		column++;
+		while (field < fieldEnd && isBlank(*field)) field++;
+		const char *last = fieldEnd;
+		while (last > field && isBlank(last[-1])) last--;
+		if (last - field == 2 && tolower((unsigned char)field[0]) == 'i' && tolower((unsigned char)field[1]) == 'd')
+			return column;
+	}
+	return 0;
+}
+
+
+PokedexStatus importOwners(PokedexContext *ctx, const char *path, ImportReport *report) {
+	memset(report, 0, sizeof(*report));
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return PK_IO_ERROR;
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		int error = errno;
+		close(fd);
+		errno = error;
+		return PK_IO_ERROR;
+	}
+	size_t size = (size_t)st.st_size;
+	if (size == 0) {
+		close(fd);
+		return PK_OK;
+	}
+	const char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	int error = errno;
+	close(fd);
+	if (map == MAP_FAILED) {
+		errno = error;
+		return PK_IO_ERROR;
+	}
+	posix_madvise((void *)map, size, POSIX_MADV_SEQUENTIAL);
+	// a name or a row's species can never outgrow the longest line, so both
+	// scratch buffers are sized once per line length seen, not per row
+	size_t nameCapacity = 0;
+	char *name = NULL;
+	int fieldCapacity = 0;
+	int *fields = NULL;
+	NameIndex index;
+	ImportBatch batch = { (char *)calloc(catalog.count, 1), NULL, 0, 0 };
+	if (!batch.dirty || !nameIndexInit(&index, (uint32_t)ringLength(ctx))) {
+		free(batch.dirty);
+		munmap((void *)map, size);
+		return PK_NO_MEMORY;
+	}
+	const OwnerNode *walk = ctx->ownerHead;
+	if (walk) do {
+		nameIndexPut(ctx, &index, walk);
+		walk = nextOwner(ctx, walk);
+	} while (walk != ctx->ownerHead);
+
+	PokedexStatus status = PK_OK;
+	int changed = 0;
+	// set by an "owner,...,id,..." header such as Tool 16's CSV: only that
+	// column holds a species, the rest describe it
+	int idColumn = 0;
+	long line = 0;
+	const char *p = map;
+	const char *end = map + size;
+	while (p < end) {
+		const char *eol = memchr(p, '\n', end - p);
+		const char *lineEnd = eol ? eol : end;
+		line++;
+		const char *q = p;
+		p = eol ? eol + 1 : end;
+		if (lineEnd > q && lineEnd[-1] == '\r') lineEnd--;
+		while (q < lineEnd && isBlank(*q)) q++;
+		if (q == lineEnd || *q == '#') continue;
+		report->rows++;
+		size_t lineLen = (size_t)(lineEnd - q);
+		if (lineLen + 1 > nameCapacity || (int)lineLen / 2 + 1 > fieldCapacity) {
+			char *grownName = (char *)realloc(name, lineLen + 1);
+			if (grownName) name = grownName;
+			int *grownFields = (int *)realloc(fields, (lineLen / 2 + 1) * sizeof(int));
+			if (grownFields) fields = grownFields;
+			if (!grownName || !grownFields) {
+				status = PK_NO_MEMORY;
+				break;
+			}
+			nameCapacity = lineLen + 1;
+			fieldCapacity = (int)lineLen / 2 + 1;
+		}
+
+		// the owner name, quoted as the snapshot writes it when it has to be
+		size_t nameLen = 0;
+		const char *rowStart = q;
+		if (*q == '"') {
+			int closed = 0;
+			q++;
+			while (q < lineEnd) {
+				const char *quote = memchr(q, '"', lineEnd - q);
+				const char *stop = quote ? quote : lineEnd;
+				memcpy(name + nameLen, q, stop - q);
+				nameLen += stop - q;
+				if (!quote) {
+					q = lineEnd;
+					break;
+				}
+				if (quote + 1 < lineEnd && quote[1] == '"') {
+					name[nameLen++] = '"';
+					q = quote + 2;
+					continue;
+				}
+				q = quote + 1;
+				closed = 1;
+				break;
+			}
+			while (q < lineEnd && isBlank(*q)) q++;
+			if (!closed || (q < lineEnd && *q != ',')) {
+				importReject(report, line, IMPORT_BAD_QUOTES, rowStart, lineEnd - rowStart);
+				continue;
+			}
+		} else {
+			const char *comma = memchr(q, ',', lineEnd - q);
+			const char *nameEnd = comma ? comma : lineEnd;
+			const char *last = nameEnd;
+			while (last > q && isBlank(last[-1])) last--;
+			nameLen = (size_t)(last - q);
+			memcpy(name, q, nameLen);
+			q = nameEnd;
+		}
+		if (!nameLen) {
+			importReject(report, line, IMPORT_NO_NAME, rowStart, lineEnd - rowStart);
+			continue;
+		}
+		if (memchr(name, '\0', nameLen)) {
+			// owner names are C strings; "Ash\0x" would be stored as "Ash"
+			// next to an owner already called that
+			importReject(report, line, IMPORT_NUL_NAME, rowStart, lineEnd - rowStart);
+			continue;
+		}
+
+		// every species is checked before anything changes
+		const char *afterName = q;
+		int count = 0;
+		int column = 0;
+		const char *bad = NULL;
+		size_t badLen = 0;
+		while (q < lineEnd) {
+			const char *field = q + 1;
+			const char *comma = memchr(field, ',', lineEnd - field);
+			const char *fieldEnd = comma ? comma : lineEnd;
+			q = fieldEnd;
+			if (idColumn && ++column != idColumn) continue;
+			while (field < fieldEnd && isBlank(*field)) field++;
+			const char *last = fieldEnd;
+			while (last > field && isBlank(last[-1])) last--;
+			if (last == field) continue;   // empty fields, as in ragged rows, say nothing
+			int species = importSpecies(field, (size_t)(last - field));
+			if (species < 0) {
+				bad = field;
+				badLen = (size_t)(last - field);
+				break;
+			}
+			fields[count++] = species;
+		}
+		if (bad) {
+			int header = report->rows == 1 && nameLen == 5;
+			for (size_t i = 0; header && i < nameLen; i++) header = tolower((unsigned char)name[i]) == "owner"[i];
+			if (header) {
+				report->rows--;   // "owner,species_id" and the like
+				idColumn = importIdColumn(afterName, lineEnd);
+			} else importReject(report, line, IMPORT_BAD_SPECIES, bad, badLen);
+			continue;
+		}
+
+		if (!changed) {
+			// too big to journal; the steps before it would no longer apply
+			changed = 1;
+			if (ctx->history.recording) ctx->history.failed = 1;
+			else {
+				clearHistory(ctx);
+				checkpointNoteChange(ctx);
+			}
+		}
+		uint32_t hash = hashOwnerName(name, nameLen);
+		OwnerNode *owner = nameIndexFind(ctx, &index, name, nameLen, hash);
+		if (!owner) {
+			name[nameLen] = '\0';
+			owner = createOwner(ctx, name, NULL);
+			if (!owner) {
+				status = PK_NO_MEMORY;
+				break;
+			}
+			if (!ctx->ownerHead) {
+				ctx->ownerHead = owner;
+				owner->prev = owner->next = owner->handle;
+			}
+			else linkOwnerInCircularList(ctx, owner);
+			replicaOwner(ctx, owner);
+			feedOwnerCreated(ctx, owner);
+			report->owners++;
+			if (!nameIndexPut(ctx, &index, owner)) {
+				status = PK_NO_MEMORY;
+				break;
+			}
+		}
+		if (!importTouch(ctx, &batch, owner) || !pokedexReserve(&owner->pokedex, count)) {
+			status = PK_NO_MEMORY;
+			break;
+		}
+		for (int i = 0; status == PK_OK && i < count; i++) {
+			const PokemonData *data = &catalog.species[fields[i]];
+			if (ownerHasSpecies(owner, data)) report->duplicates++;
+			else if (importPokemon(ctx, &batch, owner, data)) report->pokemon++;
+			else status = PK_NO_MEMORY;
+		}
+		if (status != PK_OK) break;
+	}
+	importSettle(ctx, &batch);
+	free(batch.dirty);
+	free(batch.touched);
+	free(index.slots);
+	free(name);
+	free(fields);
+	munmap((void *)map, size);
+	return status;
+}
+
+
+PokedexStatus pkImportOwners(PokedexContext *ctx, const char *path, ImportReport *report) {
+	ApiCall call;
+	apiEnter(&call, ctx, "Import owners");
+	PokedexStatus status = importOwners(ctx, path, report);
+	apiLeave(&call);
+	return status;
+}
+
+
+// --------------------------------------------------------------
+// Change Feed
+// --------------------------------------------------------------
+
+// Slots are rewritten seqlock style: the sequence word goes to 0, then the
+// payload is stored, then the new sequence with a release store. A reader
+// that sees the same sequence before and after its copy has a whole event.
+static void feedPublish(PokedexContext *ctx, const FeedEvent *event) {
+	ChangeFeed *f = &ctx->changeFeed;
+	uint64_t sequence = f->published + 1;
+	FeedSlot copy;
+	memcpy(&copy, event, sizeof(copy));
+	FeedSlot *slot = &f->slots[sequence & f->mask];
+	__atomic_store_n(&slot->word[0], 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	for (size_t w = 1; w < sizeof(copy.word) / sizeof(copy.word[0]); w++)
+		__atomic_store_n(&slot->word[w], copy.word[w], __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->word[0], sequence, __ATOMIC_RELEASE);
+	// sequentially consistent on both sides, so the server either sees this
+	// event before it sleeps or is seen sleeping here and woken
+	__atomic_store_n(&f->published, sequence, __ATOMIC_SEQ_CST);
+	if (f->server && __atomic_load_n(&f->sleeping, __ATOMIC_SEQ_CST)
+		&& __atomic_exchange_n(&f->sleeping, 0, __ATOMIC_SEQ_CST)) {
+		char byte = 0;
+		// a full pipe means the server has wake-ups pending already
+		if (write(f->wakeFd, &byte, 1) < 0 && errno != EAGAIN) return;
+	}
+}
+
+
+void feedEmit(PokedexContext *ctx, FeedEventKind kind, const OwnerNode *owner, uint32_t a, uint32_t b) {
+	if (!ctx->changeFeed.slots) return;
+	FeedEvent event;
+	memset(&event, 0, sizeof(event));
+	event.kind = (uint8_t)kind;
+	event.owner = owner->handle;
+	event.a = a;
+	event.b = b;
+	feedPublish(ctx, &event);
+}
+
+
+void feedOwnerCreated(PokedexContext *ctx, const OwnerNode *owner) {
+	if (!ctx->changeFeed.slots) return;
+	FeedEvent event;
+	memset(&event, 0, sizeof(event));
+	event.kind = FEED_OWNER_CREATED;
+	event.owner = owner->handle;
+	event.a = owner->nameLength;
+	uint32_t done = 0;
+	do {
+		uint32_t part = owner->nameLength - done;
+		if (part > FEED_TEXT) part = FEED_TEXT;
+		memset(event.text, 0, sizeof(event.text));
+		memcpy(event.text, owner->ownerName + done, part);
+		event.length = (uint8_t)part;
+		feedPublish(ctx, &event);
+		event.kind = FEED_NAME_MORE;
+		done += part;
+	} while (done < owner->nameLength);
+	const Pokedex *dex = &owner->pokedex;
+	for (int i = 0; i < dex->length; i++)
+		if (dex->slots[i] != SPECIES_TOMBSTONE) feedEmit(ctx, FEED_POKEMON_ADDED, owner, catalog.species[dex->slots[i]].id, 0);
+}
+
+
+void feedPokedexDifference(PokedexContext *ctx, const OwnerNode *owner, const Pokedex *dex, FeedEventKind kind) {
+	if (!ctx->changeFeed.slots) return;
+	for (int i = 0; i < dex->length; i++) {
+		int index = dex->slots[i];
+		if (index != SPECIES_TOMBSTONE && !ownerHasSpecies(owner, &catalog.species[index]))
+			feedEmit(ctx, kind, owner, catalog.species[index].id, 0);
+	}
+}
+
+
+static int stagesLeft(int index) {
+	int stages = 0;
+	for (; catalog.nextStage[index] >= 0; index = catalog.nextStage[index]) stages++;
+	return stages;
+}
+
+
+void feedEvolutions(PokedexContext *ctx, const OwnerNode *owner, const int *positions, const PokemonData *const *to, int count) {
+	if (!ctx->changeFeed.slots) return;
+	// Whatever a Pokemon evolves into is nearer its final form, so going
+	// from the fewest stages left up, a species is always released or
+	// evolved away before another Pokemon evolves into it.
+	int more = 1;
+	for (int stages = 0; more; stages++) {
+		more = 0;
+		for (int i = 0; i < count; i++) {
+			int index = owner->pokedex.slots[positions[i]];
+			int left = stagesLeft(index);
+			if (left > stages) more = 1;
+			if (left != stages) continue;
+			if (to[i]) feedEmit(ctx, FEED_POKEMON_EVOLVED, owner, catalog.species[index].id, to[i]->id);
+			else feedEmit(ctx, FEED_POKEMON_RELEASED, owner, catalog.species[index].id, 0);
+		}
+	}
+}
+
+
+PokedexStatus pkFeedOpen(PokedexContext *ctx, uint32_t slots) {
+	PokedexStatus status = PK_OK;
+	if (!ctx->changeFeed.slots) {
+		uint64_t capacity = 64;
+		while (capacity < (slots ? slots : FEED_SLOTS)) capacity *= 2;
+		FeedSlot *ring = (FeedSlot *)calloc(capacity, sizeof(FeedSlot));
+		if (!ring) status = PK_NO_MEMORY;
+		else {
+			ctx->changeFeed.slots = ring;
+			ctx->changeFeed.mask = capacity - 1;
+			ctx->changeFeed.published = 0;
+		}
+	}
+	return status;
+}
+
+
+static void feedReaderStart(FeedReader *reader, const ChangeFeed *feed) {
+	reader->feed = feed;
+	reader->next = __atomic_load_n(&feed->published, __ATOMIC_ACQUIRE) + 1;
+}
+
+
+void feedReaderInit(FeedReader *reader, PokedexContext *ctx) {
+	feedReaderStart(reader, &ctx->changeFeed);
+}
+
+
+int feedRead(FeedReader *reader, FeedEvent *event) {
+	const ChangeFeed *f = reader->feed;
+	uint64_t published = __atomic_load_n(&f->published, __ATOMIC_ACQUIRE);
+	if (reader->next > published) return 0;
+	uint64_t capacity = f->mask + 1;
+	if (published - reader->next < capacity) {
+		const FeedSlot *slot = &f->slots[reader->next & f->mask];
+		FeedSlot copy;
+		copy.word[0] = __atomic_load_n(&slot->word[0], __ATOMIC_ACQUIRE);
+		for (size_t w = 1; w < sizeof(copy.word) / sizeof(copy.word[0]); w++)
+			copy.word[w] = __atomic_load_n(&slot->word[w], __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (copy.word[0] == reader->next && __atomic_load_n(&slot->word[0], __ATOMIC_RELAXED) == reader->next) {
+			memcpy(event, &copy, sizeof(*event));
+			reader->next++;
+			return 1;
+		}
+		// overwritten while we copied it
+		published = __atomic_load_n(&f->published, __ATOMIC_ACQUIRE);
+	}
+	// pick up half a ring behind the publisher, so the next reads don't lose at once again
+	uint64_t resume = published - capacity / 2 + 1;
+	if (resume <= reader->next) resume = reader->next + 1;
+	uint64_t lost = resume - reader->next;
+	memset(event, 0, sizeof(*event));
+	event->kind = FEED_OVERFLOW;
+	event->a = lost > UINT32_MAX ? UINT32_MAX : (uint32_t)lost;
+	reader->next = resume;
+	return 1;
+}
+
+
+// One connection of a feed server and the events it has yet to take
+typedef struct {
+	int fd;
+	FeedReader reader;
+	FeedEvent batch[FEED_BATCH];
+	size_t sent;             // bytes of batch written so far
+	size_t filled;           // bytes of batch in use
+	int blocked;             // the last write would have blocked
+} FeedClient;
+
+struct FeedServer {
+	ChangeFeed *feed;
+	int listenFd;            // -1 when serving a FIFO
+	int wake[2];             // the publisher writes a byte when the server sleeps
+	int stop;
+	char *path;              // socket to remove at the end, NULL for a FIFO
+	pthread_t thread;
+	FeedClient *clients;
+	int clientCount;
+	int clientCapacity;
+};
+
+
+static int feedClientAdd(struct FeedServer *server, int fd) {
+	if (server->clientCount == server->clientCapacity) {
+		int capacity = server->clientCapacity ? server->clientCapacity * 2 : 4;
+		FeedClient *temp = (FeedClient *)realloc(server->clients, capacity * sizeof(FeedClient));
+		if (!temp) return 0;
+		server->clients = temp;
+		server->clientCapacity = capacity;
+	}
+	FeedClient *client = &server->clients[server->clientCount++];
+	client->fd = fd;
+	feedReaderStart(&client->reader, server->feed);
+	client->sent = client->filled = 0;
+	client->blocked = 0;
+	return 1;
+}
+
+
+static void feedClientDrop(struct FeedServer *server, int i) {
+	close(server->clients[i].fd);
+	server->clients[i] = server->clients[--server->clientCount];
+}
+
+
+// Send the client what it can take without blocking; 0 once it is gone.
+static int feedClientPump(struct FeedServer *server, FeedClient *client) {
+	client->blocked = 0;
+	for (;;) {
+		if (client->sent == client->filled) {
+			int count = 0;
+			while (count < FEED_BATCH && feedRead(&client->reader, &client->batch[count])) count++;
+			if (!count) return 1;
+			client->sent = 0;
+			client->filled = count * sizeof(FeedEvent);
+		}
+		const char *data = (const char *)client->batch + client->sent;
+		size_t len = client->filled - client->sent;
+		ssize_t n = server->listenFd >= 0 ? send(client->fd, data, len, MSG_NOSIGNAL) : write(client->fd, data, len);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK) return 0;
+			client->blocked = 1;
+			return 1;
+		}
+		client->sent += (size_t)n;
+	}
+}
+
+
+static void *feedServerMain(void *arg) {
+	struct FeedServer *server = (struct FeedServer *)arg;
+	struct pollfd *fds = NULL;
+	int fdsCapacity = 0;
+	while (!__atomic_load_n(&server->stop, __ATOMIC_ACQUIRE)) {
+		for (int i = server->clientCount - 1; i >= 0; i--)
+			if (!feedClientPump(server, &server->clients[i])) feedClientDrop(server, i);
+		// sleep only when every client that can take more has it all
+		__atomic_store_n(&server->feed->sleeping, 1, __ATOMIC_SEQ_CST);
+		uint64_t published = __atomic_load_n(&server->feed->published, __ATOMIC_SEQ_CST);
+		int behind = 0;
+		for (int i = 0; i < server->clientCount; i++)
+			if (!server->clients[i].blocked && server->clients[i].reader.next <= published) behind = 1;
+		if (behind) {
+			__atomic_store_n(&server->feed->sleeping, 0, __ATOMIC_SEQ_CST);
+			continue;
+		}
+		int count = server->clientCount + 2;
+		if (count > fdsCapacity) {
+			struct pollfd *temp = (struct pollfd *)realloc(fds, count * sizeof(struct pollfd));
+			if (!temp) {
+				// try again shortly rather than spin
+				__atomic_store_n(&server->feed->sleeping, 0, __ATOMIC_SEQ_CST);
+				usleep(1000);
+				continue;
+			}
+			fds = temp;
+			fdsCapacity = count;
+		}
+		fds[0].fd = server->wake[0];
+		fds[0].events = POLLIN;
+		fds[1].fd = server->listenFd;  // ignored by poll while -1
+		fds[1].events = POLLIN;
+		for (int i = 0; i < server->clientCount; i++) {
+			fds[i + 2].fd = server->clients[i].fd;
+			// a FIFO is open for reading too, and its readable bytes are our own
+			fds[i + 2].events = server->clients[i].blocked ? POLLOUT : server->listenFd >= 0 ? POLLIN : 0;
+		}
+		int ready = poll(fds, count, -1);
+		__atomic_store_n(&server->feed->sleeping, 0, __ATOMIC_SEQ_CST);
+		if (ready <= 0) continue;
+		char scratch[256];
+		if (fds[0].revents & POLLIN)
+			while (read(server->wake[0], scratch, sizeof(scratch)) > 0) {}
+		for (int i = server->clientCount - 1; i >= 0; i--) {
+			short revents = fds[i + 2].revents;
+			if (revents & (POLLERR | POLLHUP | POLLNVAL)) feedClientDrop(server, i);
+			else if (revents & POLLIN) {
+				// clients have nothing to say; reading finds out when they hang up
+				ssize_t n = recv(server->clients[i].fd, scratch, sizeof(scratch), 0);
+				if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) feedClientDrop(server, i);
+			}
+		}
+		if (fds[1].revents & POLLIN) {
+			int fd;
+			while ((fd = accept4(server->listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+				if (!feedClientAdd(server, fd)) close(fd);
+		}
+	}
+	// what was published before the stop still goes out, as far as it fits
+	for (int i = server->clientCount - 1; i >= 0; i--) feedClientPump(server, &server->clients[i]);
+	free(fds);
+	return NULL;
+}
+
+
+static void feedServerFree(struct FeedServer *server) {
+	for (int i = 0; i < server->clientCount; i++) close(server->clients[i].fd);
+	free(server->clients);
+	if (server->listenFd >= 0) close(server->listenFd);
+	if (server->path) {
+		unlink(server->path);
+		free(server->path);
+	}
+	if (server->wake[0] >= 0) close(server->wake[0]);
+	if (server->wake[1] >= 0) close(server->wake[1]);
+	free(server);
+}
+
+
+// The listening socket at path, or -1 with errno set.
+static int feedListen(const char *path) {
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	strcpy(address.sun_path, path);
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) return -1;
+	// a socket left behind by an earlier run; anything else at path stays
+	struct stat st;
+	if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+	if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 16) != 0) {
+		int error = errno;
+		close(fd);
+		errno = error;
+		return -1;
+	}
+	return fd;
+}
+
+
+static PokedexStatus feedServe(PokedexContext *ctx, const char *path) {
+	if (!ctx->changeFeed.slots || ctx->changeFeed.server) return PK_INVALID;
+	struct FeedServer *server = (struct FeedServer *)calloc(1, sizeof(struct FeedServer));
+	if (!server) return PK_NO_MEMORY;
+	server->feed = &ctx->changeFeed;
+	server->listenFd = -1;
+	server->wake[0] = server->wake[1] = -1;
+	if (pipe2(server->wake, O_NONBLOCK | O_CLOEXEC) != 0) {
+		int error = errno;
+		feedServerFree(server);
+		errno = error;
+		return PK_IO_ERROR;
+	}
+	struct stat st;
+	if (stat(path, &st) == 0 && S_ISFIFO(st.st_mode)) {
+		// read-write, so opening doesn't wait for a reader and writes never raise SIGPIPE
+		int fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+		if (fd < 0 || !feedClientAdd(server, fd)) {
+			int error = errno;
+			if (fd >= 0) close(fd);
+			feedServerFree(server);
+			errno = error;
+			return fd < 0 ? PK_IO_ERROR : PK_NO_MEMORY;
+		}
+	} else {
+		server->listenFd = feedListen(path);
+		server->path = server->listenFd >= 0 ? myStrdup(path) : NULL;
+		if (!server->path) {
+			int error = errno;
+			PokedexStatus status = server->listenFd < 0 ? PK_IO_ERROR : PK_NO_MEMORY;
+			if (server->listenFd >= 0) unlink(path);
+			feedServerFree(server);
+			errno = error;
+			return status;
+		}
+	}
+	ctx->changeFeed.wakeFd = server->wake[1];
+	ctx->changeFeed.server = server;
+	if (pthread_create(&server->thread, NULL, feedServerMain, server) != 0) {
+		ctx->changeFeed.server = NULL;
+		feedServerFree(server);
+		return PK_NO_MEMORY;
+	}
+	return PK_OK;
+}
+
+
+PokedexStatus pkFeedServe(PokedexContext *ctx, const char *path) {
+	PokedexStatus status = feedServe(ctx, path);
+	return status;
+}
+
+
+void feedClose(PokedexContext *ctx) {
+	struct FeedServer *server = ctx->changeFeed.server;
+	if (server) {
+		__atomic_store_n(&server->stop, 1, __ATOMIC_RELEASE);
+		char byte = 0;
+		while (write(server->wake[1], &byte, 1) < 0 && errno == EINTR) {}
+		pthread_join(server->thread, NULL);
+		feedServerFree(server);
+	}
+	free(ctx->changeFeed.slots);
+	memset(&ctx->changeFeed, 0, sizeof(ctx->changeFeed));
+}
+
+
+// --------------------------------------------------------------
+// Shared-Memory Replica
+// --------------------------------------------------------------
+
+struct ReplicaWriter {
+	char *name;              // shared-memory object name
+	int fd;
+	char *base;              // our read-write mapping of the whole segment
+	size_t size;
+};
+
+
+static ReplicaOwner *replicaRecord(PokedexContext *ctx, const ReplicaHeader *header, uint32_t handle) {
+	return (ReplicaOwner *)(ctx->sharedReplica->base + header->ownersOffset + (size_t)handle * header->ownerStride);
+}
+
+
+static size_t replicaAlign(size_t offset) {
+	return (offset + 63) & ~(size_t)63;
+}
+
+
+// A record's sequence is odd from replicaRecordBegin to replicaRecordEnd.
+static void replicaRecordBegin(ReplicaOwner *record) {
+	__atomic_store_n(&record->sequence, record->sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+
+static void replicaRecordEnd(ReplicaHeader *header, ReplicaOwner *record) {
+	__atomic_store_n(&record->sequence, record->sequence + 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&header->updates, header->updates + 1, __ATOMIC_RELAXED);
+}
+
+
+// Where owner's name is in the segment: the record's copy if it still
+// matches, else a new one at the end of the names area (which must fit).
+static uint64_t replicaName(PokedexContext *ctx, ReplicaHeader *header, const ReplicaOwner *record, const OwnerNode *owner) {
+	char *base = ctx->sharedReplica->base;
+	if (record->nameOffset && record->nameLength == owner->nameLength
+		&& memcmp(base + record->nameOffset, owner->ownerName, owner->nameLength) == 0)
+		return record->nameOffset;
+	uint64_t offset = header->namesOffset + header->namesUsed;
+	memcpy(base + offset, owner->ownerName, owner->nameLength);
+	__atomic_store_n(&header->namesUsed, header->namesUsed + owner->nameLength, __ATOMIC_RELAXED);
+	return offset;
+}
+
+
+static void replicaWriteOwner(PokedexContext *ctx, ReplicaHeader *header, const OwnerNode *owner) {
+	ReplicaOwner *record = replicaRecord(ctx, header, owner->handle);
+	int live = owner->next != NO_OWNER;
+	// an owner out of the ring keeps its old name; nobody reads it
+	uint64_t nameOffset = live ? replicaName(ctx, header, record, owner) : record->nameOffset;
+	replicaRecordBegin(record);
+	__atomic_store_n(&record->live, (uint32_t)live, __ATOMIC_RELAXED);
+	if (live) __atomic_store_n(&record->nameLength, owner->nameLength, __ATOMIC_RELAXED);
+	__atomic_store_n(&record->nameOffset, nameOffset, __ATOMIC_RELAXED);
+	__atomic_store_n(&record->pokemonCount, (uint32_t)owner->stats.pokemonCount, __ATOMIC_RELAXED);
+	// the record is by catalog index, the owner's own bitmap by score rank
+	for (int w = 0; w < catalog.wordCount; w++) __atomic_store_n(&record->species[w], 0, __ATOMIC_RELAXED);
+	// an owner out of the ring keeps its Pokedex for undo but owns nothing
+	const Pokedex *dex = &owner->pokedex;
+	for (int i = 0; live && i < dex->length; i++) {
+		int index = dex->slots[i];
+		if (index == SPECIES_TOMBSTONE) continue;
+		uint64_t word = record->species[index / 64] | 1ULL << (index % 64);
+		__atomic_store_n(&record->species[index / 64], word, __ATOMIC_RELAXED);
+	}
+	replicaRecordEnd(header, record);
+}
+
+
+// Size the segment for owners records and names bytes, then rewrite all of
+// it from the live owners. Readers wait while the layout number is odd and
+// start over if it changed under them. Returns 0 with errno set on failure.
+static int replicaLayout(PokedexContext *ctx, uint32_t owners, uint64_t names) {
+	struct ReplicaWriter *w = ctx->sharedReplica;
+	size_t speciesNames = 0;
+	for (int i = 0; i < catalog.count; i++) speciesNames += strlen(catalog.species[i].name);
+	size_t stride = sizeof(ReplicaOwner) + catalog.wordCount * sizeof(uint64_t);
+	size_t speciesOffset = replicaAlign(sizeof(ReplicaHeader));
+	size_t ownersOffset = replicaAlign(speciesOffset + catalog.count * sizeof(ReplicaSpecies) + speciesNames);
+	size_t namesOffset = replicaAlign(ownersOffset + (size_t)owners * stride);
+	// never shorter than before: a reader may still have the old size mapped
+	if (w->base && namesOffset + names < w->size) names = w->size - namesOffset;
+	size_t size = namesOffset + names;
+	ReplicaHeader *header = (ReplicaHeader *)w->base;
+	uint32_t layout = header ? header->layout + 1 : 1;
+	if (header) {
+		__atomic_store_n(&header->layout, layout, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+	}
+	// the segment only ever grows, so a reader's older, shorter mapping stays
+	// valid; shrinking it would SIGBUS a reader touching the old tail
+	char *base = MAP_FAILED;
+	if (ftruncate(w->fd, (off_t)size) == 0)
+		base = w->base ? mremap(w->base, w->size, size, MREMAP_MAYMOVE)
+			: mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, w->fd, 0);
+	if (base == MAP_FAILED) {
+		int error = errno;
+		if (header) __atomic_store_n(&header->layout, layout + 1, __ATOMIC_RELEASE);
+		errno = error;
+		return 0;
+	}
+	w->base = base;
+	w->size = size;
+	header = (ReplicaHeader *)base;
+	__atomic_store_n(&header->layout, layout, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memset(base + sizeof(ReplicaHeader), 0, size - sizeof(ReplicaHeader));
+	header->magic = REPLICA_MAGIC;
+	header->version = REPLICA_VERSION;
+	header->size = size;
+	header->speciesCount = (uint32_t)catalog.count;
+	header->speciesOffset = speciesOffset;
+	header->ownersOffset = ownersOffset;
+	header->ownerCapacity = owners;
+	header->ownerStride = (uint32_t)stride;
+	header->wordCount = (uint32_t)catalog.wordCount;
+	header->namesOffset = namesOffset;
+	header->namesCapacity = names;
+	header->namesUsed = 0;
+	ReplicaSpecies *species = (ReplicaSpecies *)(base + speciesOffset);
+	size_t text = speciesOffset + catalog.count * sizeof(ReplicaSpecies);
+	for (int i = 0; i < catalog.count; i++) {
+		size_t len = strlen(catalog.species[i].name);
+		species[i].id = catalog.species[i].id;
+		species[i].nameLength = (uint32_t)len;
+		species[i].nameOffset = text;
+		memcpy(base + text, catalog.species[i].name, len);
+		text += len;
+	}
+	for (uint32_t handle = 0; handle < ctx->registry.nextHandle; handle++) {
+		const OwnerNode *owner = ownerByHandle(ctx, handle);
+		if (owner) replicaWriteOwner(ctx, header, owner);
+	}
+	__atomic_store_n(&header->layout, layout + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+
+// Record and name capacity for the live owners plus handle and nameBytes
+// more, with room to spare, as powers of two.
+static void replicaCapacity(PokedexContext *ctx, uint32_t handle, uint32_t nameBytes, uint32_t *owners, uint64_t *names) {
+	uint64_t used = nameBytes;
+	const OwnerNode *owner = ctx->ownerHead;
+	if (owner) do {
+		used += owner->nameLength;
+		owner = nextOwner(ctx, owner);
+	} while (owner != ctx->ownerHead);
+	*owners = REPLICA_MIN_OWNERS;
+	while (*owners <= handle || *owners < 2 * ctx->registry.nextHandle) *owners *= 2;
+	*names = REPLICA_MIN_NAMES;
+	while (*names < 2 * used) *names *= 2;
+}
+
+
+static void replicaFree(struct ReplicaWriter *w) {
+	if (w->base) munmap(w->base, w->size);
+	if (w->fd >= 0) {
+		close(w->fd);
+		shm_unlink(w->name);
+	}
+	free(w->name);
+	free(w);
+}
+
+
+// The header, after making room for owner handle and nameBytes more name
+// bytes; NULL if the segment could not grow, in which case it is removed
+// rather than left behind to go stale.
+static ReplicaHeader *replicaReserve(PokedexContext *ctx, uint32_t handle, uint32_t nameBytes) {
+	ReplicaHeader *header = (ReplicaHeader *)ctx->sharedReplica->base;
+	if (handle < header->ownerCapacity && header->namesUsed + nameBytes <= header->namesCapacity) return header;
+	uint32_t owners;
+	uint64_t names;
+	replicaCapacity(ctx, handle, nameBytes, &owners, &names);
+	if (owners < header->ownerCapacity) owners = header->ownerCapacity;
+	if (names < header->namesCapacity) names = header->namesCapacity;
+	if (replicaLayout(ctx, owners, names)) return (ReplicaHeader *)ctx->sharedReplica->base;
+	replicaFree(ctx->sharedReplica);
+	ctx->sharedReplica = NULL;
+	return NULL;
+}
+
+
+void replicaOwner(PokedexContext *ctx, const OwnerNode *owner) {
+	if (!ctx->sharedReplica) return;
+	ReplicaHeader *header = replicaReserve(ctx, owner->handle, owner->nameLength);
+	if (header) replicaWriteOwner(ctx, header, owner);
+}
+
+
+void replicaSpecies(PokedexContext *ctx, const OwnerNode *owner, int index, int owned) {
+	if (!ctx->sharedReplica) return;
+	ReplicaHeader *header = replicaReserve(ctx, owner->handle, 0);
+	if (!header) return;
+	ReplicaOwner *record = replicaRecord(ctx, header, owner->handle);
+	uint64_t word = record->species[index / 64];
+	if (owned) word |= 1ULL << (index % 64);
+	else word &= ~(1ULL << (index % 64));
+	replicaRecordBegin(record);
+	__atomic_store_n(&record->species[index / 64], word, __ATOMIC_RELAXED);
+	__atomic_store_n(&record->pokemonCount, (uint32_t)owner->stats.pokemonCount, __ATOMIC_RELAXED);
+	replicaRecordEnd(header, record);
+}
+
+
+PokedexStatus pkReplicaOpen(PokedexContext *ctx, const char *name) {
+	PokedexStatus status = PK_OK;
+	struct ReplicaWriter *w = NULL;
+	if (ctx->sharedReplica) status = PK_INVALID;
+	else if (!(w = (struct ReplicaWriter *)calloc(1, sizeof(struct ReplicaWriter))) || !(w->name = myStrdup(name))) {
+		free(w);
+		status = PK_NO_MEMORY;
+	} else if ((w->fd = shm_open(name, O_CREAT | O_TRUNC | O_RDWR | O_CLOEXEC, 0644)) < 0) {
+		int error = errno;
+		free(w->name);
+		free(w);
+		errno = error;
+		status = PK_IO_ERROR;
+	} else {
+		ctx->sharedReplica = w;
+		uint32_t owners;
+		uint64_t names;
+		replicaCapacity(ctx, 0, 0, &owners, &names);
+		if (!replicaLayout(ctx, owners, names)) {
+			int error = errno;
+			replicaFree(w);
+			ctx->sharedReplica = NULL;
+			errno = error;
+			status = PK_IO_ERROR;
+		}
+	}
+	return status;
+}
+
+
+void replicaClose(PokedexContext *ctx) {
+	if (ctx->sharedReplica) replicaFree(ctx->sharedReplica);
+	ctx->sharedReplica = NULL;
+}
@@ -0,0 +1,1483 @@
+#ifndef POKEDEX_H
+#define POKEDEX_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE  // qsort_r, mremap, pipe2, accept4 and fopencookie
+#endif
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+typedef enum
+{
+	GRASS,
+	FIRE,
+	WATER,
+	BUG,
+	NORMAL,
+	POISON,
+	ELECTRIC,
+	GROUND,
+	FAIRY,
+	FIGHTING,
+	PSYCHIC,
+	ROCK,
+	GHOST,
+	DRAGON,
+	ICE
+} PokemonType;
+
+#define TYPE_COUNT (ICE + 1)
+
+typedef enum
+{
+	CANNOT_EVOLVE,
+	CAN_EVOLVE
+} EvolutionStatus;
+
+typedef struct PokemonData
+{
+	int id;
+	char *name;
+	PokemonType TYPE;
+	int hp;
+	int attack;
+	EvolutionStatus CAN_EVOLVE;
+} PokemonData;
+
+// Binary Tree Node (for Pokédex)
+typedef struct PokemonNode
+{
+	const PokemonData *data;
+	struct PokemonNode *left;
+	struct PokemonNode *right;
+} PokemonNode;
+
+// Queue Node (for BFS)
+typedef struct QueueNode {
+    PokemonNode *pokemon;
+    struct QueueNode *next;
+} QueueNode;
+
+typedef struct {
+    QueueNode *front;
+    QueueNode *rear;
+} Queue;
+
+// Running totals for one owner, kept current by every mutation
+typedef struct
+{
+	int pokemonCount;
+	int typeCount[TYPE_COUNT];
+	long long totalScore10; // sum of fight scores, in tenths (attack*15 + hp*12)
+	int bestScore10;        // best fight score in tenths, -1 if the Pokedex is empty
+} OwnerStats;
+
+// Marks a released slot in a Pokedex; also caps the catalog at 65535 species
+#define SPECIES_TOMBSTONE 0xFFFF
+
+// One owner's Pokemon as catalog indices, in insertion order (see section 19)
+typedef struct
+{
+	uint16_t *slots; // species indices, SPECIES_TOMBSTONE where one was released
+	int length;      // slots in use, live or released
+	int capacity;    // slots allocated
+	int live;        // slots still holding a Pokemon
+} Pokedex;
+
+// One Pokemon an evolve-all pass changed (see section 6)
+typedef struct
+{
+	const PokemonData *from;
+	const PokemonData *to;   // NULL if it was released as a duplicate
+} EvolveChange;
+
+// Ring link value for an owner that is not in the ring
+#define NO_OWNER UINT32_MAX
+
+// Owner slots are allocated OWNER_CHUNK at a time and never move
+#define OWNER_CHUNK 1024
+#define OWNER_INLINE_NAME 24 // names shorter than this live in the owner record
+#define NAME_BLOCK (1 << 16)
+#define NAME_CLASS_MIN 32    // smallest arena slot; slots are powers of two up to NAME_BLOCK / 4
+#define NAME_CLASSES 10
+
+// One nonzero word of an owner's species set: ranks word * 64 .. word * 64 + 63
+typedef struct
+{
+	uint64_t bits;
+	uint32_t word;
+} SpeciesWord;
+
+// Owner record; lives in a registry slot, linked into the ring by handle
+typedef struct OwnerNode
+{
+	uint32_t nameHash;        // hashOwnerName of the name, compared before any bytes
+	uint32_t nameLength;      // strlen of the name
+	uint64_t nameKey;         // first 8 bytes, big-endian and zero-padded; orders like strcmp
+	char *ownerName;          // Owner's name: nameInline, or a copy in registry.names
+	char nameInline[OWNER_INLINE_NAME];
+	Pokedex pokedex;          // Owner's Pokemon, in insertion order
+	SpeciesWord *species;     // Owned species by score rank (catalog.scoreRank): nonzero words only, by word
+	uint32_t speciesCount;    // Words in species
+	uint32_t speciesCapacity;
+	uint32_t handle;          // Stable owner handle: the slot number, see OwnerRegistry
+	uint32_t prev;            // Handle of the previous owner in the ring, NO_OWNER if not linked
+	uint32_t next;            // Handle of the next owner in the ring, NO_OWNER if not linked
+	int inUse;                // Slot holds an owner (in the ring, or kept for undo)
+	OwnerStats stats;         // Materialized per-owner aggregates
+	uint32_t boardLeft;       // Trainer leaderboard treap children, NO_OWNER if none
+	uint32_t boardRight;
+	uint32_t boardSize;       // Owners in this treap subtree
+} OwnerNode;
+
+// Species catalog, loaded once at startup (see section 14)
+typedef struct
+{
+	PokemonData *species;          // all species, sorted by ID
+	int count;                     // number of entries in species
+	int lowestId;                  // smallest species ID in the catalog
+	int highestId;                 // largest species ID in the catalog
+	int *slotById;                 // (id - lowestId) -> index into species, -1 for gaps
+	int *nextStage;                // species index -> index of its evolution, -1 if none
+	int *finalStage;               // species index -> index of its last evolution (itself if none)
+	int typeStart[TYPE_COUNT + 1]; // byType[typeStart[t] .. typeStart[t+1]) holds type t
+	int *byType;                   // species indices grouped by type, ascending ID
+	char *namePool;                // every species name, NUL-separated, one allocation
+	int *byName;                   // species indices sorted by case-folded name (prefix index)
+	uint32_t nameBuckets;          // perfect hash: number of displacement buckets
+	uint32_t nameSlots;            // perfect hash: number of table slots
+	uint32_t *nameDisplace;        // perfect hash: (d0, d1) pair per bucket
+	int *nameSlot;                 // perfect hash: slot -> species index, -1 if empty
+	int *byScore;                  // species indices by fight score, best first, then by ID
+	int *scoreRank;                // species index -> position in byScore
+	int wordCount;                 // 64-bit words in a species bitmap
+	int columnLength;              // column length, count rounded up to SPECIES_BLOCK
+	int32_t *colId;                // columnar copy of the hot fields, for filter scans
+	uint8_t *colType;
+	int16_t *colHp;
+	int16_t *colAttack;
+	uint8_t *colEvolve;
+} Catalog;
+
+// Predicate over species stats; ranges are inclusive
+typedef struct
+{
+	uint16_t typeMask; // bit t set => type t matches; 0 => any type
+	int hpMin;
+	int hpMax;
+	int attackMin;
+	int attackMax;
+	int evolve;        // -1 any, CANNOT_EVOLVE or CAN_EVOLVE
+	uint64_t *ids;     // species picked by ID/range/name terms, NULL => no ID terms
+} SpeciesFilter;
+
+// Sorted set of owner handles
+typedef struct
+{
+	uint32_t *owners;
+	uint32_t count;
+	uint32_t capacity;
+} OwnerSet;
+
+// Storage for owner names too long to keep inline. Slots are carved from
+// NAME_BLOCK blocks in power-of-two sizes; a freed slot goes on the list
+// for its size and is reused before the block grows. Blocks are freed as a whole.
+typedef struct
+{
+	char **blocks;
+	int count;
+	size_t used;             // bytes taken in the last block
+	size_t capacity;         // size of the last block
+	char *freeSlots[NAME_CLASSES]; // by size class; each free slot starts with the next one's address
+} NameArena;
+
+// Owner handles and the species -> owners index (see section 16)
+typedef struct
+{
+	OwnerNode **chunks;      // owner slots, OWNER_CHUNK per chunk; handle h is slot h
+	uint32_t chunkCount;
+	uint32_t nextHandle;     // first never-used slot
+	uint32_t *freeHandles;   // released slots, reused first
+	uint32_t freeCount;
+	OwnerSet *speciesOwners; // catalog index -> owners holding that species
+	NameArena names;         // long owner names (see section 22)
+	uint64_t *coveredByRank; // bit r set => species byScore[r] is owned by someone
+	uint32_t boardRoot;      // trainer leaderboard treap root, NO_OWNER if empty (section 23)
+} OwnerRegistry;
+
+// Running totals over all owners
+typedef struct
+{
+	int ownerCount;
+	long long pokemonCount;
+	long long typeCount[TYPE_COUNT];
+	long long totalScore10;
+	int bestSpecies;     // catalog index of the best-scoring owned species, -1 if none
+	int speciesCovered;  // species held by at least one owner
+} GlobalStats;
+
+// Commands kept for undo (see section 20)
+#define UNDO_DEPTH 32
+
+typedef enum
+{
+	CHANGE_POKEDEX, // an owner's Pokedex was replaced
+	CHANGE_OWNER,   // an owner joined or left the ring
+	CHANGE_ORDER    // the ring was reordered
+} ChangeKind;
+
+// One reversible step of a command; applying it again flips it back
+typedef struct
+{
+	ChangeKind kind;
+	uint32_t handle;     // POKEDEX, OWNER: the owner concerned
+	Pokedex other;       // POKEDEX: the version not installed right now
+	int present;         // OWNER: 1 while the owner is in the ring, else the change owns it
+	uint32_t prevHandle; // OWNER: ring neighbour to go back after (its own handle if it was alone)
+	int wasHead;         // OWNER: it was ownerHead when it left
+	uint32_t *order;     // ORDER: handles from ownerHead, the order not installed right now,
+	                     //        followed by orderCount entries of scratch
+	int orderCount;
+} Change;
+
+// Everything one menu action changed
+typedef struct
+{
+	const char *label;
+	Change *changes;
+	int count;
+	int capacity;
+} UndoCommand;
+
+typedef struct
+{
+	UndoCommand commands[UNDO_DEPTH];
+	int count;           // commands kept, oldest first
+	int done;            // commands[0 .. done) are applied, the rest can be redone
+	UndoCommand pending; // command being recorded
+	int recording;       // between undoBegin and undoEnd
+	int failed;          // an allocation failed while recording
+} UndoJournal;
+
+// How one checkpoint went, as handed to Checkpointer.onResult
+typedef struct
+{
+	int started;         // 0 if the writer could not even be started
+	int ok;              // the file is in place
+	int error;           // errno of the failed call, 0 if the writer died
+	int number;
+	const char *path;
+	long owners;
+	long pokemon;
+	double pauseSeconds; // how long the capture (fork) held the caller
+	double writeSeconds; // time the writer spent serializing
+	double doneAfter;    // seconds from capture until the file was in place
+	int changesBehind;   // changed commands since the capture
+} CheckpointResult;
+
+// Background snapshot writer state (see section 21)
+typedef struct
+{
+	const char *path;    // snapshot file, NULL when checkpointing is off
+	int everySeconds;    // checkpoint when this old and something changed, 0 = never
+	int everyChanges;    // checkpoint after this many changed commands, 0 = never
+	int changes;         // changed commands since the last capture
+	int number;          // checkpoints started so far
+	double lastAt;       // monotonic seconds of the last capture
+	pid_t writer;        // child writing the current snapshot, 0 if none
+	int reportFd;        // read end of the writer's report pipe
+	double forkSeconds;  // how long the capture (fork) held the caller
+	void (*onResult)(const CheckpointResult *result, void *arg);  // told how each one went, may be NULL
+	void *resultArg;
+} Checkpointer;
+
+// Change feed events (see section 30). Each one is a 64-byte record, laid
+// out the same in memory and on a feed socket (host byte order).
+#define FEED_TEXT 40
+
+typedef enum
+{
+	FEED_OVERFLOW = 1,       // the reader fell behind; a = events it lost (capped at 2^32 - 1)
+	FEED_OWNER_CREATED,      // owner joined the ring; a = name length, text = the first bytes of the name
+	FEED_NAME_MORE,          // text continues the name of the event before
+	FEED_OWNER_DELETED,      // owner left the ring, Pokedex and all
+	FEED_OWNERS_MERGED,      // owner takes in owner a; its adds and a's deletion follow
+	FEED_POKEMON_ADDED,      // a = species ID
+	FEED_POKEMON_RELEASED,   // a = species ID
+	FEED_POKEMON_EVOLVED,    // a = old species ID, b = new species ID
+	FEED_OWNERS_SORTED,      // the ring is now in name order
+	FEED_OWNERS_REORDERED    // undo or redo put back another ring order
+} FeedEventKind;
+
+typedef struct
+{
+	uint64_t sequence;       // 1, 2, 3, ... per context; 0 on an overflow marker
+	uint8_t kind;            // FeedEventKind
+	uint8_t length;          // bytes of text used
+	uint16_t reserved;
+	uint32_t owner;          // owner handle, as the library calls use
+	uint32_t a;
+	uint32_t b;
+	char text[FEED_TEXT];
+} FeedEvent;
+
+// Ring storage; a slot is read and written a word at a time
+typedef struct
+{
+	uint64_t word[sizeof(FeedEvent) / sizeof(uint64_t)];
+} FeedSlot;
+
+// The last events published by one context. There is one writer, the
+// thread changing the context, and it never waits for readers: it
+// overwrites the oldest slot, and a reader that was still on it notices
+// by the slot's sequence number.
+typedef struct
+{
+	FeedSlot *slots;         // NULL while the feed is off
+	uint64_t mask;           // slots - 1
+	uint64_t published;      // sequence of the newest complete event
+	int sleeping;            // the feed server is waiting on wakeFd
+	int wakeFd;              // write end of the server's wake-up pipe, while there is a server
+	struct FeedServer *server;
+} ChangeFeed;
+
+// One independent Pokedex: owners, indexes, totals, undo history and
+// checkpoint settings (see section 26). The species catalog is shared.
+typedef struct PokedexContext
+{
+	OwnerNode *ownerHead;   // head of the circular list of owners
+	GlobalStats summary;    // aggregates (see section 17)
+	OwnerRegistry registry; // owner slots, name arena and indexes
+	UndoJournal history;    // undo/redo history
+	Checkpointer checkpoint;
+	ChangeFeed changeFeed;  // mutation events, off until pkFeedOpen (section 30)
+	struct ReplicaWriter *sharedReplica;  // shared-memory copy, NULL until pkReplicaOpen (section 31)
+} PokedexContext;
+
+// Global species catalog, read-only once loaded and shared by every context
+extern Catalog catalog;
+
+/* ------------------------------------------------------------
+   1) Safe Input + Utility
+   ------------------------------------------------------------ */
+
+/**
+ * @brief C99-friendly strdup replacement.
+ * @param src source string
+ * @return newly allocated copy of src
+ * Why we made it: Some old systems lack strdup; we do it ourselves.
+ */
+char *myStrdup(const char *src);
+
+/**
+ * @brief Return a string for a given PokemonType enum.
+ * @param type the enum
+ * @return string like "GRASS", "FIRE", etc.
+ * Why we made it: So we can print readable type names.
+ */
+const char *getTypeName(PokemonType type);
+
+/**
+ * @brief write() all of data to fd, retrying short writes and EINTR.
+ * @return 1 on success, 0 on a write error (errno is set)
+ */
+int writeAll(int fd, const void *data, size_t len);
+
+/**
+ * @brief Seconds on the monotonic clock, for timing and intervals.
+ */
+double monotonicSeconds(void);
+
+/* ------------------------------------------------------------
+   2) Creating & Freeing Nodes
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Create a BST node with a copy of the given PokemonData.
+ * @param data pointer to PokemonData (like from the global pokedex)
+ * @return newly allocated PokemonNode*
+ * Why we made it: We need a standard way to allocate BST nodes.
+ */
+PokemonNode *createPokemonNode(const PokemonData *data);
+
+/**
+ * @brief Create an OwnerNode for the circular owners list.
+ * @param ownerName the name; it is copied, the caller keeps its string
+ * @param starter species of the starter Pokemon (may be NULL)
+ * @return newly allocated OwnerNode*
+ * Why we made it: Each user is represented as an OwnerNode.
+ */
+OwnerNode *createOwner(PokedexContext *ctx, const char *ownerName, const PokemonData *starter);
+
+/**
+ * @brief Free one PokemonNode (including name).
+ * @param node pointer to node
+ * Why we made it: Avoid memory leaks for single nodes.
+ */
+void freePokemonNode(PokemonNode *node);
+
+/**
+ * @brief Recursively free a BST of PokemonNodes.
+ * @param root BST root
+ * Why we made it: Clearing a user’s entire Pokedex means freeing a tree.
+ */
+void freePokemonTree(PokemonNode **root);
+
+/**
+ * @brief Free an OwnerNode: drop it from the indexes, free its Pokedex, release the slot.
+ * @param owner pointer to the owner
+ * Why we made it: Deleting an owner also frees their Pokedex & name.
+ */
+void freeOwnerNode(PokedexContext *ctx, OwnerNode *owner);
+
+/* ------------------------------------------------------------
+   3) BST Insert, Search, Remove
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Insert a PokemonNode into BST by ID; duplicates freed.
+ * @param root pointer to BST root
+ * @param newNode node to insert
+ * @return updated BST root
+ * Why we made it: Standard BST insertion ignoring duplicates.
+ */
+void insertPokemonNode(PokemonNode **root, PokemonNode *newNode);
+
+/** */
+void initQueue(Queue *q);
+/** */
+void enqueue(Queue *q, PokemonNode *p);
+/** */
+PokemonNode *dequeue(Queue *q);
+/** */
+void freeQueue(Queue *q);
+
+/**
+ * @brief BFS search for a Pokemon by ID in the BST.
+ * @param root BST root
+ * @param id ID to find
+ * @return pointer to found node or NULL
+ * Why we made it: BFS ensures we find nodes even in an unbalanced tree.
+ */
+PokemonNode *searchPokemonBFS(PokemonNode *root, int id);
+
+/**
+ * @brief Remove node from BST by ID if found (BST removal logic).
+ * @param root BST root
+ * @param id ID to remove
+ * @return updated BST root
+ * Why we made it: We handle special cases of a BST remove (0,1,2 children).
+ */
+PokemonNode *removeNodeBST(PokemonNode *root, int id);
+
+/**
+ * @brief Combine BFS search + BST removal to remove Pokemon by ID.
+ * @param root BST root
+ * @param id the ID to remove
+ * @return updated BST root
+ * Why we made it: BFS confirms existence, then removeNodeBST does the removal.
+ */
+PokemonNode *removePokemonByID(PokemonNode *root, int id);
+
+/* ------------------------------------------------------------
+   4) Generic BST Traversals (Function Pointers)
+   ------------------------------------------------------------ */
+
+// Please notice, it's not really generic, it's just a demonstration of function pointers.
+// so don't be confused by the name, but please remember that you must use it.
+
+typedef void (*VisitNodeFunc)(PokemonNode *);
+
+// Visitor with caller context; return 0 to stop the traversal early.
+typedef int (*VisitNodeCtxFunc)(PokemonNode *, void *ctx);
+
+typedef enum
+{
+	ORDER_BFS,
+	ORDER_PRE,
+	ORDER_IN,
+	ORDER_POST
+} TraversalOrder;
+
+#define TREE_ITER_INLINE 32
+
+// Non-recursive traversal state: a stack (pre/in/post) or ring queue (BFS).
+// Small trees use the inline buffer; deeper ones spill to the heap.
+typedef struct
+{
+	TraversalOrder order;
+	PokemonNode **items;
+	int head;                  // BFS: index of the queue front
+	int count;                 // entries on the stack / in the queue
+	int capacity;
+	PokemonNode *cursor;       // in/post-order: next subtree to descend
+	PokemonNode *lastVisited;  // post-order: last node returned
+	int failed;                // a push ran out of memory; the traversal stopped there
+	PokemonNode *inlineItems[TREE_ITER_INLINE];
+} TreeIter;
+
+/**
+ * @brief Start a traversal of the tree in the given order.
+ * @param it iterator to initialize (release with treeIterFree)
+ * @param root BST root, may be NULL
+ * @param order BFS, pre-, in- or post-order
+ * Why we made it: No recursion, so degenerate (list-shaped) trees cannot blow the stack.
+ */
+void treeIterInit(TreeIter *it, PokemonNode *root, TraversalOrder order);
+
+/**
+ * @brief Next node in traversal order.
+ * @return the node, or NULL when the traversal is done or it->failed is set
+ */
+PokemonNode *treeIterNext(TreeIter *it);
+
+/**
+ * @brief Fill out[] with up to max next nodes.
+ * @return number of nodes written (0 when done), or -1 if the iterator ran
+ *   out of memory and the rest of the traversal is lost
+ */
+int treeIterNextBatch(TreeIter *it, PokemonNode **out, int max);
+
+/**
+ * @brief Release any heap memory the iterator grew into.
+ */
+void treeIterFree(TreeIter *it);
+
+/**
+ * @brief Visit every node in order with a context pointer, stopping when visit returns 0.
+ * @return 1 if every node was visited, 0 if visit stopped early,
+ *   -1 if the iterator ran out of memory
+ */
+int traverseTree(PokemonNode *root, TraversalOrder order, VisitNodeCtxFunc visit, void *ctx);
+
+/**
+ * @brief Generic BFS traversal: call visit() on each node (level-order).
+ * @param root BST root
+ * @param visit function pointer for what to do with each node
+ * @return 1, or 0 if the traversal ran out of memory
+ * Why we made it: BFS plus function pointers => flexible traversal.
+ */
+int BFSGeneric(PokemonNode *root, VisitNodeFunc visit);
+
+/**
+ * @brief A generic pre-order traversal (Root-Left-Right).
+ * @param root BST root
+ * @param visit function pointer
+ * @return 1, or 0 if the traversal ran out of memory
+ * Why we made it: Another demonstration of function-pointer-based traversal.
+ */
+int preOrderGeneric(PokemonNode *root, VisitNodeFunc visit);
+
+/**
+ * @brief A generic in-order traversal (Left-Root-Right).
+ * @param root BST root
+ * @param visit function pointer
+ * @return 1, or 0 if the traversal ran out of memory
+ * Why we made it: Great for seeing sorted order if BST is sorted by ID.
+ */
+int inOrderGeneric(PokemonNode *root, VisitNodeFunc visit);
+
+/**
+ * @brief A generic post-order traversal (Left-Right-Root).
+ * @param root BST root
+ * @param visit function pointer
+ * @return 1, or 0 if the traversal ran out of memory
+ * Why we made it: Another standard traversal pattern.
+ */
+int postOrderGeneric(PokemonNode *root, VisitNodeFunc visit);
+
+/* ------------------------------------------------------------
+   6) Pokemon-Specific
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Evolve every eligible Pokemon in one pass over the Pokedex.
+ * @param owner pointer to the Owner
+ * @param toFinal nonzero to jump straight to the final form instead of one stage
+ * @param changes out: one entry per evolved/released Pokemon, ended by a NULL
+ *   from; needs room for pokedex.live + 1 entries (may be NULL)
+ * @param released out: how many duplicates were released (may be NULL)
+ * @return number of Pokemon that evolved, or -1 (nothing changed) if memory ran out
+ * Why we made it: One evolution per prompt is too slow for big Pokedexes.
+ *   When two Pokemon end up as the same species, the one earlier in insertion
+ *   order keeps it and the later one is released.
+ */
+int evolveAllInPokedex(PokedexContext *ctx, OwnerNode *owner, int toFinal, EvolveChange *changes, int *released);
+
+/**
+ * @brief Release every Pokemon whose species is set in mask, in one pass.
+ * @param owner pointer to the Owner
+ * @param mask species bitmap (catalog.wordCount words)
+ * @param released out: catalog index of each released Pokemon, in Pokedex
+ *   order; needs room for pokedex.live entries
+ * @return number of Pokemon released
+ * Why we made it: Clearing a range or a type one ID at a time takes dozens of prompts.
+ *   Survivors are slid down over the matches in a single pass, which also
+ *   drops any tombstones left by earlier releases.
+ */
+int releaseMatching(PokedexContext *ctx, OwnerNode *owner, const uint64_t *mask, uint16_t *released);
+
+/* ------------------------------------------------------------
+   9) Circular List Linking & Searching
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Insert a new owner into the circular list. If none exist, it's alone.
+ * @param newOwner pointer to newly created OwnerNode
+ * Why we made it: We need a standard approach to keep the list circular.
+ */
+void linkOwnerInCircularList(PokedexContext *ctx, OwnerNode *newOwner);
+
+/**
+ * @brief Remove a specific OwnerNode from the circular list, possibly updating head.
+ * @param target pointer to the OwnerNode
+ * Why we made it: Deleting or merging owners requires removing them from the ring.
+ */
+void removeOwnerFromCircularList(PokedexContext *ctx, OwnerNode *target);
+
+/**
+ * @brief Next owner in the ring (following the next handle).
+ */
+OwnerNode *nextOwner(PokedexContext *ctx, const OwnerNode *owner);
+
+/**
+ * @brief Previous owner in the ring (following the prev handle).
+ */
+OwnerNode *prevOwner(PokedexContext *ctx, const OwnerNode *owner);
+
+/**
+ * @brief Find an owner by name in the circular list.
+ * @param name string to match
+ * @return pointer to the matching OwnerNode or NULL
+ * Why we made it: We often need to locate an owner quickly.
+ */
+OwnerNode *findOwnerByName(PokedexContext *ctx, const char *name);
+
+/**
+ * @brief Number of owners in the ring.
+ */
+int ringLength(PokedexContext *ctx);
+
+/**
+ * @brief Write count handles into order, in ring order from ownerHead.
+ * Why we made it: Sorting, dumping and exporting all work on a plain array
+ *   of handles rather than chasing links while they run.
+ */
+void readRingOrder(PokedexContext *ctx, uint32_t *order, int count);
+
+/* ------------------------------------------------------------
+   12) Cleanup All Owners at Program End
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Frees every remaining owner in the circular list, setting ownerHead = NULL.
+ * Why we made it: Ensures a squeaky-clean exit with no leftover memory.
+ * Only the Pokedex arrays are freed one by one. Indexes and totals are
+ * cleared in bulk rather than per Pokemon, and freeRegistry releases the
+ * slot chunks.
+ */
+void freeAllOwners(PokedexContext *ctx);
+
+/* ------------------------------------------------------------
+   14) Species Catalog
+   ------------------------------------------------------------ */
+
+#define CATALOG_ERROR (4096 + 256)  // room for a loadCatalog message naming a long path
+
+/**
+ * @brief Load the species catalog from a file, or the built-in table.
+ * @param path catalog file (id,name,type,hp,attack,evolves_to per line), or NULL
+ * @param error out: on failure, why, as one line with no newline (may be NULL)
+ * @param errorSize bytes at error; longer messages are cut
+ * @return 1 on success, 0 on failure
+ * Why we made it: The catalog changes more often than the code; we mmap the file,
+ *   parse it in one pass and derive ID bounds, evolutions and type tables from it.
+ */
+int loadCatalog(const char *path, char *error, size_t errorSize);
+
+/**
+ * @brief Release everything owned by the global catalog.
+ */
+void freeCatalog(void);
+
+/**
+ * @brief Look up a species by ID.
+ * @param id species ID
+ * @return pointer into the catalog, or NULL if the ID is not in the catalog
+ * Why we made it: IDs may be sparse, so bounds alone do not make an ID valid.
+ */
+const PokemonData *speciesById(int id);
+
+/**
+ * @brief Return the next evolution stage of a species.
+ * @param data species from the catalog
+ * @return the evolved species, or NULL if it cannot evolve
+ */
+const PokemonData *evolutionOf(const PokemonData *data);
+
+/**
+ * @brief Look up a species by name, ignoring case.
+ * @param name start of the name (need not be NUL-terminated)
+ * @param len length of the name
+ * @return pointer into the catalog, or NULL if no species has that name
+ * Why we made it: One perfect-hash probe and one compare, no allocation.
+ */
+const PokemonData *speciesByName(const char *name, size_t len);
+
+/**
+ * @brief Find the species whose name starts with prefix.
+ * @param prefix case-insensitive name prefix
+ * @param first out: position of the first match in catalog.byName
+ * @return number of matches; they are catalog.byName[first .. first + count)
+ * Why we made it: Autocomplete for clients typing species names. The
+ *   matches are adjacent in name order, so one binary search finds them.
+ */
+int speciesByPrefix(const char *prefix, int *first);
+
+/**
+ * @brief Parse a type name ("FIRE", "water", ...) into a PokemonType.
+ * @param name start of the name (need not be NUL-terminated)
+ * @param len length of the name
+ * @return the type, or -1 if the name is unknown
+ */
+int typeFromName(const char *name, size_t len);
+
+/* ------------------------------------------------------------
+   15) Species Membership & Filter Queries
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Record that owner now holds a Pokemon of this species.
+ * @param owner pointer to the Owner
+ * @param data species from the catalog
+ * @return 1 on success, 0 (nothing recorded) if memory ran out
+ * Why we made it: Every path that links a Pokemon into a Pokedex reports here,
+ *   so the per-owner indexes never need a list walk.
+ */
+int notePokemonAdded(PokedexContext *ctx, OwnerNode *owner, const PokemonData *data);
+
+/**
+ * @brief Make room so notePokemonAdded cannot fail for any of these species.
+ * @param owner pointer to the Owner
+ * @param species species about to be added; NULL entries are skipped
+ * @param count number of entries in species
+ * @return 1 on success, 0 if memory ran out
+ * Why we made it: A change that adds several Pokemon at once has to either
+ *   finish or leave the owner as it was, so it allocates before touching anything.
+ */
+int notePokemonReserve(PokedexContext *ctx, OwnerNode *owner, const PokemonData *const *species, int count);
+
+/**
+ * @brief Record that owner no longer holds a Pokemon of this species.
+ * @param owner pointer to the Owner
+ * @param data species from the catalog
+ */
+void notePokemonRemoved(PokedexContext *ctx, OwnerNode *owner, const PokemonData *data);
+
+/**
+ * @brief Check the owner's species set.
+ * @return nonzero if the owner has a Pokemon of this species
+ */
+int ownerHasSpecies(const OwnerNode *owner, const PokemonData *data);
+
+/**
+ * @brief Score rank of the owner's strongest species, or -1 if it has none.
+ * Why we made it: Owner species sets are kept in score order, so releasing
+ *   the best Pokemon finds the next best in its first word.
+ */
+int ownerFirstRank(const OwnerNode *owner);
+
+/**
+ * @brief Parse "FIRE attack>90 hp<=100 evolve=yes 100-151 1,4,7 pikachu" style filters.
+ * @param text filter text; term kinds are AND-ed, several types or IDs are OR-ed
+ * @param filter output, release with freeSpeciesFilter
+ * @param bad out: on failure, where the bad term starts in text; it runs
+ *   to the next blank (may be NULL)
+ * @return 1 on success, 0 on a bad term
+ */
+int parseSpeciesFilter(const char *text, SpeciesFilter *filter, const char **bad);
+
+/**
+ * @brief Free what parseSpeciesFilter allocated.
+ */
+void freeSpeciesFilter(SpeciesFilter *filter);
+
+/**
+ * @brief Evaluate a filter over the columnar catalog (SIMD when available).
+ * @param filter the predicate
+ * @param mask output bitmap of catalog.wordCount words
+ * @return number of matching species
+ */
+int evaluateSpeciesFilter(const SpeciesFilter *filter, uint64_t *mask);
+
+/* ------------------------------------------------------------
+   16) Owner Handles & Species -> Owners Index
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Allocate the per-species owner sets once the catalog is loaded.
+ * @return 1 on success, 0 on allocation failure
+ */
+int initRegistry(PokedexContext *ctx);
+
+/**
+ * @brief Free the registry tables (owners must already be gone).
+ */
+void freeRegistry(PokedexContext *ctx);
+
+/**
+ * @brief Take a free owner slot, zeroed, with its handle set and not linked.
+ * @return the owner, or NULL on allocation failure
+ * Why we made it: Indexes store 32-bit handles, not pointers, and owners
+ *   sit side by side in chunks instead of one malloc each, so sweeping
+ *   every owner is a sequential read.
+ */
+OwnerNode *registerOwner(PokedexContext *ctx);
+
+/**
+ * @brief Clear an owner's slot and put it on the free list.
+ */
+void unregisterOwner(PokedexContext *ctx, OwnerNode *owner);
+
+/**
+ * @brief Owner for a handle, or NULL.
+ */
+OwnerNode *ownerByHandle(PokedexContext *ctx, uint32_t handle);
+
+/**
+ * @brief Owners holding a species, as a sorted handle set.
+ */
+const OwnerSet *ownersOfSpecies(PokedexContext *ctx, const PokemonData *data);
+
+/* ------------------------------------------------------------
+   17) Materialized Statistics
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Fight score of a species in tenths (attack*1.5 + hp*1.2, times 10).
+ * Why we made it: Integer tenths add and subtract exactly in running totals.
+ */
+int fightScore10(const PokemonData *data);
+
+/* ------------------------------------------------------------
+   19) Pokedex Storage
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Append a species at the end of the insertion order.
+ * @return 1 on success, 0 if the slots could not grow
+ * Why we made it: A Pokemon costs 2 bytes in one array instead of a 24-byte
+ *   malloc'd node with two links, and a full scan is a straight read.
+ */
+int pokedexAppend(Pokedex *dex, const PokemonData *data);
+
+/**
+ * @brief Make room for extra more appends without reallocating.
+ * @return 1 on success, 0 if the slots could not grow
+ * Why we made it: A merge allocates everything before it changes the
+ *   destination, so running out of memory halfway cannot lose Pokemon.
+ */
+int pokedexReserve(Pokedex *dex, int extra);
+
+/**
+ * @brief Position of a species in the slots, or -1 if it is not there.
+ */
+int pokedexFind(const Pokedex *dex, const PokemonData *data);
+
+/**
+ * @brief Release the Pokemon at pos by leaving a tombstone.
+ * Why we made it: O(1) removal; later slots keep their positions, so loops
+ *   over the slots stay valid while they remove.
+ */
+void pokedexRemoveAt(Pokedex *dex, int pos);
+
+/**
+ * @brief Squeeze out tombstones once they outnumber the live slots.
+ * Why we made it: Bounds the dead space to half the array; order is kept.
+ */
+void pokedexCompactIfSparse(Pokedex *dex);
+
+/**
+ * @brief Build a temporary BST of new nodes, inserted in Pokedex order.
+ * @return BST root, or NULL if the Pokedex is empty or allocation fails
+ * Why we made it: Display and merge keep the BST order semantics the
+ *   circular list gave; the caller frees the tree with freePokedexTree.
+ *   All nodes come from one block, and the root is its first node.
+ */
+PokemonNode *pokedexToTree(const Pokedex *dex);
+
+/**
+ * @brief Free a tree built by pokedexToTree in one call.
+ */
+void freePokedexTree(PokemonNode **root);
+
+/**
+ * @brief Free the slots and reset the Pokedex to empty.
+ */
+void pokedexFree(Pokedex *dex);
+
+/* ------------------------------------------------------------
+   20) Undo / Redo
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Start recording one menu action under label.
+ * Why we made it: A wrong release or merge used to be permanent.
+ *   Commands keep only what they touched: the previous Pokedex of each
+ *   changed owner, owners that left the ring, or the old ring order.
+ *   Everything else is shared with the live state.
+ */
+void undoBegin(PokedexContext *ctx, const char *label);
+
+/**
+ * @brief Finish the command; it becomes the newest undo step if it changed anything.
+ *   Recording a new command drops whatever could have been redone.
+ */
+void undoEnd(PokedexContext *ctx);
+
+/**
+ * @brief Keep the owner's current Pokedex before the command changes it.
+ *   Only the first call per owner in a command copies anything.
+ */
+void undoSavePokedex(PokedexContext *ctx, OwnerNode *owner);
+
+/**
+ * @brief Note that the command linked a new owner into the ring.
+ */
+void undoOwnerCreated(PokedexContext *ctx, OwnerNode *owner);
+
+/**
+ * @brief Keep the current ring order before the command reorders it.
+ */
+void undoSaveOrder(PokedexContext *ctx);
+
+/**
+ * @brief Take an owner out of the ring for good, as delete and merge do.
+ * Why we made it: While recording, the owner is only detached (out of the
+ *   ring and the indexes, handle kept) so undo can put it back. Otherwise,
+ *   or once the undo step is dropped, it is freed.
+ */
+void retireOwner(PokedexContext *ctx, OwnerNode *owner);
+
+/**
+ * @brief Revert the newest applied command.
+ * @return the command's label, or NULL if there was nothing to undo
+ */
+const char *undoLast(PokedexContext *ctx);
+
+/**
+ * @brief Re-apply the newest undone command.
+ * @return the command's label, or NULL if there was nothing to redo
+ */
+const char *redoLast(PokedexContext *ctx);
+
+/**
+ * @brief Drop the whole history, freeing owners only it still held.
+ */
+void freeHistory(PokedexContext *ctx);
+
+/* ------------------------------------------------------------
+   21) Checkpoints
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Count one changed command toward the next checkpoint.
+ */
+void checkpointNoteChange(PokedexContext *ctx);
+
+/**
+ * @brief Reap a finished writer and report it; start a new one if due.
+ * Why we made it: Called between commands, so the menu never waits on disk.
+ */
+void checkpointPoll(PokedexContext *ctx);
+
+/**
+ * @brief Capture the current state and write it in a forked child.
+ * @return 1 if a writer was started
+ * Why we made it: fork() gives the child a copy-on-write view of the ring
+ *   as of this instant; the parent only pays for the fork and keeps taking
+ *   commands while the child serializes.
+ */
+int checkpointStart(PokedexContext *ctx);
+
+/**
+ * @brief Wait for a running writer, then write a final snapshot if anything changed.
+ */
+void checkpointFinish(PokedexContext *ctx);
+
+/**
+ * @brief Write every owner as "name,id,id,..." in ring and insertion order.
+ * @param fd open file descriptor
+ * @param owners out: owners written (may be NULL)
+ * @param pokemon out: Pokemon written (may be NULL)
+ * @return 1 on success, 0 on a write error
+ */
+int writeSnapshot(PokedexContext *ctx, int fd, long *owners, long *pokemon);
+
+/* ------------------------------------------------------------
+   22) Owner Names
+   ------------------------------------------------------------ */
+
+/**
+ * @brief 32-bit FNV-1a hash of an owner name (case-sensitive).
+ */
+uint32_t hashOwnerName(const char *name, size_t len);
+
+/**
+ * @brief Store a copy of name in the owner with its length, hash and sort key.
+ * @return 1 on success, 0 on allocation failure
+ * Why we made it: Lookups and sorting read the record only. A short name is
+ *   inline, and a long one is in one arena block with its neighbours, not
+ *   somewhere random on the heap.
+ */
+int setOwnerName(PokedexContext *ctx, OwnerNode *owner, const char *name);
+
+/**
+ * @brief Give back the storage of an owner's long name (inline names have none).
+ * Why we made it: Owners come and go in a long-running -f or -r server;
+ *   their names must not pile up until exit.
+ */
+void releaseOwnerName(PokedexContext *ctx, OwnerNode *owner);
+
+/**
+ * @brief Order two owners by name, the same way strcmp would.
+ * Why we made it: The cached 8-byte key decides most pairs without
+ *   touching the name bytes.
+ */
+int compareOwnerNames(const OwnerNode *a, const OwnerNode *b);
+
+/**
+ * @brief Free every arena block at once (owners must already be gone).
+ */
+void freeOwnerNames(PokedexContext *ctx);
+
+/* ------------------------------------------------------------
+   23) Leaderboards
+   ------------------------------------------------------------ */
+
+/**
+ * @brief Take an owner off the trainer leaderboard before its score changes.
+ * Why we made it: The stats hooks keep the board current, so reading it
+ *   never scans the owners.
+ */
+void leaderboardRemove(PokedexContext *ctx, OwnerNode *owner);
+
+/**
+ * @brief Put an owner with at least one Pokemon back on the trainer leaderboard.
+ */
+void leaderboardInsert(PokedexContext *ctx, OwnerNode *owner);
+
+/**
+ * @brief 1-based rank by total fight score (ties by name), 0 if the owner has no Pokemon.
+ * Why we made it: O(log n) through subtree sizes, however many owners exist.
+ */
+int trainerRank(PokedexContext *ctx, const OwnerNode *owner);
+
+/**
+ * @brief Number of trainers on the board (owners with at least one Pokemon).
+ */
+int leaderboardSize(PokedexContext *ctx);
+
+/**
+ * @brief Fill out with up to k top trainers, best first.
+ * @return number written
+ */
+int topTrainers(PokedexContext *ctx, OwnerNode **out, int k);
+
+/**
+ * @brief Fill out with up to k owned species (catalog indices), strongest first.
+ * @return number written
+ */
+int topSpecies(PokedexContext *ctx, int *out, int k);
+
+/* ------------------------------------------------------------
+   25) Battle Engine
+   ------------------------------------------------------------ */
+
+#define BATTLE_MAX_TURNS 64
+#define BATTLE_ROLL_MIN 224     // damage roll is 224..255 out of 256
+#define BATTLE_DAMAGE_SHIFT 12  // /2 for effectiveness halves, /256 for the roll, /8 so fights last a few turns
+
+// Damage multiplier in halves, [attacker][defender]: 0 immune, 1 = 0.5x, 2 = 1x, 4 = 2x
+extern const uint8_t typeEffect[TYPE_COUNT][TYPE_COUNT];
+
+// Battles advanced in lockstep, one lane per battle, stored as parallel
+// arrays so each turn is a straight loop over plain integers.
+// Side 0 of a lane always strikes first; swapped records the order the
+// battle was added in.
+typedef struct
+{
+	int count;
+	int capacity;
+	int32_t *hp[2];        // HP left on each side
+	int32_t *power[2];     // attack times effectiveness (halves) against the other side
+	uint32_t *rng;         // xorshift32 state, never 0
+	int32_t *turns;        // turns fought
+	uint8_t *swapped;      // lane sides are (second, first) of battleBatchAdd
+	uint8_t *winner;       // after battleBatchRun: 1 first, 2 second, 0 draw
+} BattleBatch;
+
+/**
+ * @brief Allocate room for capacity battles.
+ * @return 1 on success, 0 on allocation failure
+ */
+int battleBatchInit(BattleBatch *batch, int capacity);
+
+/**
+ * @brief Free a batch's arrays.
+ */
+void battleBatchFree(BattleBatch *batch);
+
+/**
+ * @brief Queue one battle; the seed alone decides who strikes first and every roll.
+ * @return lane index, or -1 if the batch is full
+ * Why we made it: The same (a, b, seed) gives the same result in any
+ *   batch, at any position, so runs can be reproduced and split up.
+ */
+int battleBatchAdd(BattleBatch *batch, const PokemonData *a, const PokemonData *b, uint64_t seed);
+
+/**
+ * @brief Fight every queued battle to the end or to BATTLE_MAX_TURNS (a draw).
+ * Why we made it: One pass per turn over all lanes, with no branches on
+ *   lane state, so the compiler can vectorize it and millions of battles
+ *   run per second.
+ */
+void battleBatchRun(BattleBatch *batch);
+
+/**
+ * @brief Empty the batch for reuse.
+ */
+void battleBatchClear(BattleBatch *batch);
+
+/* ------------------------------------------------------------
+   26) Library API
+   ------------------------------------------------------------ */
+
+// What a library call did. The menu turns these into its messages.
+typedef enum
+{
+	PK_OK = 0,
+	PK_NO_OWNER,       // no live owner with that handle or name
+	PK_NOT_FOUND,      // the owner does not have that Pokemon
+	PK_INVALID,        // species ID or argument out of range
+	PK_EXISTS,         // owner name taken, or Pokemon (or its evolved form) already owned
+	PK_EMPTY,          // nothing to release, evolve, undo or redo
+	PK_CANNOT_EVOLVE,
+	PK_NO_MEMORY,
+	PK_IO_ERROR        // a read or write on a caller's file descriptor failed
+} PokedexStatus;
+
+/**
+ * @brief Make an empty, independent Pokedex.
+ * @return the context, or NULL on allocation failure
+ * Why we made it: Several Pokedexes can live in one process, and each
+ *   one can be driven from its own thread. Load the catalog first with
+ *   loadCatalog; it is shared and never changes afterwards.
+ *   A context must be used by one thread at a time.
+ */
+PokedexContext *pokedexCreate(void);
+
+/**
+ * @brief Free every owner, the history and the indexes of a context, then the context.
+ */
+void pokedexDestroy(PokedexContext *ctx);
+
+// Calls that change a Pokedex record one undo step each, unless the menu
+// already has one open.
+
+/**
+ * @brief Add an owner at the end of the ring, with one starter species.
+ * @param handle receives the new owner's handle (may be NULL)
+ * @return PK_OK, PK_EXISTS, PK_NO_MEMORY, or PK_INVALID for an unknown
+ *   species or a name with a line break
+ */
+PokedexStatus pkNewOwner(PokedexContext *ctx, const char *name, int speciesId, uint32_t *handle);
+
+/**
+ * @brief Look up an owner by exact name.
+ * @return PK_OK or PK_NO_OWNER
+ */
+PokedexStatus pkFindOwner(PokedexContext *ctx, const char *name, uint32_t *handle);
+
+/**
+ * @brief Remove an owner and its Pokedex.
+ * @return PK_OK or PK_NO_OWNER
+ */
+PokedexStatus pkDeleteOwner(PokedexContext *ctx, uint32_t owner);
+
+/**
+ * @brief Copy src's Pokemon that dst lacks into dst, then remove src.
+ * @return PK_OK, PK_NO_OWNER, PK_INVALID when dst and src are the same owner,
+ *   or PK_NO_MEMORY, in which case neither owner changed
+ */
+PokedexStatus pkMergeOwners(PokedexContext *ctx, uint32_t dst, uint32_t src);
+
+/**
+ * @brief Reorder the ring by owner name.
+ * @return PK_OK or PK_NO_MEMORY
+ */
+PokedexStatus pkSortOwners(PokedexContext *ctx);
+
+/**
+ * @brief Give an owner a species.
+ * @return PK_OK, PK_NO_OWNER, PK_INVALID, PK_EXISTS or PK_NO_MEMORY
+ */
+PokedexStatus pkAddPokemon(PokedexContext *ctx, uint32_t owner, int speciesId);
+
+/**
+ * @brief Take a species away from an owner.
+ * @return PK_OK, PK_NO_OWNER, PK_EMPTY or PK_NOT_FOUND
+ */
+PokedexStatus pkReleasePokemon(PokedexContext *ctx, uint32_t owner, int speciesId);
+
+/**
+ * @brief Evolve one of an owner's Pokemon; if the evolved form is already
+ *   owned, the old one is dropped instead.
+ * @param evolvedId receives the evolved species ID (may be NULL)
+ * @return PK_OK, PK_EXISTS when the evolved form was already owned and the
+ *   Pokemon was released, PK_NO_OWNER, PK_EMPTY, PK_NOT_FOUND,
+ *   PK_CANNOT_EVOLVE or PK_NO_MEMORY
+ */
+PokedexStatus pkEvolvePokemon(PokedexContext *ctx, uint32_t owner, int speciesId, int *evolvedId);
+
+/**
+ * @brief Revert or replay the latest step of a context's history.
+ * @return PK_OK, or PK_EMPTY when there is nothing to undo or redo
+ */
+PokedexStatus pkUndo(PokedexContext *ctx);
+PokedexStatus pkRedo(PokedexContext *ctx);
+
+/**
+ * @brief Write up to max owner handles in ring order.
+ * @return the number of owners, which may be more than max
+ */
+int pkListOwners(PokedexContext *ctx, uint32_t *handles, int max);
+
+/**
+ * @brief Name of a live owner, or NULL.
+ */
+const char *pkOwnerName(PokedexContext *ctx, uint32_t owner);
+
+/**
+ * @brief Write up to max of an owner's species IDs, in the order they were added.
+ * @return how many Pokemon the owner has, or -1 if there is no such owner
+ */
+int pkOwnerPokemon(PokedexContext *ctx, uint32_t owner, int *ids, int max);
+
+/* ------------------------------------------------------------
+   28) Export
+   ------------------------------------------------------------ */
+
+#define EXPORT_BUFFER (1 << 20)
+
+typedef enum
+{
+	EXPORT_JSON_LINES = 1,  // one object per owner: {"owner":..., "pokemon":[{...}, ...]}
+	EXPORT_CSV = 2          // header, then one row per owner and Pokemon
+} ExportFormat;
+
+// Takes each filled export buffer; returns 0 to stop the export
+typedef int (*ExportSink)(void *arg, const void *data, size_t len);
+
+/**
+ * @brief Hand every owner and their Pokedex to sink, in ring order, with
+ *   each Pokedex in the order its Pokemon were added.
+ * @param sink called with each filled buffer, and arg
+ * @return owners written, or -1 if memory ran out or the sink failed
+ * Why we made it: Tools that read our data should not have to scrape
+ *   the display text. Each species' fields are rendered once, and rows
+ *   are assembled in one large buffer with no allocation per row. A
+ *   million owners export as fast as the descriptor takes the bytes.
+ */
+long exportOwners(PokedexContext *ctx, ExportFormat format, ExportSink sink, void *arg);
+
+/**
+ * @brief exportOwners into fd for one context (see section 26).
+ * @param owners receives the number of owners written (may be NULL)
+ * @return PK_OK, PK_INVALID for an unknown format, or PK_IO_ERROR
+ */
+PokedexStatus pkExportOwners(PokedexContext *ctx, int fd, ExportFormat format, long *owners);
+
+/* ------------------------------------------------------------
+   29) Import
+   ------------------------------------------------------------ */
+
+#define IMPORT_SAMPLES 10   // rejected rows kept for the report
+#define IMPORT_TOKEN 32     // bytes of the offending field kept per sample
+
+typedef enum
+{
+	IMPORT_NO_NAME = 1,     // the owner name is empty
+	IMPORT_BAD_QUOTES,      // a quoted name is not closed, or text follows the quote
+	IMPORT_BAD_SPECIES,     // a field is neither a catalog ID nor a species name
+	IMPORT_NUL_NAME         // the owner name has a NUL byte, which names cannot hold
+} ImportProblem;
+
+// What importOwners did; rows are the non-blank, non-comment lines
+typedef struct
+{
+	long rows;
+	long owners;            // owners created
+	long pokemon;           // Pokemon added
+	long duplicates;        // Pokemon the owner already had, skipped
+	long rejected;          // rows skipped whole because of a problem
+	int samples;            // entries filled in sample[]
+	struct
+	{
+		long line;
+		ImportProblem problem;
+		char token[IMPORT_TOKEN];
+	} sample[IMPORT_SAMPLES];
+} ImportReport;
+
+/**
+ * @brief Add owners and Pokemon from a file of "name,species,species,..." lines.
+ * @return PK_OK; PK_IO_ERROR if the file cannot be read (errno says why);
+ *   PK_NO_MEMORY if it stopped partway
+ * Why we made it: Loading a big trainer base through menu scripts costs a
+ *   name scan per owner and a prompt per Pokemon. Each line names an owner
+ *   (created if new) and any number of species IDs or names, so a plain
+ *   "owner,species_id" file and a checkpoint snapshot both load. The file
+ *   is mapped and parsed in one pass, and names are found through a hash
+ *   index built for the import. A row with a bad field is rejected whole.
+ *   An import cannot be undone; it clears the undo history.
+ */
+PokedexStatus importOwners(PokedexContext *ctx, const char *path, ImportReport *report);
+
+/**
+ * @brief importOwners for one context (see section 26).
+ */
+PokedexStatus pkImportOwners(PokedexContext *ctx, const char *path, ImportReport *report);
+
+/* ------------------------------------------------------------
+   30) Change Feed
+   ------------------------------------------------------------ */
+
+#define FEED_SLOTS (1 << 16)  // events kept when pkFeedOpen is given 0
+#define FEED_BATCH 64         // events a feed server sends per write
+
+// A consumer's position in a context's feed
+typedef struct
+{
+	const ChangeFeed *feed;
+	uint64_t next;           // sequence of the next event to read
+} FeedReader;
+
+/**
+ * @brief Turn on the change feed of a context.
+ * @param slots events kept for slow readers, rounded up to a power of two (0 = FEED_SLOTS)
+ * @return PK_OK (also if it was on already) or PK_NO_MEMORY
+ * Why we made it: Caches and search indexes want to follow what changes
+ *   without scraping the display. From now on every change to owners,
+ *   Pokedexes or the ring order is published as an event: through the
+ *   menu, the library, bulk commands, undo, redo and imports alike.
+ *   Publishing writes one slot and never waits on a reader.
+ */
+PokedexStatus pkFeedOpen(PokedexContext *ctx, uint32_t slots);
+
+/**
+ * @brief Stop the feed server, if any, and free the ring. Readers must be done with it.
+ */
+void feedClose(PokedexContext *ctx);
+
+/**
+ * @brief Start reading ctx's feed at the next event published.
+ * Why we made it: Any number of readers can follow one feed, from any
+ *   thread, each at its own pace. Reading takes no lock and writes nothing
+ *   the publisher looks at.
+ */
+void feedReaderInit(FeedReader *reader, PokedexContext *ctx);
+
+/**
+ * @brief Take the reader's next event.
+ * @return 1 with *event filled in, 0 if nothing new has been published
+ * Why we made it: A reader that fell more than a ring behind gets one
+ *   FEED_OVERFLOW event saying how many it lost, then resumes half a ring
+ *   behind the publisher. Its view of the data may be stale from then on.
+ */
+int feedRead(FeedReader *reader, FeedEvent *event);
+
+/**
+ * @brief Stream ctx's feed from a background thread to a Unix socket at
+ *   path, or into path if it is a FIFO.
+ * @return PK_OK, PK_INVALID if the feed is off or already served,
+ *   PK_IO_ERROR (errno says why) or PK_NO_MEMORY
+ * Why we made it: Other processes follow the feed with a plain socket or
+ *   pipe read. Each connection gets the events published after it
+ *   connected, as FeedEvent records. A consumer that doesn't keep up gets
+ *   an overflow record instead of holding anyone back.
+ */
+PokedexStatus pkFeedServe(PokedexContext *ctx, const char *path);
+
+// Publishing, called where the change is made; they do nothing while the feed is off
+
+/**
+ * @brief Publish one event about owner.
+ */
+void feedEmit(PokedexContext *ctx, FeedEventKind kind, const OwnerNode *owner, uint32_t a, uint32_t b);
+
+/**
+ * @brief Publish an owner that joined the ring: its name, then each Pokemon it has.
+ */
+void feedOwnerCreated(PokedexContext *ctx, const OwnerNode *owner);
+
+/**
+ * @brief Publish kind for each Pokemon in dex that owner does not have.
+ * Why we made it: Undo and redo swap whole Pokedexes. Called with the
+ *   incoming one before the swap (FEED_POKEMON_ADDED) and the outgoing one
+ *   after it (FEED_POKEMON_RELEASED), it publishes only what changed.
+ */
+void feedPokedexDifference(PokedexContext *ctx, const OwnerNode *owner, const Pokedex *dex, FeedEventKind kind);
+
+/**
+ * @brief Publish a bulk evolution, ordered so that replaying the events one by one gives the new Pokedex.
+ * @param positions Pokedex positions of the changed Pokemon; call before the Pokedex changes
+ * @param to what each one becomes, NULL if it is released
+ */
+void feedEvolutions(PokedexContext *ctx, const OwnerNode *owner, const int *positions, const PokemonData *const *to, int count);
+
+/* ------------------------------------------------------------
+   31) Shared-Memory Replica
+   ------------------------------------------------------------ */
+
+#define REPLICA_MIN_OWNERS 1024        // owner records in a new segment, at least
+#define REPLICA_MIN_NAMES (1 << 16)    // bytes of owner names in a new segment, at least
+
+/**
+ * @brief Publish ctx's owners and their species into the POSIX
+ *   shared-memory object name (see pkreplica.h), and keep it current.
+ * @return PK_OK, PK_INVALID if ctx already has one, PK_IO_ERROR (errno
+ *   says why) or PK_NO_MEMORY
+ * Why we made it: Reporting scripts want to look at live owners without
+ *   the menu and without pausing it. Readers map the segment and read
+ *   it directly, with no request to us at all. Each change rewrites only
+ *   the records it touched, each under its own seqlock. The segment is
+ *   laid out again, bigger, only when the owners or names outgrow it.
+ */
+PokedexStatus pkReplicaOpen(PokedexContext *ctx, const char *name);
+
+/**
+ * @brief Unmap and remove ctx's shared-memory replica, if any.
+ */
+void replicaClose(PokedexContext *ctx);
+
+// Called where the change is made; they do nothing while there is no replica
+
+/**
+ * @brief Rewrite owner's record: in the ring or not, its name and its species.
+ */
+void replicaOwner(PokedexContext *ctx, const OwnerNode *owner);
+
+/**
+ * @brief Set or clear one species bit of owner's record.
+ * @param index catalog index of the species
+ */
+void replicaSpecies(PokedexContext *ctx, const OwnerNode *owner, int index, int owned);
+
+#endif // POKEDEX_H
@@ -0,0 +1,61 @@
+#!/bin/sh
+# Replica churn test: create and delete owners with 40 KB names under
+# "ex6 -r" while pkquery keeps reading the segment. The segment must never
+# get smaller (a reader still mapping the old size would get SIGBUS) and
+# every pkquery run must finish normally.
+#
+#   sh replica_churn.sh            # builds ex6 and pkquery in a temp dir
+set -u
+CC=${CC:-gcc}
+dir=$(mktemp -d)
+name=/pkchurn$$
+trap 'rm -rf "$dir"; rm -f /dev/shm$name' EXIT
+$CC -Wall -Wextra -Werror -O2 -std=c99 -pthread ex6.c pokedex.c -o "$dir/ex6" || exit 1
+$CC -Wall -Wextra -Werror -O2 -std=c99 pkquery.c -o "$dir/pkquery" || exit 1
+
+long=$(head -c 40000 /dev/zero | tr '\0' x)
+{
+	# three at once first, so a later layout sees fewer live name bytes
+	for i in a b c; do
+		printf '1\n%s%s\n1\n' "$long" "$i"
+		sleep 0.1
+	done
+	printf '3\n1\n3\n1\n3\n1\n'
+	for i in 1 2 3 4 5 6 7 8 9 10 11 12; do
+		printf '1\n%s%d\n1\n' "$long" "$i"
+		sleep 0.1
+		printf '3\n1\n'
+		sleep 0.1
+	done
+	printf '7\n'
+} | "$dir/ex6" -q -r "$name" > "$dir/ex6.out" 2>&1 &
+writer=$!
+
+fail=0
+last=0
+reads=0
+while kill -0 $writer 2>/dev/null; do
+	# 0 before ex6 creates the segment and after it removes it at exit
+	size=$(stat -c %s /dev/shm$name 2>/dev/null || echo 0)
+	[ "$size" -gt 0 ] || continue
+	if [ "$size" -lt "$last" ]; then
+		echo "segment shrank from $last to $size bytes"
+		fail=1
+	fi
+	last=$size
+	"$dir/pkquery" -r "$name" dump > /dev/null 2>&1
+	status=$?
+	# 1 is the segment going away at exit; above 128 is a signal
+	if [ $status -gt 128 ]; then
+		echo "pkquery died with status $status"
+		fail=1
+	fi
+	reads=$((reads + 1))
+done
+wait $writer || fail=1
+grep -q "Goodbye!" "$dir/ex6.out" || fail=1
+if [ $fail -ne 0 ]; then
+	echo "replica churn: FAILED"
+	exit 1
+fi
+echo "replica churn: ok ($reads reads, largest segment $last bytes)"